@@ -4,31 +4,32 @@ ROOT_DIR:=$(shell pwd)
 CU = nvcc
 #CUFLAGS = -std=c++17 -O0 -g -ccbin g++-11 -I "/usr/include/eigen3" -I "/usr/include/nlohmann/" -I "$(ROOT_DIR)/ "
 CUFLAGS = -std=c++17 -O0 -g -ccbin mpic++ \
+          -Xcompiler "-fopenmp-simd -fno-trapping-math" \
           -I "/usr/include/eigen3" \
           -I "/usr/include/nlohmann/" \
           -I "$(ROOT_DIR)/" \
           -I "/usr/local/lib/python3.10/dist-packages/finitediff/include/"
 
 
-LDFLAGS =  -lgomp
+LDFLAGS =  -lgomp -ldl -lpthread
 
 # List the .cpp files required for compiling to .o objects, note we exlcude the .tpp template files 
 LIST_HELPERS_CODE = 	memetico/helpers/rng
-LIST_HELPERS_TEST = 	# To be implemented
+LIST_HELPERS_TEST = 	memetico/helpers/jet.test memetico/helpers/mask.test memetico/helpers/rng.test memetico/helpers/telemetry.test memetico/helpers/profile.test memetico/helpers/task_pool.test
 LIST_MODEL_BASE_CODE = 	memetico/model_base/model
 LIST_MODEL_BASE_TEST = 	memetico/model_base/element.test memetico/model_base/model.test
 LIST_MODELS_CODE = 		# All code via template classes, so effectively all code is in header files
 ## Had to remove the regression test when -O is > 0, specifically at the time we introduced lenz
 #LIST_MODELS_TEST = 		memetico/models/regression.test memetico/models/cont_frac.test memetico/models/branch_cont_frac_dd.test
-LIST_MODELS_TEST = 		memetico/models/cont_frac.test memetico/models/branch_cont_frac_dd.test
+LIST_MODELS_TEST = 		memetico/models/cont_frac.test memetico/models/branch_cont_frac_dd.test memetico/models/model_file.test memetico/models/model_predict.test
 #LIST_POP_CODE =			# working.. may all be in tpp/header files
-#LIST_POP_TEST =			memetico/population/agent.test memetico/population/pop.test
+LIST_POP_TEST =			memetico/population/agent.test memetico/population/pop.test
 LIST_DATA_CODE =		memetico/data/data_set
 LIST_DATA_TEST =		memetico/data/data_set.test
 LIST_GPU_CODE =			memetico/gpu/cuda
-LIST_GPU_TEST =			memetico/gpu/cuda.test
+LIST_GPU_TEST =			memetico/gpu/cuda.test memetico/gpu/interpreter.test
 LIST_OPTIMISE_CODE =	
-LIST_OPTIMISE_TEST =	memetico/optimise/objective.test memetico/optimise/local_search.test
+LIST_OPTIMISE_TEST =	memetico/optimise/objective.test memetico/optimise/local_search.test memetico/optimise/schedule.test
 # Aggregates
 LIST_TEST = $(LIST_HELPERS_TEST) $(LIST_MODEL_BASE_TEST) $(LIST_MODELS_TEST) $(LIST_POP_TEST) $(LIST_DATA_TEST) $(LIST_GPU_TEST) $(LIST_OPTIMISE_TEST)
 LIST_CODE = $(LIST_HELPERS_CODE) $(LIST_MODEL_BASE_CODE) $(LIST_MODELS_CODE) $(LIST_POP_CODE) $(LIST_DATA_CODE) $(LIST_GPU_CODE) $(LIST_OPTIMISE_CODE)
@@ -14,122 +14,70 @@
 #include <memetico/args.h>
 #include <memetico/globals.h>
 #include <memetico/helpers/rng.h>
+#include <memetico/helpers/profile.h>
 #include <memetico/data/data_set.h>
 #include <memetico/optimise/objective.h>
 #include <memetico/models/regression.h>
 #include <memetico/models/cont_frac_dd.h>
 #include <memetico/models/branch_cont_frac_dd.h>
+#include <memetico/models/model_file.h>
+#include <memetico/models/model_predict.h>
 #include <memetico/population/pop.h>
+#include <memetico/population/strata.h>
 #include <memetico/global_types.h>
 #include <mpi.h>
 
 // Std
+#include <atomic>
 #include <cstdlib>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 
-// Logic Globals
-bool            meme::GPU = false;
-uint_fast32_t   meme::SEED = 42;
-size_t          meme::GENERATIONS = 200;
-double          meme::MUTATE_RATE = 0.2;
-size_t          meme::LOCAL_SEARCH_INTERVAL = 1;
-size_t          meme::STALE_RESET = 5;
-bool            meme::INT_ONLY = false;
-size_t          meme::LOCAL_SEARCH_RUNS = 4;
-size_t          meme::NELDER_MEAD_STALE = 10;
-size_t          meme::NELDER_MEAD_MOVES = 1500;
-double          meme::LOCAL_SEARCH_DATA_PCT = 0;
-double          meme::PENALTY = 0;
-size_t          meme::GEN = 0;
-long int        meme::MAX_TIME = 10*60;
-long int        meme::RUN_TIME = 0;
-double          meme::EPSILON = 0;
-
-size_t          meme::DEPTH = 4;
-size_t          meme::POCKET_DEPTH = 1;
-size_t          meme::DIVERSITY_COUNT = 3;
-
-// Derivative Globals
-size_t          meme::IFR = 0;
-string          meme::IN_DER = "exact";
-size_t          meme::MAX_DER_ORD = 3;
-
-DynamicDepthType meme::DYNAMIC_DEPTH_TYPE = DynamicNone;
-
-// File Globals
-string          meme::TRAIN_FILE = "sinx.csv";
-string          meme::TEST_FILE = "sinx.csv";
-string          meme::LOG_DIR = "out/";
-ofstream        meme::master_log;
-
-// Technical Globals
-size_t          meme::PREC = 18;
-bool            meme::DEBUG = false;
-
-// Global Heplers
-RandReal        meme::RANDREAL;
-RandInt         meme::RANDINT;
-
-// Local Helpers
-FILE*           meme::STD_OUT;
-FILE*           meme::STD_ERR;
-
 /**
- * Entry point of the application
+ * Evolve a population on one seed and write its Model.bin, Run.log and prediction files
  * 
- * @param argc number of program arguments accessible in argv
- * @param argv array of arguments
- * @return int program succces
+ * @param seed seed of the run, the per run globals of the calling thread are set from it
+ * @param max_der_ord derivative order of the run, as given by the arguments
+ * @param train training data, shared read only between concurrent runs
+ * @param train_eval training data without derivative information, for the reported scores
+ * @param test test data
+ * @param valid validation data, nullptr for none
+ * @param batch true when other seeds run concurrently, the console summary is then a single line
+ * @return void
  */
-int main(int argc, char *argv[]) {
-
-    // Initialise MPI functionality
-    // int mpi_size, mpi_rank;
-    // MPI_Init(&argc, &argv);
-    // MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
-    // MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
-
-    cout << setprecision(18);
-
-    // Parse arguments
-    args::load_args(argc, argv);
-
-    cout << "Seed: " << meme::SEED << endl;
-    RandInt ri = RandInt(meme::SEED);
-    RandReal rr = RandReal(meme::SEED);
+void run_seed(uint_fast32_t seed, size_t max_der_ord, DataSet& train, DataSet& train_eval, DataSet& test, DataSet* valid, bool batch) {
+
+    // Nothing of an earlier run on this thread, such as its mask history, carries into this one
+    RunScope<ModelType> scope(max_der_ord);
+    meme::SEED = seed;
+    meme::RANDINT = RandInt(seed);
+    meme::RANDREAL = RandReal(seed);
+    RandInt ri = RandInt(seed);
+    RandReal rr = RandReal(seed);
     RandInt::RANDINT = &ri;
     RandReal::RANDREAL = &rr;
-    Model::FORMAT = PrintType::PrintExcel;
 
-    // Read Train and Test, Output for local copy
-    DataSet train = DataSet(meme::TRAIN_FILE, meme::GPU);
-    train.load();
-    train.csv(meme::LOG_DIR+to_string(meme::SEED)+".Train.csv");
-    DataSet test = DataSet(meme::TEST_FILE, meme::GPU);
-    test.load();
-    test.csv(meme::LOG_DIR+to_string(meme::SEED)+".Test.csv");
-
-    // Approximate derivative
-    /*
-    if( meme::IN_DER == "app-fd" )
-        train.compute_app_der(meme::MAX_DER_ORD);
-
-    train.normalise();
-    */
-
-    // Copy IVs to Model
-    for(size_t i = 0; i < DataSet::IVS.size(); i++)
-        ModelType::IVS.push_back(DataSet::IVS[i]);
+    // Create Population & run, or one population per depth stratum
+    unique_ptr<Population<ModelType>> p;
+    unique_ptr<Strata<ModelType>> strata;
+    if( meme::DEPTH_STRATA > 0 ) {
+        strata = make_unique<Strata<ModelType>>(&train, meme::DEPTH_STRATA);
+        strata->run();
+    } else {
+        p = make_unique<Population<ModelType>>(&train);
+        if( valid != nullptr )
+            p->set_validation(valid);
+        p->run();
+    }
+    ModelType& best = strata ? strata->result() : p->result();
 
-    // Create Population & run
-    Population<ModelType> p(&train);
-    p.run();
+    // Serialised model for memetico-serve
+    model_file::save(meme::LOG_DIR+to_string(meme::SEED)+".Model.bin", best, DataSet::IVS);
 
     // Evaluate without derviative information for return
     meme::MAX_DER_ORD = 0;
-    train = DataSet(meme::TRAIN_FILE, meme::GPU);
-    train.load();
 
     // Write Run.log
     ofstream log(meme::LOG_DIR+to_string(meme::SEED)+".Run.log");
@@ -139,33 +87,54 @@ int main(int argc, char *argv[]) {
 
         // Get results
         vector<size_t> all;
-        double train_score = ModelType::OBJECTIVE(&p.best_soln, &train, all);
-        double test_score = ModelType::OBJECTIVE(&p.best_soln, &test, all);
+        double train_score = ModelType::OBJECTIVE(&best, &train_eval, all);
+        double test_score = ModelType::OBJECTIVE(&best, &test, all);
+        double valid_score = valid != nullptr ? ModelType::OBJECTIVE(&best, valid, all) : 0;
         
         // Log data
-        log << "Seed,Score,Train MSE,Test MSE,Dur,Model" << endl;
+        log << "Seed,Score,Train MSE,Test MSE," << (valid != nullptr ? "Valid MSE," : "") << "Dur,Model" << endl;
         log << meme::SEED;
         log << "," << MemeticModel<DataType>::OBJECTIVE_NAME;
         log << "," << train_score;
         log << "," << test_score;
+        if( valid != nullptr )
+            log << "," << valid_score;
         log << "," << meme::RUN_TIME/1000.0;
-        log << "," << p.best_soln << endl;
-
-        // While we are here, inform the user
-        cout << endl << endl;
-        cout << "Finished after " << meme::RUN_TIME << " milliseconds on seed " << meme::SEED << endl;
-        cout << "====================================================" << endl << endl;
-        cout << "Best Model Found" << endl;
-        cout << p.best_soln << endl << endl;
-        Model::FORMAT = PrintType::PrintLatex;
-        cout << p.best_soln << endl << endl;
-        cout << " Train MSE: " << train_score << endl;
-        cout << "  Test MSE: " << test_score << endl << endl;
-        cout << "====================================================" << endl << endl;
+        log << "," << best << endl;
+
+        if( batch ) {
+
+            // Timings of concurrent runs are mixed, they are reported once for the batch
+            static mutex out_lock;
+            lock_guard<mutex> guard(out_lock);
+            cout << "Seed " << meme::SEED << " finished after " << meme::RUN_TIME << " milliseconds, Train MSE: " << train_score << ", Test MSE: " << test_score << endl;
+
+        } else {
+
+            // Hot path timings, only present when built with MEMETICO_PROFILE
+            profile::report(log);
+
+            // While we are here, inform the user
+            cout << endl << endl;
+            cout << "Finished after " << meme::RUN_TIME << " milliseconds on seed " << meme::SEED << endl;
+            cout << "====================================================" << endl << endl;
+            cout << "Best Model Found" << endl;
+            cout << best << endl << endl;
+            Model::FORMAT = PrintType::PrintLatex;
+            cout << best << endl << endl;
+            cout << " Train MSE: " << train_score << endl;
+            cout << "  Test MSE: " << test_score << endl;
+            if( valid != nullptr )
+                cout << " Valid MSE: " << valid_score << " (generation " << p->best_valid_gen << ")" << endl;
+            cout << endl;
+            cout << "====================================================" << endl << endl;
+            profile::report(cout);
+        }
 
     }
     
-    // MPI_Finalize();     // Close out MPI
+    // Predictions of the root pocket, or of the returned model when it was chosen on validation or across strata
+    ModelType& predictor = valid != nullptr || strata ? best : p->root_agent->get_pocket();
 
     // Write Training results
     ofstream train_log(meme::LOG_DIR+to_string(meme::SEED)+".Train.Predict.csv");
@@ -176,12 +145,12 @@ int main(int argc, char *argv[]) {
             train_log << "," << DataSet::IVS[i];
         train_log << ",yd" << endl;
 
-        for(size_t i = 0; i < train.get_count(); i++) {
+        for(size_t i = 0; i < train_eval.get_count(); i++) {
 
-            train_log << train.y[i];
+            train_log << train_eval.y[i];
             for(size_t j = 0; j < DataSet::IVS.size(); j++)                    
-                train_log << ","  << train.samples[i][j];
-            train_log << "," << p.root_agent->get_pocket().evaluate(train.samples[i]) << endl;
+                train_log << ","  << train_eval.samples[i][j];
+            train_log << "," << predictor.evaluate(train_eval.samples[i]) << endl;
             
         }
 
@@ -201,11 +170,299 @@ int main(int argc, char *argv[]) {
             test_log << test.y[i];
             for(size_t j = 0; j < DataSet::IVS.size(); j++)                    
                 test_log << ","  << test.samples[i][j];
-            test_log << "," << p.root_agent->get_pocket().evaluate(test.samples[i]) << endl;
+            test_log << "," << predictor.evaluate(test.samples[i]) << endl;
             
         }
 
     }
 
-    return EXIT_SUCCESS;
+}
+
+/**
+ * Cross validate over meme::CV folds of the training data and write their scores to Run.log
+ * - Each fold is a Population trained on an index view of \a train, the held out fold is its validation data
+ * - Folds run concurrently on meme::JOBS threads, each on its own random stream of meme::SEED
+ * 
+ * @param train training data, shared read only between the folds
+ * @param train_eval training data without derivative information, for the reported scores
+ * @param test test data
+ * @param valid validation data for early stopping of every fold, nullptr for none
+ * @return int program success, failure when any fold failed
+ */
+int cross_validate(DataSet& train, DataSet& train_eval, DataSet& test, DataSet* valid) {
+
+    // Views evaluate on the CPU, and the checkpoint and telemetry files of the folds would collide
+    if( meme::GPU )
+        throw invalid_argument("--cv evaluates folds on views of the CPU data, it cannot be combined with --cuda");
+    meme::CHECKPOINT = 0;
+    meme::RESUME = false;
+    meme::TELEMETRY = "";
+
+    vector<vector<size_t>> validation = train.folds(meme::CV);
+    size_t k = validation.size();
+
+    // Training rows of a fold are the rows of every other fold
+    vector<vector<size_t>> training(k);
+    for(size_t f = 0; f < k; f++) {
+        for(size_t g = 0; g < k; g++)
+            if( g != f )
+                training[f].insert(training[f].end(), validation[g].begin(), validation[g].end());
+        sort(training[f].begin(), training[f].end());
+    }
+
+    struct Fold {
+        double      train = 0, validation = 0, test = 0;
+        long int    ms = 0;
+        string      model;
+        bool        ok = false;
+    };
+    vector<Fold> results(k);
+
+    size_t jobs = meme::JOBS > 0 ? meme::JOBS : max(1u, thread::hardware_concurrency());
+    jobs = min(jobs, k);
+    cout << "Cross validating " << k << " folds on " << jobs << " threads" << endl;
+
+    uint_fast32_t seed = meme::SEED;
+    size_t max_der_ord = meme::MAX_DER_ORD;
+    atomic<size_t> next(0);
+    mutex out_lock;
+    auto worker = [&]() {
+        for(size_t f = next++; f < k; f = next++) {
+
+            // Thread local per run globals, each fold on its own stream
+            RunScope<ModelType> scope(max_der_ord);
+            meme::SEED = seed;
+            meme::RANDINT = RandInt(seed).split(f);
+            meme::RANDREAL = RandReal(seed).split(f);
+            RandInt ri = RandInt(seed).split(f);
+            RandReal rr = RandReal(seed).split(f);
+            RandInt::RANDINT = &ri;
+            RandReal::RANDREAL = &rr;
+
+            Fold& r = results[f];
+            try {
+
+                Population<ModelType> p(&train, POP_DEPTH, POP_DEGREE, training[f]);
+                if( valid != nullptr )
+                    p.set_validation(valid);
+                p.run();
+
+                // Score without derivative information as a single run
+                meme::MAX_DER_ORD = 0;
+                ModelType best = p.result();
+                vector<size_t> all;
+                r.train = ModelType::OBJECTIVE(&best, &train_eval, training[f]);
+                r.validation = ModelType::OBJECTIVE(&best, &train_eval, validation[f]);
+                r.test = ModelType::OBJECTIVE(&best, &test, all);
+                r.ms = meme::RUN_TIME;
+                stringstream model;
+                model << setprecision(meme::PREC) << best;
+                r.model = model.str();
+                r.ok = true;
+
+                lock_guard<mutex> guard(out_lock);
+                cout << "Fold " << f << " finished after " << r.ms << " milliseconds, Train MSE: " << r.train << ", Validation MSE: " << r.validation << endl;
+
+            } catch(exception& e) {
+                lock_guard<mutex> guard(out_lock);
+                cerr << "Fold " << f << " failed: " << e.what() << endl;
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for(size_t t = 1; t < jobs; t++)
+        workers.emplace_back(worker);
+    worker();
+    for(thread& w : workers)
+        w.join();
+
+    // Mean and sample standard deviation over the folds that finished
+    vector<double> mean(3, 0), sd(3, 0);
+    size_t done = 0;
+    long int ms = 0;
+    for(Fold& r : results) {
+        if( !r.ok )
+            continue;
+        done++;
+        ms += r.ms;
+        double v[3] = {r.train, r.validation, r.test};
+        for(size_t j = 0; j < 3; j++)
+            mean[j] += v[j];
+    }
+    for(size_t j = 0; j < 3 && done > 0; j++)
+        mean[j] /= done;
+    for(Fold& r : results) {
+        if( !r.ok )
+            continue;
+        double v[3] = {r.train, r.validation, r.test};
+        for(size_t j = 0; j < 3; j++)
+            sd[j] += (v[j]-mean[j])*(v[j]-mean[j]);
+    }
+    for(size_t j = 0; j < 3 && done > 1; j++)
+        sd[j] = sqrt(sd[j]/(done-1));
+
+    ofstream log(meme::LOG_DIR+to_string(seed)+".Run.log");
+    if (log.is_open()) {
+
+        log << setprecision(meme::PREC);
+        log << "Seed,Fold,Score,Train MSE,Validation MSE,Test MSE,Dur,Model" << endl;
+        for(size_t f = 0; f < k; f++)
+            if( results[f].ok )
+                log << seed << "," << f << "," << MemeticModel<DataType>::OBJECTIVE_NAME << "," << results[f].train << "," << results[f].validation << "," << results[f].test << "," << results[f].ms/1000.0 << "," << results[f].model << endl;
+        log << seed << ",mean," << MemeticModel<DataType>::OBJECTIVE_NAME << "," << mean[0] << "," << mean[1] << "," << mean[2] << "," << (done > 0 ? ms/1000.0/done : 0) << "," << endl;
+        log << seed << ",sd," << MemeticModel<DataType>::OBJECTIVE_NAME << "," << sd[0] << "," << sd[1] << "," << sd[2] << ",," << endl;
+        profile::report(log);
+    }
+
+    cout << endl << "Cross validation over " << done << " of " << k << " folds" << endl;
+    cout << "      Train MSE: " << mean[0] << " +- " << sd[0] << endl;
+    cout << " Validation MSE: " << mean[1] << " +- " << sd[1] << endl;
+    cout << "       Test MSE: " << mean[2] << " +- " << sd[2] << endl << endl;
+    profile::report(cout);
+
+    return done == k ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Entry point of the application
+ * 
+ * @param argc number of program arguments accessible in argv
+ * @param argv array of arguments
+ * @return int program succces
+ */
+int main(int argc, char *argv[]) {
+
+    // Initialise MPI functionality
+    // int mpi_size, mpi_rank;
+    // MPI_Init(&argc, &argv);
+    // MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+    // MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+
+    cout << setprecision(18);
+
+    // Parse arguments
+    args::load_args(argc, argv);
+
+    cout << "Seed: " << meme::SEED << endl;
+    RandInt ri = RandInt(meme::SEED);
+    RandReal rr = RandReal(meme::SEED);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+    Model::FORMAT = PrintType::PrintExcel;
+
+    // Predict with a trained model instead of training
+    if( meme::PREDICT != "" ) {
+
+        ModelType model(0);
+        vector<string> ivs;
+        model_file::load(meme::PREDICT, model, ivs);
+
+        // Large stream buffers keep the run bound by the disk rather than by calls into the stream
+        vector<char> in_buf(1 << 20), out_buf(1 << 20);
+        ifstream in;
+        ofstream out;
+        in.rdbuf()->pubsetbuf(in_buf.data(), in_buf.size());
+        out.rdbuf()->pubsetbuf(out_buf.data(), out_buf.size());
+        in.open(meme::TRAIN_FILE, ios::binary);
+        out.open(meme::PREDICT_OUT, ios::binary | ios::trunc);
+        if( !in.is_open() )
+            throw runtime_error("Unable to open "+meme::TRAIN_FILE);
+        if( !out.is_open() )
+            throw runtime_error("Unable to open "+meme::PREDICT_OUT);
+
+        auto start = chrono::steady_clock::now();
+        predict::Predictor<ModelType> predictor(model, ivs, meme::PREDICT_DERS);
+        size_t rows = predictor.run(in, predict::format_of(meme::TRAIN_FILE), out, predict::format_of(meme::PREDICT_OUT));
+        out.close();
+        long int ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now()-start).count();
+
+        cout << "Predicted " << rows << " rows to " << meme::PREDICT_OUT << " in " << ms << " ms" << endl;
+        return EXIT_SUCCESS;
+    }
+
+    // Read Train and Test once, shared by every seed
+    DataSet train = DataSet(meme::TRAIN_FILE, meme::GPU);
+    train.load();
+    DataSet test = DataSet(meme::TEST_FILE, meme::GPU);
+    test.load();
+
+    // Approximate derivative
+    /*
+    if( meme::IN_DER == "app-fd" )
+        train.compute_app_der(meme::MAX_DER_ORD);
+
+    train.normalise();
+    */
+
+    // Training data without derviative information for the reported scores
+    size_t max_der_ord = meme::MAX_DER_ORD;
+    meme::MAX_DER_ORD = 0;
+    DataSet train_eval = DataSet(meme::TRAIN_FILE, meme::GPU);
+    train_eval.load();
+    meme::MAX_DER_ORD = max_der_ord;
+
+    // Validation data, also shared
+    unique_ptr<DataSet> valid;
+    if( meme::VALID_FILE != "" ) {
+        meme::MAX_DER_ORD = 0;
+        valid = make_unique<DataSet>(meme::VALID_FILE, meme::GPU);
+        valid->load();
+        meme::MAX_DER_ORD = max_der_ord;
+    }
+
+    // Copy IVs to Model
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    // K fold cross validation over the loaded training data
+    if( meme::CV > 0 )
+        return cross_validate(train, train_eval, test, valid.get());
+
+    // Single run, with local copies of the data
+    if( meme::SEEDS.empty() ) {
+
+        train.csv(meme::LOG_DIR+to_string(meme::SEED)+".Train.csv");
+        test.csv(meme::LOG_DIR+to_string(meme::SEED)+".Test.csv");
+        run_seed(meme::SEED, max_der_ord, train, train_eval, test, valid.get(), false);
+
+        // MPI_Finalize();     // Close out MPI
+        return EXIT_SUCCESS;
+    }
+
+    // Batch of seeds, each worker takes the next seed until none remain
+    // GPU data holds the local search subset of a single run
+    size_t jobs = meme::JOBS > 0 ? meme::JOBS : max(1u, thread::hardware_concurrency());
+    if( meme::GPU )
+        jobs = 1;
+    jobs = min(jobs, meme::SEEDS.size());
+
+    cout << "Running " << meme::SEEDS.size() << " seeds on " << jobs << " threads" << endl;
+    auto start = chrono::steady_clock::now();
+
+    atomic<size_t> next(0);
+    atomic<size_t> failed(0);
+    auto worker = [&]() {
+        for(size_t i = next++; i < meme::SEEDS.size(); i = next++) {
+            try {
+                run_seed(meme::SEEDS[i], max_der_ord, train, train_eval, test, valid.get(), true);
+            } catch(exception& e) {
+                cerr << "Seed " << meme::SEEDS[i] << " failed: " << e.what() << endl;
+                failed++;
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for(size_t t = 1; t < jobs; t++)
+        workers.emplace_back(worker);
+    worker();
+    for(thread& w : workers)
+        w.join();
+
+    long int ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now()-start).count();
+    cout << "Finished " << meme::SEEDS.size()-failed << " of " << meme::SEEDS.size() << " seeds in " << ms << " milliseconds" << endl;
+    profile::report(cout);
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -11,24 +11,42 @@ double          meme::PENALTY = 0;
 size_t          meme::PREC = 18;
 size_t          meme::NELDER_MEAD_STALE = 10;
 size_t          meme::NELDER_MEAD_MOVES = 250;
+thread_local double meme::NELDER_MEAD_SCALE = 1;
+bool            meme::SCHEDULE = false;
 double          meme::LOCAL_SEARCH_DATA_PCT = 1;
 size_t          meme::LOCAL_SEARCH_RUNS = 4;
 size_t          meme::LOCAL_SEARCH_INTERVAL = 1;
 double          meme::MUTATE_RATE = 0.2;
-size_t          meme::GEN = 0;
+thread_local size_t meme::GEN = 0;
 size_t          meme::GENERATIONS = 20;
-size_t          meme::POCKET_DEPTH = 4;
+thread_local size_t meme::POCKET_DEPTH = 4;
 long int        meme::MAX_TIME = 6000;
-long int        meme::RUN_TIME = 0;
+thread_local long int meme::RUN_TIME = 0;
 size_t          meme::DIVERSITY_COUNT = 5;
 size_t          meme::STALE_RESET = 10;
 size_t          meme::DEPTH = 4;
 bool            meme::GPU = false;
+bool            meme::JIT = false;
+string          meme::JIT_DIR = "";
+size_t          meme::CHECKPOINT = 0;
+bool            meme::RESUME = false;
+string          meme::TELEMETRY = "";
+bool            meme::VERBOSE = false;
+thread_local uint_fast32_t meme::SEED = 42;
+double          meme::EPSILON = 0;
+string          meme::LOG_DIR = "out/";
+size_t          meme::PATIENCE = 0;
+PrecisionType   meme::PRECISION = PrecisionDouble;
+DynamicDepthType meme::DYNAMIC_DEPTH_TYPE = DynamicNone;
+size_t          meme::DEPTH_STRATA = 0;
+size_t          meme::EVOLVE_THREADS = 0;
+thread_local size_t meme::DEPTH_LOW = 0;
+thread_local size_t meme::DEPTH_HIGH = numeric_limits<size_t>::max();
 
-RandReal        meme::RANDREAL;
-RandInt         meme::RANDINT;
+thread_local RandReal meme::RANDREAL;
+thread_local RandInt meme::RANDINT;
 
 // Derivative Globals
 size_t          meme::IFR = 0;
 string          meme::IN_DER = "exact";
-size_t          meme::MAX_DER_ORD = 3;
\ No newline at end of file
+thread_local size_t meme::MAX_DER_ORD = 3;
\ No newline at end of file
@@ -67,6 +67,23 @@ namespace args {
             RandInt seed_init = RandInt();
             meme::SEED = seed_init(1, numeric_limits<int>::max());
         }
+        // Batch of seeds, inclusive range a..b or a single seed
+        arg_string = arg_value(argv, argv+argc, "-ss", "--seeds");
+        if(arg_string != "") {
+            size_t dots = arg_string.find("..");
+            uint_fast32_t first = stol(arg_string.substr(0, dots));
+            uint_fast32_t last = dots == string::npos ? first : stol(arg_string.substr(dots+2));
+            if( last < first )
+                throw invalid_argument("Invalid --seeds range "+arg_string);
+            for(uint_fast32_t s = first; s <= last; s++)
+                meme::SEEDS.push_back(s);
+            meme::SEED = first;
+        }
+
+        arg_string = arg_value(argv, argv+argc, "-j", "--jobs");
+        if(arg_string != "")
+            meme::JOBS = stoi(arg_string);
+
         meme::RANDINT = RandInt(meme::SEED);
         meme::RANDREAL = RandReal(meme::SEED);
 
@@ -93,6 +110,8 @@ namespace args {
         string arg_string = arg_value(argv, argv+argc, "-ls", "--local-search");
         if( arg_string == "cnm" || arg_string == "")    MemeticModel<DataType>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<DataType>>;
         if( arg_string == "cnms" )                      MemeticModel<DataType>::LOCAL_SEARCH = local_search::custom_nelder_mead_alg4<MemeticModel<DataType>>;  
+        if( arg_string == "lm" )                        MemeticModel<DataType>::LOCAL_SEARCH = local_search::levenberg_marquardt<MemeticModel<DataType>>;  
+        if( arg_string == "lbfgs" )                     MemeticModel<DataType>::LOCAL_SEARCH = local_search::lbfgs<MemeticModel<DataType>>;  
     }
 
     void arg_objective(int argc, char * argv[]) {
@@ -131,6 +150,14 @@ namespace args {
         if(arg_string == "stale-ext")                   Population<ModelType>::DIVERSITY_TYPE = DiversityStaleExtended;
     }
 
+    void arg_precision(int argc, char * argv[]) {
+        // CPU evaluation precision
+        string arg_string = arg_value(argv, argv+argc, "-pr", "--precision");
+        if(arg_string == "double" || arg_string == "")  meme::PRECISION = PrecisionDouble;
+        if(arg_string == "float")                       meme::PRECISION = PrecisionFloat;
+        if(arg_string == "mixed")                       meme::PRECISION = PrecisionMixed;
+    }
+
     void arg_help(int argc, char * argv[]) {
      
         if(arg_exists(argv, argv+argc, "-h", "--help")) {
@@ -155,8 +182,19 @@ namespace args {
 
                         OPTIONAL:
 
+                            -ck --checkpoint <integer>      Write the run state to <log-to>/<seed>.Checkpoint.bin every this many generations
+                                                            and when --max-time is reached
+                                                            Defaults to 0, no checkpoints
+
                             -cu --cuda                      Execute with cuda GPU optimisation
 
+                            -cv --cv <integer>              Cross validate over this many folds of the training data, one population per fold
+                                                            Folds are index views of the loaded data and run concurrently, see --jobs
+                                                            <log-to>/<seed>.Run.log holds the train, validation and test score of each
+                                                            fold and their mean and standard deviation
+                                                            Checkpoints and telemetry are disabled
+                                                            Defaults to 0, a single run on all of the training data
+
                             -d --delta                      Penalty for the number of parameters within the solution (Real Number 0.0 <= d <= 1.0)
                                                             Expressed in the solution fitness. When no parameters are used Fitness = Error           
                                                             When parameters are used
@@ -172,6 +210,13 @@ namespace args {
                                                                 adp-mu: as per adp, but during mutation re-randomise depth +- 1
                                                                 rnd: randomise new solutions uniform at random between 0 and -f inclusive
                                                                 
+                            -ds --depth-strata <integer>    Split fraction depths 0 to -f into this many ranges, each evolved by its own population
+                                                            Strata run concurrently with generation budgets that equalise their cost, and every
+                                                            epoch the best of each stratum is promoted to the shallowest depth of the next
+                                                            Cannot be combined with --valid, --cv, --checkpoint, --resume, --schedule,
+                                                            --telemetry or --parallel-evolve, and --verbose prints a line per epoch
+                                                            Defaults to 0, a single population
+
                             -dm --diversity-method          Method to replace similar solutions each generation
                                                             Compares all pocket and current solutions based on differences in MSE scores
                                                             Process performs a full local search after renewing
@@ -190,6 +235,12 @@ namespace args {
                             -ifr --index-first-repetition   Index first repetition, 1 core = 1 repetition
                                                             Defaults to 0
 
+                            -j --jobs <integer>             Number of --seeds or --cv folds run concurrently
+                                                            Defaults to 0, all cores
+
+                            -jit --jit                      Compile models to native code with the system compiler ($CXX) during MSE local search
+                                                            Objects are cached by model structure in $XDG_CACHE_HOME/memetico_jit/ or ~/.cache/memetico_jit/
+
 
                             -f --fracdepth <integer>        Depth of continued fraction
                                                             Defaults to 4
@@ -202,7 +253,10 @@ namespace args {
 
                             -ls --local-search              Local Search method
                                                             Available Options: 
-                                                                cnm
+                                                                cnm: Nelder-Mead
+                                                                cnms: Nelder-Mead (algorithm 4)
+                                                                lm: Levenberg-Marquardt on the MSE with analytic gradients
+                                                                lbfgs: L-BFGS on the MSE with analytic gradients
                                                             Defaults to "cnm
 
                             -mdo, --max-der-ord             Maximum derivative order (compute derivatives up to this order)
@@ -210,6 +264,34 @@ namespace args {
 
                             -p --problem                    Problem name
 
+                            -pa --patience <integer>        With --valid, stop once the validation score has not improved for this many generations
+                                                            Requires --valid
+                                                            Defaults to 0, run to --gens or --max-time
+
+                            -pd --predict <filepath>        Predict --train with a model file written by a run instead of training
+                                                            CSV input columns are matched to the model variables by name, .bin input
+                                                            is float64 rows of the model variables
+
+                            -pdd --predict-ders <integer>   Also write derivatives up to this order with respect to the first variable
+                                                            Defaults to 0
+
+                            -pdo --predict-out <filepath>   Prediction output, .bin for float64 rows and CSV otherwise
+                                                            Defaults to <log-to>/<seed>.Predict.csv
+
+                            -pe --parallel-evolve <integer> Evolve the subtrees below the root concurrently on this many threads, 0 for all cores
+                                                            Each subtree has its own random streams and mask history, so results do not depend
+                                                            on the number of threads but differ from a run without --parallel-evolve
+                                                            Cannot be combined with --checkpoint, --resume or --depth-strata
+                                                            Defaults to evolving on the run thread only
+
+                            -pr --precision                 Arithmetic precision of CPU evaluation for the mse objective
+                                                            Available Options: 
+                                                                double: all evaluation in double
+                                                                float: evaluation in float, vectorised over samples
+                                                                mixed: Nelder-Mead trial points screened in float, re-scored in double
+                                                                       when they could improve on the starting fitness
+                                                            Defaults to "double"
+
                             -o --objective                  Objective function identifier to drive learning
                                                             Available Options: 
                                                                 mse, 
@@ -223,13 +305,35 @@ namespace args {
 
                             -mt --max-time                  Number of seconds after which the best solution is returned
 
+                            -rs --resume                    Continue bit-exactly from <log-to>/<seed>.Checkpoint.bin when it exists
+                                                            Requires the same data, seed and options as the checkpointed run
+
+                            -sc --schedule                  Adapt local search runs, Nelder-Mead moves and the --local-data sample to the time left
+                                                            of --max-time, favouring agents that improve, and stop before a generation would overrun it
+
                             -s --seed <integer>             Reproduction seed
                                                             Defaults to random integer between 1, numerical_limit<int>::max()
 
+                            -ss --seeds <a..b>              Run every seed from a to b inclusive in one process, sharing the loaded data
+                                                            Each seed writes its own <log-to>/<seed>.* files, except the copies
+                                                            of the train and test data, and counts its own --telemetry
+
                             -st --stale                     Stale count that triggers renew of the roots current solution
 
                             
 
+                            -tm --telemetry <format>        Write per generation counters and timings to <log-to>/<seed>.Telemetry.<format>
+                                                            Available Options: 
+                                                                jsonl: one JSON object per generation
+                                                                bin: consecutive telemetry::Record structs
+                                                            Defaults to no telemetry
+
+                            -v --verbose                    Print a line per generation to stdout
+
+                            -va --valid <filepath>          Validation data, scored each time the best solution changes
+                                                            The run returns the best solution on validation rather than on training
+                                                            and Run.log gains a Valid MSE column
+
                             -T --Test <filepath>            Test data file for interpolation
                                                             Defaults to training filepath from -t
 
@@ -260,6 +364,13 @@ namespace args {
         arg_string = arg_value(argv, argv+argc, "-T", "--Test");
         if(arg_string != "")    meme::TEST_FILE = arg_string;
         else                    meme::TEST_FILE = meme::TRAIN_FILE;
+
+        // Validation
+        meme::VALID_FILE = arg_value(argv, argv+argc, "-va", "--valid");
+        arg_string = arg_value(argv, argv+argc, "-pa", "--patience");
+        if(arg_string != "")    meme::PATIENCE = stoi(arg_string);
+        if(meme::PATIENCE > 0 && meme::VALID_FILE == "")
+            throw invalid_argument("--patience stops on the validation score, it requires --valid");
         
         // Mutation Rate
         arg_string = arg_value(argv, argv+argc, "-mr", "--mutate-rate");
@@ -285,6 +396,10 @@ namespace args {
         arg_string = arg_value(argv, argv+argc, "-mt", "--max-time");
         if(arg_string != "")        meme::MAX_TIME = stoi(arg_string);
 
+        // Time budget scheduler
+        if( arg_exists(argv, argv+argc, string("-sc"), string("--schedule")) )
+            meme::SCHEDULE = true;
+
         // Error epsilon
         arg_string = arg_value(argv, argv+argc, "-e", "--error");
         if(arg_string != "")        meme::EPSILON = stod(arg_string);
@@ -293,6 +408,40 @@ namespace args {
         arg_log(argc, argv);
         arg_local_search(argc, argv);
         arg_objective(argc, argv);
+        arg_precision(argc, argv);
+
+        // Compiled local search
+        if( arg_exists(argv, argv+argc, string("-jit"), string("--jit")) )
+            meme::JIT = true;
+
+        // Checkpoint interval
+        arg_string = arg_value(argv, argv+argc, "-ck", "--checkpoint");
+        if(arg_string != "")        meme::CHECKPOINT = stoi(arg_string);
+
+        // Resume from checkpoint
+        if( arg_exists(argv, argv+argc, string("-rs"), string("--resume")) )
+            meme::RESUME = true;
+
+        // Telemetry log format
+        arg_string = arg_value(argv, argv+argc, "-tm", "--telemetry");
+        if(arg_string == "jsonl" || arg_string == "bin")    meme::TELEMETRY = arg_string;
+
+        // Per generation output
+        if( arg_exists(argv, argv+argc, string("-v"), string("--verbose")) )
+            meme::VERBOSE = true;
+
+        // Cross validation folds
+        arg_string = arg_value(argv, argv+argc, "-cv", "--cv");
+        if(arg_string != "")            meme::CV = stoi(arg_string);
+        if(meme::CV > 0 && !meme::SEEDS.empty())
+            throw invalid_argument("--cv runs the folds of a single --seed, it cannot be combined with --seeds");
+
+        // Prediction mode
+        meme::PREDICT = arg_value(argv, argv+argc, "-pd", "--predict");
+        meme::PREDICT_OUT = arg_value(argv, argv+argc, "-pdo", "--predict-out");
+        if(meme::PREDICT_OUT == "")     meme::PREDICT_OUT = meme::LOG_DIR+to_string(meme::SEED)+".Predict.csv";
+        arg_string = arg_value(argv, argv+argc, "-pdd", "--predict-ders");
+        if(arg_string != "")            meme::PREDICT_DERS = stoi(arg_string);
 
         // CFR Specific
 
@@ -307,6 +456,20 @@ namespace args {
         arg_dynamic_depth(argc,argv);
         arg_diversity(argc,argv);
 
+        // Depth strata
+        arg_string = arg_value(argv, argv+argc, "-ds", "--depth-strata");
+        if(arg_string != "")        meme::DEPTH_STRATA = stoi(arg_string);
+        if(meme::DEPTH_STRATA > 0 && (meme::VALID_FILE != "" || meme::CV > 0 || meme::CHECKPOINT > 0 || meme::RESUME || meme::SCHEDULE || meme::TELEMETRY != ""))
+            throw invalid_argument("--depth-strata cannot be combined with --valid, --cv, --checkpoint, --resume, --schedule or --telemetry");
+
+        // Parallel evolution
+        arg_string = arg_value(argv, argv+argc, "-pe", "--parallel-evolve");
+        if(arg_string != "")        meme::EVOLVE_THREADS = stoi(arg_string) > 0 ? stoi(arg_string) : max(1u, thread::hardware_concurrency());
+        if(meme::EVOLVE_THREADS > 0 && (meme::CHECKPOINT > 0 || meme::RESUME))
+            throw invalid_argument("--parallel-evolve cannot be combined with --checkpoint or --resume");
+        if(meme::EVOLVE_THREADS > 0 && meme::DEPTH_STRATA > 0)
+            throw invalid_argument("--parallel-evolve cannot be combined with --depth-strata, whose strata already run on their own threads");
+
         //// Derivative considerations
 
         // Index First Repetition (IFR)
@@ -32,6 +32,9 @@ void DataSet::load() {
 
     if( get_gpu() )
         setup_gpu();
+
+    if( meme::PRECISION != meme::PrecisionDouble )
+        setup_float();
 }
 
 void DataSet::load_header(string line) {
@@ -158,6 +161,27 @@ vector<size_t> DataSet::subset(float pct, bool to_GPU) {
 
 }
 
+vector<vector<size_t>> DataSet::folds(size_t k) {
+
+    if( k < 2 || k > get_count() )
+        throw invalid_argument("Unable to split "+to_string(get_count())+" samples into "+to_string(k)+" folds");
+
+    // Fisher-Yates shuffle, then deal the samples to the folds in turn
+    vector<size_t> order(get_count());
+    for(size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    for(size_t i = order.size()-1; i > 0; i--)
+        swap(order[i], order[RandInt::RANDINT->below(i+1)]);
+
+    vector<vector<size_t>> ret(k);
+    for(size_t i = 0; i < order.size(); i++)
+        ret[i % k].push_back(order[i]);
+    for(vector<size_t>& fold : ret)
+        sort(fold.begin(), fold.end());
+
+    return ret;
+}
+
 /**
  * Output DataSet state
  * 
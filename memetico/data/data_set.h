@@ -21,6 +21,59 @@
 using namespace cusr;
 using namespace filesystem;
 
+/**
+ * @brief Finite difference weights for one derivative order packed as a banded sparse matrix
+ * 
+ * Row i approximates the derivative at sample i from the contiguous samples [start[i], start[i]+width(i)),
+ * with the weights of all rows stored back to back so that applying the stencil is a single banded mat-vec
+ */
+struct FDStencil {
+
+    /** First sample index in the band of each row */
+    vector<size_t>  start;
+
+    /** Offset of each row into weights, with a trailing entry so offset[i+1]-offset[i] is the width of row i */
+    vector<size_t>  offset = {0};
+
+    /** Packed row weights */
+    vector<double>  weights;
+
+    /** @brief Return number of rows, i.e. samples */
+    size_t          rows() const                { return start.size(); };
+
+    /** @brief Return number of samples in the band of row i */
+    size_t          width(size_t i) const       { return offset[i+1]-offset[i]; };
+
+    /** @brief Return pointer to the weights of row i */
+    const double*   row(size_t i) const         { return weights.data()+offset[i]; };
+
+    /** @brief Append row for sample band starting at first with weights w */
+    void            add_row(size_t first, const vector<double>& w) {
+        start.push_back(first);
+        weights.insert(weights.end(), w.begin(), w.end());
+        offset.push_back(weights.size());
+    };
+
+    /** @brief Return the derivative at sample i given f indexed by sample */
+    double          apply_row(size_t i, const double* f) const {
+        const double* w = row(i);
+        const double* v = f+start[i];
+        size_t n = width(i);
+        double sum = 0;
+        #pragma omp simd reduction(+:sum)
+        for(size_t j = 0; j < n; j++)
+            sum += w[j]*v[j];
+        return sum;
+    };
+
+    /** @brief Banded mat-vec out = W*f for all rows */
+    void            apply(const double* f, double* out) const {
+        for(size_t i = 0; i < rows(); i++)
+            out[i] = apply_row(i, f);
+    };
+
+};
+
 /**
  * Class representing a set of data samples
  */
@@ -67,6 +120,9 @@ class DataSet {
         /** Weight values for samples */
         vector<double>          weight;
 
+        /** Independent variable values in float by column, columns_float[j][i] is variable j of sample i, see setup_float() */
+        vector<vector<float>>   columns_float;
+
         /** Uncertainty values for samples  */
         vector<double>          dy;
 
@@ -80,11 +136,8 @@ class DataSet {
         /** Maximum derivative value for the 0th, 1st, 2nd etc. */
         vector<double> yder_max;
 
-        /** Finite Difference weights */
-        vector<vector<vector<double>>> fd_weights;
-        // fd_weights[0] stores weights for 1st order derivative
-        // fd_weights[1] stores weights for 2nd order derivative
-        // and so on...
+        /** Finite Difference stencils, fd_stencils[0] for the 1st order derivative, fd_stencils[1] the 2nd and so on */
+        vector<FDStencil> fd_stencils;
 
         /** Names of the independent varaibles */
         static vector<string>   IVS;
@@ -98,6 +151,9 @@ class DataSet {
         /** @brief Return if GPU is being used */
         bool get_gpu()          {return gpu;};
 
+        /** @brief Return if float columns match the samples */
+        bool has_float()        { return get_count() > 0 && columns_float.size() == IVS.size() && (IVS.empty() || columns_float[0].size() == get_count()); }
+
         /** @brief Return if all samples have weight */
         bool has_weight()       { return weight.size() == get_count();}
 
@@ -116,8 +172,19 @@ class DataSet {
         /** @brief Get indexes for a percentage of the DataSet uniformly and at random */
         vector<size_t> subset(float pct, bool to_GPU = true);
 
+        /** @brief Split the sample indexes uniformly at random into \a k folds, sizes differing by at most one */
+        vector<vector<size_t>> folds(size_t k);
+
         // GPU specific 
 
+        /** @brief Build columns_float for single and mixed precision evaluation */
+        void setup_float() {
+            columns_float.assign(IVS.size(), vector<float>(samples.size()));
+            for(size_t i = 0; i < samples.size(); i++)
+                for(size_t j = 0; j < IVS.size(); j++)
+                    columns_float[j][i] = samples[i][j];
+        }
+
         /** @brief GPU dataset for use in cuda.cuh */
         GPUDataset device_data;
 
@@ -220,148 +287,47 @@ class DataSet {
         }
 
         /**
-         * @brief Compute finite difference weights for Fornberg method
+         * @brief Compute approximate derivatives of y with the Fornberg method
          * 
-         * The function \f$f(x)\f$ is approximated at point \f$x_0\f$ using a set of points n+1 \f$\{x_i\}\f$ around \f$x_0\f$
-         * This is done for any order derivative m.
+         * The derivative of order k at sample i uses the samples within [i-h, i+h] clipped to the data, where h is 
+         * the larger of k and half_width. Weights for each order are packed into fd_stencils once so that objective::fornberg
+         * can apply them to model predictions as a banded mat-vec. 
+         * !!! WE HAVE TO NORMALISE AFTER calling this function
          * 
+         * @param mdo maximum derivative order
+         * @param half_width samples either side of the point to include in each stencil, 0 to use the derivative order
          */
-        void compute_app_der(size_t mdo) {
+        void compute_app_der(size_t mdo, size_t half_width = 0) {
 
-            // computes the approximate 1st order derivative
-            // !!! WE HAVE TO NORMALISE AFTER calling this function
-            
             Yder.clear();
             yder_min.clear();
             yder_max.clear();
-            fd_weights.clear();
-            vector<vector<double>> weights;
+            fd_stencils.clear();
 
-            // 1st derivatives
-            if(mdo>=1) {
-
-                Yder.push_back({});
-                yder_min.push_back(0.0);
-                yder_max.push_back(1.0);
-                fd_weights.push_back({});
-
-                // first interval [samples[0], samples[1]]
-                weights = compute_FD_weights(1, {samples[0], samples[1]}, samples[0][0]);
-                fd_weights[0].push_back(weights[1]);
-                Yder[0].push_back( weights[1][0]*y[0] + weights[1][1]*y[1] );
-                weights.clear();
-
-                // intermediate intervals
-                for(size_t i = 1; i < y.size()-1; i++){
-                    weights = compute_FD_weights(1, {samples[i-1], samples[i], samples[i+1]}, samples[i][0]);
-                    fd_weights[0].push_back(weights[1]);
-                    Yder[0].push_back( weights[1][0]*y[i-1] + weights[1][1]*y[i] + weights[1][2]*y[i+1] );
-                    weights.clear();
-                }
+            size_t n = y.size();
+            vector<vector<double>> window;
 
-                // last interval [samples[-2], samples[-1]]
-                weights = compute_FD_weights(1, {samples[y.size()-2], samples[y.size()-1]}, samples[y.size()-1][0]);
-                fd_weights[0].push_back(weights[1]);
-                Yder[0].push_back( weights[1][0]*y[y.size()-2] + weights[1][1]*y[y.size()-1] );
-                weights.clear();
+            for(size_t k = 1; k <= mdo; k++) {
 
-            }
-
-
-            // 2nd derivatives
-            if(mdo>=2) {
-
-                Yder.push_back({});
-                yder_min.push_back(0.0);
-                yder_max.push_back(1.0);
-                fd_weights.push_back({});
-
-                // first interval [samples[0], samples[1], samples[2]]
-                weights = compute_FD_weights(2, {samples[0], samples[1], samples[2]}, samples[0][0]);
-                fd_weights[1].push_back(weights[2]);
-                Yder[1].push_back( weights[2][0]*y[0] + weights[2][1]*y[1] + weights[2][2]*y[2] );
-                weights.clear();
-
-                // second interval [samples[0], samples[1], samples[2], samples[3]]
-                weights = compute_FD_weights(2, {samples[0], samples[1], samples[2], samples[3]}, samples[1][0]);
-                fd_weights[1].push_back(weights[2]);
-                Yder[1].push_back( weights[2][0]*y[0] + weights[2][1]*y[1] + weights[2][2]*y[2] + weights[2][3]*y[3] );
-                weights.clear();
-
-                // intermediate intervals
-                for(size_t i = 2; i < y.size()-2; i++){
-                    weights = compute_FD_weights(2, {samples[i-2], samples[i-1], samples[i], samples[i+1], samples[i+2]}, samples[i][0]);
-                    fd_weights[1].push_back(weights[2]);
-                    Yder[1].push_back( weights[2][0]*y[i-2] + weights[2][1]*y[i-1] + weights[2][2]*y[i] + weights[2][3]*y[i+1] + weights[2][4]*y[i+2] );
-                    weights.clear();
+                if( n < k+1 ) {
+                    cout << "[data_set.h] size of samples insufficient" << endl;
+                    throw std::logic_error("size of samples insufficient");
                 }
 
-                // interval [samples[-4], samples[-3], samples[-2], samples[-1]]
-                weights = compute_FD_weights(2, {samples[y.size()-4], samples[y.size()-3], samples[y.size()-2], samples[y.size()-1]}, samples[y.size()-2][0]);
-                fd_weights[1].push_back(weights[2]);
-                Yder[1].push_back( weights[2][0]*y[y.size()-4] + weights[2][1]*y[y.size()-3] + weights[2][2]*y[y.size()-2] + weights[2][3]*y[y.size()-1] );
-                weights.clear();
-
-                // interval [samples[-3], samples[-2], samples[-1]]
-                weights = compute_FD_weights(2, {samples[y.size()-3], samples[y.size()-2], samples[y.size()-1]}, samples[y.size()-1][0]);
-                fd_weights[1].push_back(weights[2]);
-                Yder[1].push_back( weights[2][0]*y[y.size()-3] + weights[2][1]*y[y.size()-2] + weights[2][2]*y[y.size()-1] );
-                weights.clear();
-
-            }
-
-            // 3rd derivatives
-            if(mdo>=3) {
+                size_t h = max(k, half_width);
+                FDStencil stencil;
+                for(size_t i = 0; i < n; i++) {
+                    size_t first = i >= h ? i-h : 0;
+                    size_t last = min(n-1, i+h);
+                    window.assign(samples.begin()+first, samples.begin()+last+1);
+                    stencil.add_row(first, compute_FD_weights(k, window, samples[i][0])[k]);
+                }
+                fd_stencils.push_back(stencil);
 
-                Yder.push_back({});
+                Yder.push_back(vector<double>(n));
+                fd_stencils.back().apply(y.data(), Yder.back().data());
                 yder_min.push_back(0.0);
                 yder_max.push_back(1.0);
-                fd_weights.push_back({});
-
-                // first interval samples[0], samples[1], samples[2], samples[3]
-                weights = compute_FD_weights(3, {samples[0], samples[1], samples[2], samples[3]}, samples[0][0]);
-                fd_weights[2].push_back(weights[3]);
-                Yder[2].push_back( weights[3][0]*y[0] + weights[3][1]*y[1] + weights[3][2]*y[2] + weights[3][3]*y[3] );
-                weights.clear();
-
-                // second interval samples[0], samples[1], samples[2], samples[3], samples[4]
-                weights = compute_FD_weights(3, {samples[0], samples[1], samples[2], samples[3], samples[4]}, samples[1][0]);
-                fd_weights[2].push_back(weights[3]);
-                Yder[2].push_back( weights[3][0]*y[0] + weights[3][1]*y[1] + weights[3][2]*y[2] + weights[3][3]*y[3] + weights[3][4]*y[4] );
-                weights.clear();
-
-                // third interval samples[0], samples[1], samples[2], samples[3], samples[4], samples[5]
-                weights = compute_FD_weights(3, {samples[0], samples[1], samples[2], samples[3], samples[4], samples[5]}, samples[2][0]);
-                fd_weights[2].push_back(weights[3]);
-                Yder[2].push_back( weights[3][0]*y[0] + weights[3][1]*y[1] + weights[3][2]*y[2] + weights[3][3]*y[3] + weights[3][4]*y[4] + weights[3][5]*y[5] );
-                weights.clear();
-
-                // intermediate intervals
-                for(size_t i = 3; i < y.size()-3; i++){
-                    weights = compute_FD_weights(3, {samples[i-3], samples[i-2], samples[i-1], samples[i], samples[i+1], samples[i+2], samples[i+3]}, samples[i][0]);
-                    fd_weights[2].push_back(weights[3]);
-                    Yder[2].push_back( weights[3][0]*y[i-3] + weights[3][1]*y[i-2] + weights[3][2]*y[i-1] + weights[3][3]*y[i] + weights[3][4]*y[i+1] + weights[3][5]*y[i+2] + weights[3][6]*y[i+3] );
-                    weights.clear();
-                }
-
-                // interval samples[-6], samples[-5], samples[-4], samples[-3], samples[-2], samples[-1]
-                weights = compute_FD_weights(3, {samples[y.size()-6], samples[y.size()-5], samples[y.size()-4], samples[y.size()-3], samples[y.size()-2], samples[y.size()-1]}, samples[y.size()-3][0]);
-                fd_weights[2].push_back(weights[3]);
-                Yder[2].push_back( weights[3][0]*y[y.size()-6] + weights[3][1]*y[y.size()-5] + weights[3][2]*y[y.size()-4] + weights[3][3]*y[y.size()-3] + weights[3][4]*y[y.size()-2] + weights[3][5]*y[y.size()-1 ]);
-                weights.clear();
-
-                // interval samples[-5], samples[-4], samples[-3], samples[-2], samples[-1]
-                weights = compute_FD_weights(3, {samples[y.size()-5], samples[y.size()-4], samples[y.size()-3], samples[y.size()-2], samples[y.size()-1]}, samples[y.size()-2][0]);
-                fd_weights[2].push_back(weights[3]);
-                Yder[2].push_back( weights[3][0]*y[y.size()-5] + weights[3][1]*y[y.size()-4] + weights[3][2]*y[y.size()-3] + weights[3][3]*y[y.size()-2] + weights[3][4]*y[y.size()-1] );
-                weights.clear();
-
-                // interval samples[-4], samples[-3], samples[-2], samples[-1]
-                weights = compute_FD_weights(3, {samples[y.size()-4], samples[y.size()-3], samples[y.size()-2], samples[y.size()-1]}, samples[y.size()-1][0]);
-                fd_weights[2].push_back(weights[3]);
-                Yder[2].push_back( weights[3][0]*y[y.size()-4] + weights[3][1]*y[y.size()-3] + weights[3][2]*y[y.size()-2] + weights[3][3]*y[y.size()-1] );
-                weights.clear();
-
             }
 
         }
@@ -14,6 +14,36 @@ TEST_CASE("DataSet: ") {
 
 }
 
+TEST_CASE("folds() ") {
+
+    RandInt ri = RandInt(42);
+    RandInt::RANDINT = &ri;
+
+    DataSet ds = DataSet("test_data.csv");
+    ds.y.assign(23, 0);
+
+    // 1. Every sample is in exactly one fold, fold sizes differ by at most one
+    vector<vector<size_t>> folds = ds.folds(5);
+    REQUIRE( folds.size() == 5 );
+    vector<size_t> seen(23, 0);
+    for(vector<size_t>& fold : folds) {
+        CHECK( fold.size() >= 4 );
+        CHECK( fold.size() <= 5 );
+        CHECK( is_sorted(fold.begin(), fold.end()) );
+        for(size_t i : fold)
+            seen[i]++;
+    }
+    CHECK( seen == vector<size_t>(23, 1) );
+
+    // 2. Folds are shuffled rather than contiguous
+    CHECK( folds[0] != vector<size_t>({0, 1, 2, 3, 4}) );
+
+    // 3. Impossible splits are rejected
+    CHECK_THROWS_AS( ds.folds(1), invalid_argument );
+    CHECK_THROWS_AS( ds.folds(24), invalid_argument );
+
+}
+
 TEST_CASE("load() ") {
 
     // Tests
@@ -642,4 +672,60 @@ TEST_CASE(" normalise() ") {
         CHECK( ds2.Yder[2][i] == doctest::Approx(norm[i][3]).epsilon(1e-15) );
     }
 
-}
\ No newline at end of file
+}
+TEST_CASE(" compute_app_der() ") {
+
+    // y = x^2 - 3x on unevenly spaced x, so 1st and 2nd order stencils are exact
+    string fn("test_data.csv");
+    ofstream f;
+    f.open(fn);
+    if (!f.is_open())
+        throw runtime_error("Unable to open file "+ fn);
+
+    vector<double> x = {0.1, 0.25, 0.3, 0.5, 0.55, 0.7, 0.9, 1.0, 1.2, 1.25, 1.4};
+    f << "y,x" << endl;
+    f << setprecision(17);
+    for(double v : x)
+        f << v*v-3*v << "," << v << endl;
+    f.close();
+
+    DataSet ds = DataSet(fn);
+    ds.load();
+
+    // 1. Stencil bands follow [i-k, i+k] clipped to the data
+    ds.compute_app_der(3);
+    REQUIRE( ds.fd_stencils.size() == 3 );
+    REQUIRE( ds.Yder.size() == 3 );
+    FDStencil& s2 = ds.fd_stencils[1];
+    REQUIRE( s2.rows() == x.size() );
+    CHECK( s2.start[0] == 0 );
+    CHECK( s2.width(0) == 3 );
+    CHECK( s2.start[1] == 0 );
+    CHECK( s2.width(1) == 4 );
+    CHECK( s2.start[5] == 3 );
+    CHECK( s2.width(5) == 5 );
+    CHECK( s2.start[x.size()-1] == x.size()-3 );
+    CHECK( s2.width(x.size()-1) == 3 );
+
+    // 2. Derivatives of the quadratic are exact, except for the two point 1st order stencils at the ends
+    CHECK( ds.Yder[0][0] == doctest::Approx(x[0]+x[1]-3) );
+    for(size_t i = 0; i < x.size(); i++) {
+        if( i > 0 && i < x.size()-1 )
+            CHECK( ds.Yder[0][i] == doctest::Approx(2*x[i]-3) );
+        CHECK( ds.Yder[1][i] == doctest::Approx(2) );
+        CHECK( ds.Yder[2][i] == doctest::Approx(0).epsilon(1e-6) );
+    }
+
+    // 3. Wider stencils
+    ds.compute_app_der(2, 4);
+    REQUIRE( ds.fd_stencils.size() == 2 );
+    CHECK( ds.fd_stencils[0].width(0) == 5 );
+    CHECK( ds.fd_stencils[0].width(5) == 9 );
+    for(size_t i = 0; i < x.size(); i++) {
+        CHECK( ds.Yder[0][i] == doctest::Approx(2*x[i]-3) );
+        CHECK( ds.Yder[1][i] == doctest::Approx(2) );
+    }
+
+    remove(fn.c_str());
+
+}
@@ -0,0 +1,82 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Definitions of the global variables shared by the memetico executables
+ * 
+ */
+
+#include <memetico/globals.h>
+#include <fstream>
+
+using namespace std;
+using namespace meme;
+
+// Logic Globals
+bool            meme::GPU = false;
+thread_local uint_fast32_t meme::SEED = 42;
+vector<uint_fast32_t> meme::SEEDS;
+size_t          meme::JOBS = 0;
+size_t          meme::EVOLVE_THREADS = 0;
+size_t          meme::CV = 0;
+size_t          meme::GENERATIONS = 200;
+double          meme::MUTATE_RATE = 0.2;
+size_t          meme::LOCAL_SEARCH_INTERVAL = 1;
+size_t          meme::STALE_RESET = 5;
+bool            meme::INT_ONLY = false;
+size_t          meme::LOCAL_SEARCH_RUNS = 4;
+size_t          meme::NELDER_MEAD_STALE = 10;
+size_t          meme::NELDER_MEAD_MOVES = 1500;
+thread_local double meme::NELDER_MEAD_SCALE = 1;
+bool            meme::SCHEDULE = false;
+double          meme::LOCAL_SEARCH_DATA_PCT = 0;
+double          meme::PENALTY = 0;
+thread_local size_t meme::GEN = 0;
+long int        meme::MAX_TIME = 10*60;
+thread_local long int meme::RUN_TIME = 0;
+double          meme::EPSILON = 0;
+bool            meme::JIT = false;
+string          meme::JIT_DIR = "";
+size_t          meme::CHECKPOINT = 0;
+bool            meme::RESUME = false;
+string          meme::TELEMETRY = "";
+bool            meme::VERBOSE = false;
+string          meme::PREDICT = "";
+string          meme::PREDICT_OUT = "";
+size_t          meme::PREDICT_DERS = 0;
+
+size_t          meme::DEPTH = 4;
+thread_local size_t meme::POCKET_DEPTH = 1;
+size_t          meme::DIVERSITY_COUNT = 3;
+
+// Derivative Globals
+size_t          meme::IFR = 0;
+string          meme::IN_DER = "exact";
+thread_local size_t meme::MAX_DER_ORD = 3;
+
+DynamicDepthType meme::DYNAMIC_DEPTH_TYPE = DynamicNone;
+size_t          meme::DEPTH_STRATA = 0;
+thread_local size_t meme::DEPTH_LOW = 0;
+thread_local size_t meme::DEPTH_HIGH = numeric_limits<size_t>::max();
+PrecisionType   meme::PRECISION = PrecisionDouble;
+
+// File Globals
+string          meme::TRAIN_FILE = "sinx.csv";
+string          meme::TEST_FILE = "sinx.csv";
+string          meme::VALID_FILE = "";
+size_t          meme::PATIENCE = 0;
+string          meme::LOG_DIR = "out/";
+ofstream        meme::master_log;
+
+// Technical Globals
+size_t          meme::PREC = 18;
+bool            meme::DEBUG = false;
+
+// Global Heplers
+thread_local RandReal meme::RANDREAL;
+thread_local RandInt meme::RANDINT;
+
+// Local Helpers
+FILE*           meme::STD_OUT;
+FILE*           meme::STD_ERR;
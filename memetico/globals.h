@@ -14,6 +14,7 @@
 #include <chrono>
 #include <memetico/helpers/rng.h>
 #include <regex>
+#include <vector>
 
 /**
  * @brief Capture similarity data between two solutions and provide < operator
@@ -40,8 +41,20 @@ namespace meme {
     /** Flag to use GPU */
     extern bool             GPU;
 
-    /** Program seed value for reproducibility */
-    extern uint_fast32_t    SEED;
+    /** Seed value of the run on this thread for reproducibility, see SEEDS */
+    extern thread_local uint_fast32_t   SEED;
+
+    /** Seeds of a batch run sharing the loaded data in one process, empty for a single run of SEED */
+    extern vector<uint_fast32_t>        SEEDS;
+
+    /** Number of batch seeds or cross validation folds run concurrently, 0 for all cores */
+    extern size_t           JOBS;
+
+    /** Threads evolving the subtrees below the root of a population as tasks, 0 to evolve on the run thread only */
+    extern size_t           EVOLVE_THREADS;
+
+    /** Number of cross validation folds of the training data, 0 for a single run on all of it */
+    extern size_t           CV;
 
     /** Number of generations of evolution  */
     extern size_t           GENERATIONS;
@@ -67,6 +80,12 @@ namespace meme {
     /** Mumber of iterations of the Neader-Mead  */
     extern size_t           NELDER_MEAD_MOVES;
 
+    /** Fraction of NELDER_MEAD_MOVES searches on this thread may use, lowered by schedule::Scheduler */
+    extern thread_local double NELDER_MEAD_SCALE;
+
+    /** Adapt local search effort to the remaining MAX_TIME, see schedule::Scheduler */
+    extern bool             SCHEDULE;
+
     /** Numnber of stagnant generates to re-randomise the currents */
     extern size_t           STALE_RESET;
 
@@ -79,14 +98,20 @@ namespace meme {
     /** File where data resides */
     extern string           TEST_FILE;
 
+    /** Validation data file, empty for no validation, see Population::set_validation() */
+    extern string           VALID_FILE;
+
+    /** Stop after this many generations without a better validation fitness, 0 to run on */
+    extern size_t           PATIENCE;
+
     /** Output folder */
     extern string           LOG_DIR;
 
-    /** Global double randomisation object */
-    extern RandReal         RANDREAL;
+    /** Global double randomisation object of the run on this thread */
+    extern thread_local RandReal    RANDREAL;
 
-    /** Global integer randomisation object */
-    extern RandInt          RANDINT;
+    /** Global integer randomisation object of the run on this thread */
+    extern thread_local RandInt     RANDINT;
 
     /** Global real precision within the application */
     extern size_t           PREC; 
@@ -94,18 +119,45 @@ namespace meme {
     /** Global DEBUG flag for function tracing */
     extern bool             DEBUG;
 
-    /** Global Current Generation */
-    extern size_t           GEN;
+    /** Current generation of the run on this thread */
+    extern thread_local size_t      GEN;
 
     /** Maximum number of seconds the program can run for */
     extern long int         MAX_TIME;
 
-    /** Run time of program */
-    extern long int         RUN_TIME;
+    /** Run time of the run on this thread */
+    extern thread_local long int    RUN_TIME;
 
     /** Threshold for found solution */
     extern double           EPSILON;
 
+    /** Compile models to native code for local search, see jit::compile() */
+    extern bool             JIT;
+
+    /** Directory of compiled model objects, reused across runs and kept private to the user, empty for jit::default_dir() */
+    extern string           JIT_DIR;
+
+    /** Write a checkpoint every this many generations, 0 to disable, see Population::checkpoint() */
+    extern size_t           CHECKPOINT;
+
+    /** Resume from the checkpoint in LOG_DIR when one exists */
+    extern bool             RESUME;
+
+    /** Format of the per generation telemetry log, jsonl or bin, empty to disable, see telemetry::Log */
+    extern string           TELEMETRY;
+
+    /** Print a line per generation to stdout */
+    extern bool             VERBOSE;
+
+    /** Model file to predict TRAIN_FILE with instead of training, see predict::Predictor */
+    extern string           PREDICT;
+
+    /** Prediction output file, .bin for binary */
+    extern string           PREDICT_OUT;
+
+    /** Highest derivative order written with predictions */
+    extern size_t           PREDICT_DERS;
+
     extern bool             DEBUG;
 
     /** Master log */
@@ -116,8 +168,8 @@ namespace meme {
 
     // Custom Globals
 
-    /* Current Pocket Depth for Adaptive fraction */
-    extern size_t           POCKET_DEPTH;
+    /* Current Pocket Depth for Adaptive fraction, of the run on this thread */
+    extern thread_local size_t      POCKET_DEPTH;
 
     extern size_t           DEPTH;
 
@@ -135,6 +187,28 @@ namespace meme {
 
     extern DynamicDepthType DYNAMIC_DEPTH_TYPE;
 
+    /** Number of depth stratified sub-populations, see Strata, 0 for a single population */
+    extern size_t           DEPTH_STRATA;
+
+    /** Lowest fraction depth of models constructed on this thread, set per stratum by Strata */
+    extern thread_local size_t      DEPTH_LOW;
+
+    /** Highest fraction depth of models constructed on this thread, set per stratum by Strata */
+    extern thread_local size_t      DEPTH_HIGH;
+
+    /**
+     * @brief Arithmetic precision of CPU model evaluation
+     * - PrecisionFloat evaluates in float over DataSet::columns_float
+     * - PrecisionMixed screens in float and re-scores in double when a result could beat the screening threshold
+     */
+    enum PrecisionType {
+        PrecisionDouble,
+        PrecisionFloat,
+        PrecisionMixed
+    };
+
+    extern PrecisionType    PRECISION;
+
     // Define the template strucutre of a model
     template<
         typename T,         
@@ -150,8 +224,8 @@ namespace meme {
     
     // Derivative Globals
 
-    /** Maximum derivative order */
-    extern size_t           MAX_DER_ORD;
+    /** Maximum derivative order, of the run on this thread as a run zeroes it to report scores without derivatives */
+    extern thread_local size_t      MAX_DER_ORD;
         
     /** Input derivative mode */
     extern string           IN_DER;
@@ -84,6 +84,7 @@ namespace cusr {
 
     __constant__ float d_nodeValue[MAX_PREFIX_LEN];
     __constant__ float d_nodeType[MAX_PREFIX_LEN];
+    __constant__ float d_nodeArg[MAX_PREFIX_LEN];       // COEF variable, LINTERM constant or CFSTEP index
 
 #define S_OFF THREAD_PER_BLOCK * (CUSR_DEPTH + 1) * blockIdx.x + top * THREAD_PER_BLOCK + threadIdx.x
 
@@ -107,13 +108,49 @@ namespace cusr {
 
             int top = 0;
 
+            // registers for fused opcodes, the LINTERM accumulator and Lentz C and D of CFSTEP
+            float lin = 0;
+            float C = 0;
+            float D = 0;
+
             // do stack operation according to the type of each node
             for (int i = len - 1; i >= 0; i--) {
 
                 int node_type = d_nodeType[i];
                 float node_value = d_nodeValue[i];
 
-                if (node_type == NodeType::CONST) {
+                if (node_type == NodeType::COEF) {
+                    int var_num = d_nodeArg[i];
+
+                    if( is_subset) {
+                        lin += node_value * ((float *) ((char *) ds + var_num * dsPitch))[idxs[dataset_no]];
+                    } else {
+                        lin += node_value * ((float *) ((char *) ds + var_num * dsPitch))[dataset_no];
+                    }
+
+                } else if (node_type == NodeType::NFUNC) {
+                    int function = node_value;
+
+                    if (function == Function::LINTERM) {
+                        stack[S_OFF] = lin + d_nodeArg[i];
+                        top++;
+                        lin = 0;
+                    } else if (function == Function::CFSTEP) {
+                        bool init = d_nodeArg[i] == 0;
+                        float a = 0;
+                        float b = 0;
+                        if (!init) {
+                            top--;
+                            a = stack[S_OFF];
+                            top--;
+                            b = stack[S_OFF];
+                        }
+                        top--;
+                        cf_step<float>(init, a, b, stack[S_OFF], C, D);
+                        top++;
+                    }
+
+                } else if (node_type == NodeType::CONST) {
                     stack[S_OFF] = node_value;
                     top++;
                 } else if (node_type == NodeType::VAR) {
@@ -317,6 +354,7 @@ namespace cusr {
         // -------- copy to constant memory --------
         float h_nodeValue[MAX_PREFIX_LEN];
         float h_nodeType[MAX_PREFIX_LEN];
+        float h_nodeArg[MAX_PREFIX_LEN] = {0};
 
         for (int i = 0; i < program.length; i++) {
             int type = program.prefix[i].node_type;
@@ -325,6 +363,15 @@ namespace cusr {
                 h_nodeValue[i] = program.prefix[i].constant;
             } else if (type == NodeType::VAR) {
                 h_nodeValue[i] = program.prefix[i].variable;
+            } else if (type == NodeType::COEF) {
+                h_nodeValue[i] = program.prefix[i].constant;
+                h_nodeArg[i] = program.prefix[i].variable;
+            } else if (type == NodeType::NFUNC) {
+                h_nodeValue[i] = program.prefix[i].function;
+                if (program.prefix[i].function == Function::LINTERM)
+                    h_nodeArg[i] = program.prefix[i].constant;
+                else
+                    h_nodeArg[i] = program.prefix[i].variable;
             } else { // unary function or binary function
                 h_nodeValue[i] = program.prefix[i].function;
             }
@@ -332,6 +379,7 @@ namespace cusr {
 
         cudaMemcpyToSymbol(d_nodeValue, h_nodeValue, sizeof(float) * program.length);
         cudaMemcpyToSymbol(d_nodeType, h_nodeType, sizeof(float) * program.length);
+        cudaMemcpyToSymbol(d_nodeArg, h_nodeArg, sizeof(float) * program.length);
 
         int size;
         if( dataset.subset_size > 0 )
@@ -14,6 +14,7 @@
 #include <memetico/globals.h>
 #include <memetico/gpu/gpu_dataset.h>
 #include <memetico/gpu/tree_node.h>
+#include <memetico/gpu/interpreter.h>
 
 #define THREAD_PER_BLOCK 512
 #define MAX_PREFIX_LEN 2048
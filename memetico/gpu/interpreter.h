@@ -0,0 +1,172 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Host interpreter for cusr prefix programs, mirroring the calFitnessGPU kernel so programs are testable without a GPU
+ */
+
+#ifndef CUSR_INTERPRETER_H
+#define CUSR_INTERPRETER_H
+
+// Std
+#include <vector>
+#include <stack>
+#include <string>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+// Local
+#include <memetico/gpu/tree_node.h>
+
+#ifdef __CUDACC__
+#define CUSR_HD __host__ __device__
+#else
+#define CUSR_HD
+#endif
+
+/** Guard for division by ~0 in DIV and INV, matches cuda.cuh */
+#ifndef DELTA
+#define DELTA 0.01f
+#endif
+
+/** Tiny value substituted for ~0 denominators in CFSTEP, matches ContinuedFraction::evaluate() */
+#define CFSTEP_TINY 1.0e-30
+
+namespace cusr {
+
+    /**
+     * @brief Modified Lentz step shared by the kernel and host interpreter
+     * - On the first step (init) f is the leading term g0 and C = f, D = 0
+     * - Otherwise \f$D = b + aD\f$, \f$C = b + a/C\f$, \f$f = f C/D\f$ for numerator a and denominator b
+     *
+     * @param init true for the leading term, where a and b are ignored
+     * @param a numerator term h_{j-1}
+     * @param b denominator term g_j
+     * @param f current approximation, updated in place
+     * @param C Lentz C state, updated in place
+     * @param D Lentz D state, updated in place
+     */
+    template <typename T>
+    CUSR_HD inline void cf_step(bool init, T a, T b, T& f, T& C, T& D) {
+
+        if( init ) {
+            if( fabs(f) < (T) CFSTEP_TINY ) f = (T) CFSTEP_TINY;
+            C = f;
+            D = 0;
+            return;
+        }
+
+        D = b + a*D;
+        if( fabs(D) < (T) CFSTEP_TINY ) D = (T) CFSTEP_TINY;
+
+        C = b + a/C;
+        if( fabs(C) < (T) CFSTEP_TINY ) C = (T) CFSTEP_TINY;
+
+        D = 1/D;
+        f = f*(D*C);
+    }
+
+    /**
+     * @brief Evaluate a prefix program at a single sample, equivalent to one thread of calFitnessGPU
+     * - Nodes are processed right to left on a value stack
+     * - COEF nodes accumulate into a register that the enclosing LINTERM pushes with its constant
+     * - CFSTEP keeps the Lentz C and D in registers so only f lives on the stack
+     *
+     * @tparam T arithmetic type, float reproduces the kernel
+     * @param prefix program to evaluate
+     * @param values sample values indexed by variable number
+     * @return the single value left on the stack
+     */
+    template <typename T>
+    T interpret(const prefix_t& prefix, const vector<double>& values) {
+
+        vector<T> stack;
+        T lin = 0;
+        T C = 0;
+        T D = 0;
+
+        for(int i = (int) prefix.size() - 1; i >= 0; i--) {
+
+            const Node& node = prefix[i];
+
+            if( node.node_type == NodeType::CONST ) {
+                stack.push_back((T) node.constant);
+
+            } else if( node.node_type == NodeType::VAR ) {
+                stack.push_back((T) values[node.variable]);
+
+            } else if( node.node_type == NodeType::COEF ) {
+                lin += (T) node.constant * (T) values[node.variable];
+
+            } else if( node.node_type == NodeType::NFUNC ) {
+
+                if( node.function == Function::LINTERM ) {
+                    stack.push_back(lin + (T) node.constant);
+                    lin = 0;
+                } else if( node.function == Function::CFSTEP ) {
+                    bool init = node.variable == 0;
+                    T a = 0;
+                    T b = 0;
+                    if( !init ) {
+                        a = stack.back(); stack.pop_back();
+                        b = stack.back(); stack.pop_back();
+                    }
+                    cf_step<T>(init, a, b, stack.back(), C, D);
+                }
+
+            } else if( node.node_type == NodeType::UFUNC ) {
+
+                T var1 = stack.back();
+                if( node.function == Function::SIN )        var1 = sin(var1);
+                else if( node.function == Function::COS )   var1 = cos(var1);
+                else if( node.function == Function::TAN )   var1 = tan(var1);
+                else if( node.function == Function::LOG )   var1 = var1 <= 0 ? -1 : log(var1);
+                else if( node.function == Function::INV )   var1 = 1 / (var1 == 0 ? (T) DELTA : var1);
+                stack.back() = var1;
+
+            } else {
+
+                T var1 = stack.back(); stack.pop_back();
+                T var2 = stack.back();
+                if( node.function == Function::ADD )        var1 = var1 + var2;
+                else if( node.function == Function::SUB )   var1 = var1 - var2;
+                else if( node.function == Function::MUL )   var1 = var1 * var2;
+                else if( node.function == Function::DIV )   var1 = var1 / (var2 == 0 ? (T) DELTA : var2);
+                else if( node.function == Function::MAX )   var1 = var1 >= var2 ? var1 : var2;
+                else if( node.function == Function::MIN )   var1 = var1 <= var2 ? var1 : var2;
+                stack.back() = var1;
+            }
+        }
+
+        if( stack.size() != 1 )
+            throw runtime_error("cusr::interpret() prefix did not reduce to a single value");
+
+        return stack.back();
+    }
+
+    /** @brief Return the largest stack depth reached when evaluating \a prefix, to check against CUSR_DEPTH */
+    inline size_t stack_depth(const prefix_t& prefix) {
+
+        size_t top = 0;
+        size_t max_top = 0;
+        for(int i = (int) prefix.size() - 1; i >= 0; i--) {
+            const Node& node = prefix[i];
+            if( node.node_type == NodeType::CONST || node.node_type == NodeType::VAR )
+                top++;
+            else if( node.node_type == NodeType::NFUNC && node.function == Function::LINTERM )
+                top++;
+            else if( node.node_type == NodeType::NFUNC && node.function == Function::CFSTEP )
+                top -= node.variable == 0 ? 0 : 2;
+            else if( node.node_type == NodeType::BFUNC )
+                top--;
+            max_top = top > max_top ? top : max_top;
+        }
+        return max_top;
+    }
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+
+#include "doctest.h"
+#include <memetico/gpu/interpreter.h>
+
+using namespace cusr;
+
+inline Node make_node(ntype_t type, func_t function, double constant = 0, int variable = 0) {
+    Node n;
+    n.node_type = type;
+    n.function = function;
+    n.constant = constant;
+    n.variable = variable;
+    return n;
+}
+
+TEST_CASE("Interpreter: LINTERM and CFSTEP ") {
+
+    vector<double> values = {2, -3};
+
+    // x0 * (x1 - 4) + 1/0 guarded by DELTA
+    prefix_t p = {
+        make_node(BFUNC, ADD), make_node(BFUNC, MUL), make_node(VAR, ADD, 0, 0),
+        make_node(BFUNC, SUB), make_node(VAR, ADD, 0, 1), make_node(CONST, ADD, 4),
+        make_node(UFUNC, INV), make_node(CONST, ADD, 0)
+    };
+    CHECK( interpret<double>(p, values) == doctest::Approx(2*(-3-4) + 1/DELTA) );
+    CHECK( stack_depth(p) == 3 );
+
+    // 3x0 - x1 + 0.5
+    prefix_t lin = { make_node(NFUNC, LINTERM, 0.5), make_node(COEF, ADD, 3, 0), make_node(COEF, ADD, -1, 1) };
+    CHECK( interpret<double>(lin, values) == doctest::Approx(9.5) );
+    CHECK( stack_depth(lin) == 1 );
+
+    // 1 + 2/(3 + 4/5) from CFSTEP_2 4 5 CFSTEP_1 2 3 CFSTEP_0 1
+    prefix_t cf = {
+        make_node(NFUNC, CFSTEP, 0, 2), make_node(NFUNC, LINTERM, 4), make_node(NFUNC, LINTERM, 5),
+        make_node(NFUNC, CFSTEP, 0, 1), make_node(NFUNC, LINTERM, 2), make_node(NFUNC, LINTERM, 3),
+        make_node(NFUNC, CFSTEP, 0, 0), make_node(NFUNC, LINTERM, 1)
+    };
+    CHECK( interpret<double>(cf, values) == doctest::Approx(1 + 2/(3 + 4.0/5)) );
+    CHECK( interpret<float>(cf, values) == doctest::Approx(1 + 2/(3 + 4.0/5)) );
+    CHECK( stack_depth(cf) == 3 );
+    CHECK( prefix_to_infix(cf) == "(1.000000) + (2.000000)/((3.000000) + (4.000000)/((5.000000)))" );
+
+    // Unbalanced programs are rejected
+    prefix_t bad = { make_node(CONST, ADD, 1), make_node(CONST, ADD, 2) };
+    CHECK_THROWS( interpret<double>(bad, values) );
+
+}
@@ -18,7 +18,9 @@ namespace cusr {
         VAR,        // variable
         CONST,      // constant
         UFUNC,      // unary function
-        BFUNC       // binary function
+        BFUNC,      // binary function
+        NFUNC,      // fused function, see LINTERM and CFSTEP
+        COEF        // coefficient and variable pair accumulated by the enclosing LINTERM, pushes nothing
     } ntype_t;
 
     /** For Nodes of a function NodeType, what operation is applied to their child (uniary) or childs (binary) */
@@ -33,7 +35,9 @@ namespace cusr {
         LOG,        // arity: 1, return log a
         MAX,        // arity: 2, if (a > b) { return a } return b
         MIN,        // arity: 2, if (a < b) { return a } return b
-        INV         // arity: 1, if (a == 0) { a = DELTA } return 1 / a
+        INV,        // arity: 1, if (a == 0) { a = DELTA } return 1 / a
+        LINTERM,    // arity: 0, followed by COEF nodes, return sum(c * x[v]) + constant
+        CFSTEP      // arity: 1 when variable == 0, else 3, one modified Lentz step, see cf_step()
     } func_t;
     
     /** A Node with a NodeType and associated variable, constant or function*/
@@ -53,11 +57,16 @@ namespace cusr {
         if( lhs.node_type != rhs.node_type )        
             return false;
 
-        if( lhs.node_type == NodeType::BFUNC || lhs.node_type == NodeType::UFUNC ) {
+        if( lhs.node_type == NodeType::BFUNC || lhs.node_type == NodeType::UFUNC || lhs.node_type == NodeType::NFUNC ) {
             if( lhs.function != rhs.function )       
                 return false;
         }
 
+        if( lhs.node_type == NodeType::NFUNC || lhs.node_type == NodeType::COEF ) {
+            if( lhs.constant != rhs.constant || lhs.variable != rhs.variable )
+                return false;
+        }
+
         if( lhs.node_type == NodeType::CONST ) {
             if( lhs.constant != rhs.constant )      
                 return false;
@@ -162,6 +171,12 @@ namespace cusr {
             case Function::INV:
                 return "inv";
 
+            case Function::LINTERM:
+                return "lin";
+
+            case Function::CFSTEP:
+                return "cf";
+
             default:
                 return "error";
         }
@@ -169,9 +184,27 @@ namespace cusr {
 
     inline string prefix_to_infix(prefix_t &prefix) {
         stack<string> s;
+        string lin;
         for (int i = prefix.size() - 1; i >= 0; i--) {
             Node &node = prefix[i];
-            if (node.node_type == NodeType::CONST) {
+            if (node.node_type == NodeType::COEF) {
+                lin.append(std::to_string(node.constant)).append("*x").append(std::to_string(node.variable)).append(" + ");
+            } else if (node.node_type == NodeType::NFUNC && node.function == Function::LINTERM) {
+                s.push("(" + lin + std::to_string(node.constant) + ")");
+                lin.clear();
+            } else if (node.node_type == NodeType::NFUNC && node.function == Function::CFSTEP) {
+                if (node.variable == 0)
+                    continue;
+                string h = s.top();
+                s.pop();
+                string g = s.top();
+                s.pop();
+                string tmp = s.top().append(" + ").append(h).append("/(").append(g);
+                s.pop();
+                s.push(tmp);
+                if (i == 0)
+                    s.top().append(string(node.variable, ')'));
+            } else if (node.node_type == NodeType::CONST) {
                 s.push(std::to_string(node.constant));
             } else if (node.node_type == NodeType::VAR) {
                 string var = "x";
@@ -0,0 +1,121 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Binary stream helpers for checkpoints
+ *
+ */
+
+#ifndef MEMETICO_HELPERS_BINARY_H_
+#define MEMETICO_HELPERS_BINARY_H_
+
+// Std
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace std;
+
+/** @brief Largest length prefixed value read from a stream that cannot report the bytes it has left */
+#define BINARY_MAX_BYTES (1ULL << 30)
+
+namespace binary {
+
+    /**
+     * @brief Throw runtime_error when \a n values of \a size bytes cannot be left in \a is
+     * - Checked before allocating for a length read from the stream, so a corrupt length fails rather than allocating
+     * - Bounded by the bytes left when the stream can seek, e.g. a file, and by BINARY_MAX_BYTES otherwise
+     */
+    inline void check_length(istream& is, uint64_t n, size_t size) {
+
+        uint64_t left = BINARY_MAX_BYTES;
+        streampos at = is.tellg();
+        if( at != streampos(-1) ) {
+            is.seekg(0, ios::end);
+            streampos end = is.tellg();
+            is.seekg(at);
+            if( end != streampos(-1) )
+                left = end-at;
+        }
+
+        if( size > 0 && n > left/size )
+            throw runtime_error("binary::read() length "+to_string(n)+" exceeds the stream");
+    }
+
+    /** @brief Write the bytes of a trivially copyable value */
+    template <typename T>
+    inline void write(ostream& os, const T& val) {
+        static_assert(is_trivially_copyable<T>::value, "binary::write() requires a trivially copyable type");
+        os.write(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+
+    /** @brief Read the bytes of a trivially copyable value, throws when the stream is exhausted */
+    template <typename T>
+    inline void read(istream& is, T& val) {
+        static_assert(is_trivially_copyable<T>::value, "binary::read() requires a trivially copyable type");
+        if( !is.read(reinterpret_cast<char*>(&val), sizeof(T)) )
+            throw runtime_error("binary::read() unexpected end of stream");
+    }
+
+    /** @brief Write a length prefixed vector of trivially copyable values */
+    template <typename T>
+    inline void write(ostream& os, const vector<T>& vals) {
+        write(os, (uint64_t) vals.size());
+        for(const T& v : vals)
+            write(os, v);
+    }
+
+    /** @brief Read a length prefixed vector of trivially copyable values */
+    template <typename T>
+    inline void read(istream& is, vector<T>& vals) {
+        uint64_t n;
+        read(is, n);
+        check_length(is, n, is_trivially_copyable<T>::value ? sizeof(T) : sizeof(uint64_t));
+        vals.resize(n);
+        for(T& v : vals)
+            read(is, v);
+    }
+
+    /** @brief Write a length prefixed vector<bool> */
+    inline void write(ostream& os, const vector<bool>& vals) {
+        write(os, (uint64_t) vals.size());
+        for(bool v : vals)
+            write(os, v);
+    }
+
+    /** @brief Read a length prefixed vector<bool> */
+    inline void read(istream& is, vector<bool>& vals) {
+        uint64_t n;
+        read(is, n);
+        check_length(is, n, sizeof(bool));
+        vals.resize(n);
+        for(size_t i = 0; i < n; i++) {
+            bool v;
+            read(is, v);
+            vals[i] = v;
+        }
+    }
+
+    /** @brief Write a length prefixed string */
+    inline void write(ostream& os, const string& s) {
+        write(os, (uint64_t) s.size());
+        os.write(s.data(), s.size());
+    }
+
+    /** @brief Read a length prefixed string */
+    inline void read(istream& is, string& s) {
+        uint64_t n;
+        read(is, n);
+        check_length(is, n, 1);
+        s.resize(n);
+        if( !is.read(&s[0], n) )
+            throw runtime_error("binary::read() unexpected end of stream");
+    }
+
+}
+
+#endif
@@ -12,20 +12,30 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 /**
- * @brief Return a hash value for a given vector of bools 
- * @param v         vector of bools
- * @return          unique hash for combination of bools
+ * @brief Return a well mixed 64-bit value for x (splitmix64 finaliser)
+ * @param x         value to mix
+ * @return          mixed value
  */
-inline size_t hash_bools(const vector<bool>& v) {
-    size_t value = 0;
-    for (const bool& b : v) {
-        value <<= 1;      // Shift the current value one position to the left.
-        if (b) {
-            value |= 1;  // Set the least-significant bit.
-        }
-    }
+inline uint64_t hash_mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Return a hash value for a sequence of 64-bit words of any length
+ * @param words     pointer to first word
+ * @param count     number of words
+ * @return          hash of the words
+ */
+inline size_t hash_words(const uint64_t* words, size_t count) {
+    uint64_t value = count;
+    for(size_t i = 0; i < count; i++)
+        value = hash_mix(value ^ words[i]);
     return value;
 }
 
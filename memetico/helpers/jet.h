@@ -0,0 +1,124 @@
+
+/** @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Truncated Taylor series (jet) arithmetic for forward-mode derivatives of any order
+ */
+
+#ifndef MEMETICO_HELPERS_JET_H_
+#define MEMETICO_HELPERS_JET_H_
+
+// Std
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+
+using namespace std;
+
+/** @brief Largest derivative order that evaluate_ders() dispatches to, increase to support higher orders */
+#define JET_MAX_ORDER 8
+
+/**
+ * @brief A truncated Taylor series \f$f(x_0+t)=\sum_{k=0}^{N} c_k t^k\f$ of a value with respect to a single variable
+ *
+ * Each arithmetic operation propagates all N+1 coefficients, so evaluating an expression once with a Jet returns the
+ * value and the first N derivatives, where \f$f^{(k)}(x_0) = k!\,c_k\f$. Coefficients are kept in the Taylor (scaled)
+ * form so that multiplication is a Cauchy product and division a forward recurrence, both O(N^2).
+ *
+ * @tparam N order of the highest derivative carried
+ */
+template <size_t N>
+class Jet {
+
+    public:
+
+        /** @brief Construct Jet of a constant value */
+        Jet(double val = 0) { c.fill(0); c[0] = val; };
+
+        /** @brief Construct Jet of a value that changes with slope d in the seeded variable */
+        Jet(double val, double d) { c.fill(0); c[0] = val; if(N > 0) c[1] = d; };
+
+        /** @brief Return the value, i.e. the 0th coefficient */
+        double  value() const               { return c[0]; };
+
+        /** @brief Set the value, i.e. the 0th coefficient, leaving derivatives untouched */
+        void    set_value(double val)       { c[0] = val; };
+
+        /** @brief Return the k-th Taylor coefficient */
+        double  coeff(size_t k) const       { return c[k]; };
+
+        /** @brief Return the k-th derivative \f$k!\,c_k\f$ */
+        double  derivative(size_t k) const {
+            double fact = 1;
+            for(size_t i = 2; i <= k; i++)
+                fact *= i;
+            return c[k]*fact;
+        };
+
+        /** @brief Write the value and derivatives 0..N into out */
+        void    derivatives(vector<double>& out) const {
+            out.resize(N+1);
+            double fact = 1;
+            for(size_t k = 0; k <= N; k++) {
+                if( k > 1 ) fact *= k;
+                out[k] = c[k]*fact;
+            }
+        };
+
+        Jet<N>& operator+=(const Jet<N>& o)  { for(size_t k = 0; k <= N; k++) c[k] += o.c[k]; return *this; };
+        Jet<N>& operator-=(const Jet<N>& o)  { for(size_t k = 0; k <= N; k++) c[k] -= o.c[k]; return *this; };
+        Jet<N>& operator*=(double s)         { for(size_t k = 0; k <= N; k++) c[k] *= s; return *this; };
+
+        /** @brief Cauchy product of two truncated series */
+        friend Jet<N> operator*(const Jet<N>& a, const Jet<N>& b) {
+            Jet<N> r;
+            for(size_t k = 0; k <= N; k++) {
+                double s = 0;
+                for(size_t j = 0; j <= k; j++)
+                    s += a.c[j]*b.c[k-j];
+                r.c[k] = s;
+            }
+            return r;
+        };
+
+        /** @brief Quotient of two truncated series via \f$q_k = (a_k - \sum_{j=1}^{k} b_j q_{k-j})/b_0\f$ */
+        friend Jet<N> operator/(const Jet<N>& a, const Jet<N>& b) {
+            Jet<N> r;
+            for(size_t k = 0; k <= N; k++) {
+                double s = a.c[k];
+                for(size_t j = 1; j <= k; j++)
+                    s -= b.c[j]*r.c[k-j];
+                r.c[k] = s/b.c[0];
+            }
+            return r;
+        };
+
+        friend Jet<N> operator+(Jet<N> a, const Jet<N>& b)      { return a += b; };
+        friend Jet<N> operator-(Jet<N> a, const Jet<N>& b)      { return a -= b; };
+        friend Jet<N> operator*(Jet<N> a, double s)             { return a *= s; };
+        friend Jet<N> operator*(double s, Jet<N> a)             { return a *= s; };
+
+    private:
+
+        /** @brief Taylor coefficients, c[0] is the value */
+        array<double, N+1> c;
+
+};
+
+/**
+ * @brief Call f(integral_constant<size_t, K>()) for the compile time order K matching the runtime order
+ * @return true if order was dispatched, false if it exceeds JET_MAX_ORDER
+ */
+template <size_t K = 0, typename F>
+inline bool jet_dispatch(size_t order, F&& f) {
+    if( order == K ) {
+        f(integral_constant<size_t, K>());
+        return true;
+    }
+    if constexpr (K < JET_MAX_ORDER)
+        return jet_dispatch<K+1>(order, f);
+    return false;
+}
+
+#endif
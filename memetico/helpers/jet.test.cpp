@@ -0,0 +1,30 @@
+
+#include "doctest.h"
+#include <memetico/helpers/jet.h>
+#include <cmath>
+
+TEST_CASE("Jet: arithmetic ") {
+
+    // Seed x = 2 and compute f(x) = (3x^2 + 1)/(x - 5)
+    Jet<4> x(2, 1);
+    Jet<4> f = (3.0*x*x + Jet<4>(1))/(x - Jet<4>(5));
+
+    // f = 13/-3, f' = (6x(x-5) - (3x^2+1))/(x-5)^2 = (-36 - 13)/9
+    CHECK( f.value() == doctest::Approx(-13.0/3) );
+    CHECK( f.derivative(1) == doctest::Approx(-49.0/9) );
+
+    // f = 3x + 15 + 76/(x-5), so f^(k) = 76 (-1)^k k! / (x-5)^(k+1) for k >= 2
+    vector<double> d;
+    f.derivatives(d);
+    REQUIRE( d.size() == 5 );
+    CHECK( d[2] == doctest::Approx(76.0*2/pow(-3,3)) );
+    CHECK( d[3] == doctest::Approx(-76.0*6/pow(-3,4)) );
+    CHECK( d[4] == doctest::Approx(76.0*24/pow(-3,5)) );
+
+    // Dispatch to the runtime order
+    size_t seen = 99;
+    CHECK( jet_dispatch(3, [&](auto n) { seen = decltype(n)::value; }) );
+    CHECK( seen == 3 );
+    CHECK( !jet_dispatch(JET_MAX_ORDER+1, [&](auto n) { seen = decltype(n)::value; }) );
+
+}
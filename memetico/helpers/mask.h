@@ -0,0 +1,283 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Word packed bit masks and a generator of unseen masks
+ * 
+ */
+
+#ifndef MEMETICO_HELPERS_MASK_H_
+#define MEMETICO_HELPERS_MASK_H_
+
+// Local
+#include <memetico/helpers/rng.h>
+#include <memetico/helpers/hash.h>
+#include <memetico/helpers/binary.h>
+
+// Std
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <unordered_set>
+
+using namespace std;
+
+/** @brief Masks of at most this many bits are enumerated by permutation rather than tracked in a set */
+#define MASK_ENUM_BITS 20
+
+/** @brief Default number of masks remembered by a MaskHistory for larger masks */
+#define MASK_HISTORY_CAPACITY (1 << 20)
+
+/**
+ * @brief A fixed length bit mask packed into 64-bit words
+ * 
+ * Bits beyond size() in the last word are always zero so that words compare and hash consistently
+ */
+class Mask {
+
+    public:
+
+        /** @brief Construct a mask of bits length with all bits off */
+        Mask(size_t bits = 0) : bits(bits), words((bits+63)/64, 0) {};
+
+        /** @brief Return number of bits */
+        size_t  size() const                { return bits; };
+
+        /** @brief Return bit i */
+        bool    get(size_t i) const         { return (words[i >> 6] >> (i & 63)) & 1; };
+
+        /** @brief Set bit i to val */
+        void    set(size_t i, bool val) {
+            if( val )   words[i >> 6] |= uint64_t(1) << (i & 63);
+            else        words[i >> 6] &= ~(uint64_t(1) << (i & 63));
+        };
+
+        /** @brief Return number of bits on */
+        size_t  count() const {
+            size_t c = 0;
+            for(uint64_t w : words)
+                c += __builtin_popcountll(w);
+            return c;
+        };
+
+        /** @brief Return packed words */
+        const vector<uint64_t>& get_words() const  { return words; };
+
+        /** @brief Set the low bits of the mask from an integer, for masks of at most 64 bits */
+        void    set_index(uint64_t index) {
+            if( words.size() > 0 )
+                words[0] = index & tail();
+        };
+
+        /** @brief Fill with uniformly random bits, one draw per 64 bits */
+        void    randomise(RandInt& rng) {
+            for(uint64_t& w : words)
+                w = rng.rand64();
+            if( words.size() > 0 )
+                words.back() &= tail();
+        };
+
+        /** @brief Return hash of the mask */
+        size_t  hash() const                { return hash_words(words.data(), words.size()); };
+
+        bool    operator==(const Mask& o) const { return bits == o.bits && words == o.words; };
+
+        /** @brief Write the mask for a checkpoint */
+        void    write(ostream& os) const {
+            binary::write(os, (uint64_t) bits);
+            binary::write(os, words);
+        };
+
+        /** @brief Restore a mask written by write() */
+        void    read(istream& is) {
+            uint64_t b;
+            binary::read(is, b);
+            bits = b;
+            binary::read(is, words);
+            if( words.size() != (bits+63)/64 )
+                throw runtime_error("Mask::read() word count does not match the mask length");
+        };
+
+    private:
+
+        /** @brief Return bits in use in the last word */
+        uint64_t tail() const {
+            size_t r = bits & 63;
+            return r == 0 ? ~uint64_t(0) : (uint64_t(1) << r)-1;
+        };
+
+        /** Number of bits */
+        size_t              bits;
+
+        /** Packed bits, bit i in words[i/64] at position i%64 */
+        vector<uint64_t>    words;
+
+};
+
+/** @brief Hash functor for unordered containers of Mask */
+struct MaskHash {
+    size_t operator()(const Mask& m) const { return m.hash(); };
+};
+
+/**
+ * @brief Generate masks of a fixed length that have not been returned before
+ * 
+ * - For at most MASK_ENUM_BITS bits, masks are enumerated with a randomly seeded full period permutation of
+ *   \f$[0, 2^m)\f$, so every mask is returned exactly once per cycle with no memory for the history
+ * - For longer masks an exact set of the most recent \a capacity masks is kept, evicting the oldest,
+ *   and uniformly random masks are drawn until an unseen one is found
+ */
+class MaskHistory {
+
+    public:
+
+        /** @brief Construct history for masks of bits length remembering at most capacity masks */
+        MaskHistory(size_t bits = 0, size_t capacity = MASK_HISTORY_CAPACITY) : bits(bits), capacity(capacity) {
+            issued = 0;
+            period = bits <= MASK_ENUM_BITS ? uint64_t(1) << bits : 0;
+        };
+
+        /** @brief Return a mask not returned before, or begin a new cycle once all masks have been returned */
+        Mask    next(RandInt& rng) {
+
+            Mask m(bits);
+
+            if( period > 0 ) {
+
+                // Reseed the permutation at the start of each cycle
+                if( issued % period == 0 ) {
+                    if( issued > 0 )
+                        cout << "All possible masks of size " << bits << " have been generated, restarting" << endl;
+                    seed(rng);
+                }
+
+                state = (mult*state + inc) & (period-1);
+                m.set_index(scramble(state));
+                issued++;
+                return m;
+            }
+
+            // Try 50 times to find an unseen mask, which almost always succeeds first time for large masks
+            for(size_t j = 0; j < 50; j++) {
+                m.randomise(rng);
+                if( seen.find(m) == seen.end() )
+                    break;
+            }
+            remember(m);
+            issued++;
+            return m;
+        };
+
+        /** @brief Return if m is in the history */
+        bool    contains(const Mask& m) const {
+            if( period > 0 )
+                throw logic_error("MaskHistory::contains() is not tracked for enumerated masks");
+            return seen.find(m) != seen.end();
+        };
+
+        /** @brief Return number of masks returned */
+        uint64_t get_issued() const     { return issued; };
+
+        /** @brief Return number of masks held in the history set */
+        size_t  get_remembered() const  { return order.size(); };
+
+        /** @brief Write the history for a checkpoint, so next() continues the same sequence after read() */
+        void    write(ostream& os) const {
+            binary::write(os, (uint64_t) bits);
+            binary::write(os, (uint64_t) capacity);
+            binary::write(os, issued);
+            binary::write(os, period);
+            binary::write(os, state);
+            binary::write(os, mult);
+            binary::write(os, inc);
+            binary::write(os, odd);
+            binary::write(os, flip);
+            binary::write(os, (uint64_t) shift);
+            binary::write(os, (uint64_t) order.size());
+            for(const Mask& m : order)
+                m.write(os);
+        };
+
+        /** @brief Restore a history written by write(), the seen set is rebuilt from the insertion order */
+        void    read(istream& is) {
+            uint64_t b, c, s, n;
+            binary::read(is, b);
+            binary::read(is, c);
+            binary::read(is, issued);
+            binary::read(is, period);
+            binary::read(is, state);
+            binary::read(is, mult);
+            binary::read(is, inc);
+            binary::read(is, odd);
+            binary::read(is, flip);
+            binary::read(is, s);
+            binary::read(is, n);
+            bits = b;
+            capacity = c;
+            shift = s;
+
+            seen.clear();
+            order.clear();
+            for(size_t i = 0; i < n; i++) {
+                Mask m;
+                m.read(is);
+                seen.insert(m);
+                order.push_back(m);
+            }
+        };
+
+    private:
+
+        /** @brief Pick a random full period LCG and bijective scrambler for the next cycle */
+        void    seed(RandInt& rng) {
+            uint64_t r = rng.rand64();
+            state = r & (period-1);
+            mult = ((r >> 20) << 2) | 1;        // a = 1 mod 4
+            inc = (rng.rand64() << 1) | 1;      // c odd
+            odd = rng.rand64() | 1;
+            flip = rng.rand64() & (period-1);
+            shift = (bits+1)/2;
+        };
+
+        /** @brief Bijection on [0, 2^bits) to break up the low bit patterns of the LCG */
+        uint64_t scramble(uint64_t x) const {
+            x ^= x >> shift;
+            x = (x*odd) & (period-1);
+            return x ^ flip;
+        };
+
+        /** @brief Add m to the history evicting the oldest when at capacity */
+        void    remember(const Mask& m) {
+            if( !seen.insert(m).second )
+                return;
+            order.push_back(m);
+            if( order.size() > capacity ) {
+                seen.erase(order.front());
+                order.pop_front();
+            }
+        };
+
+        /** Mask length */
+        size_t      bits;
+
+        /** Maximum number of masks remembered */
+        size_t      capacity;
+
+        /** Number of masks returned */
+        uint64_t    issued;
+
+        /** Number of possible masks when enumerating, 0 otherwise */
+        uint64_t    period;
+
+        /** Permutation state and parameters */
+        uint64_t    state = 0, mult = 1, inc = 1, odd = 1, flip = 0;
+        size_t      shift = 1;
+
+        /** Exact set of recent masks and their insertion order */
+        unordered_set<Mask, MaskHash>   seen;
+        deque<Mask>                     order;
+
+};
+
+#endif
@@ -0,0 +1,83 @@
+
+#include "doctest.h"
+#include <memetico/helpers/mask.h>
+#include <set>
+#include <sstream>
+
+TEST_CASE("Mask: set, get, randomise") {
+
+    RandInt ri = RandInt(42);
+
+    // 1. Bits span multiple words
+    Mask m(130);
+    REQUIRE( m.size() == 130 );
+    REQUIRE( m.get_words().size() == 3 );
+    m.set(0, true);
+    m.set(64, true);
+    m.set(129, true);
+    CHECK( m.get(0) );
+    CHECK( !m.get(1) );
+    CHECK( m.get(64) );
+    CHECK( m.get(129) );
+    CHECK( m.count() == 3 );
+    m.set(64, false);
+    CHECK( !m.get(64) );
+
+    // 2. Random masks keep unused bits of the last word clear
+    for(size_t i = 0; i < 20; i++) {
+        m.randomise(ri);
+        CHECK( (m.get_words()[2] >> 2) == 0 );
+    }
+
+    // 3. Equal masks hash equally
+    Mask a(70), b(70);
+    a.set(65, true);
+    b.set(65, true);
+    CHECK( a == b );
+    CHECK( a.hash() == b.hash() );
+    b.set(3, true);
+    CHECK( !(a == b) );
+
+}
+
+TEST_CASE("MaskHistory: next") {
+
+    RandInt ri = RandInt(42);
+
+    // 1. Small masks are enumerated, every mask appears once per cycle
+    size_t bits = 10;
+    MaskHistory small(bits);
+    set<uint64_t> seen;
+    for(size_t i = 0; i < ((size_t) 1 << bits); i++) {
+        Mask m = small.next(ri);
+        REQUIRE( m.size() == bits );
+        seen.insert(m.get_words()[0]);
+    }
+    CHECK( seen.size() == ((size_t) 1 << bits) );
+    CHECK( *seen.rbegin() == ((size_t) 1 << bits)-1 );
+
+    // 2. Large masks are unique and the history is bounded by its capacity
+    MaskHistory large(200, 16);
+    Mask first = large.next(ri);
+    CHECK( large.contains(first) );
+    for(size_t i = 0; i < 40; i++)
+        large.next(ri);
+    CHECK( large.get_remembered() == 16 );
+    CHECK( large.get_issued() == 41 );
+    CHECK( !large.contains(first) );
+
+    // 3. Written histories continue the same sequence
+    stringstream ss;
+    small.write(ss);
+    large.write(ss);
+    MaskHistory small_copy, large_copy;
+    small_copy.read(ss);
+    large_copy.read(ss);
+    CHECK( large_copy.get_remembered() == 16 );
+    RandInt ra = RandInt(7), rb = RandInt(7);
+    for(size_t i = 0; i < 5; i++) {
+        CHECK( small_copy.next(ra) == small.next(rb) );
+        CHECK( large_copy.next(ra) == large.next(rb) );
+    }
+
+}
@@ -0,0 +1,152 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Scoped timers and counters for hot paths, compiled in with -DMEMETICO_PROFILE
+ *
+ * - PROFILE_SCOPE("name") times the enclosing scope, PROFILE_COUNT("name", n) adds n to a counter
+ * - Without MEMETICO_PROFILE both macros expand to nothing, so instrumented code is unchanged
+ * - Each thread accumulates into its own table without synchronisation, tables are merged by report()
+ * - A scope entered again within itself, e.g. evaluate() of a branched fraction, counts its time at each level
+ *
+ */
+
+#ifndef MEMETICO_HELPERS_PROFILE_H_
+#define MEMETICO_HELPERS_PROFILE_H_
+
+// Std
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+/** @brief Maximum number of distinct scope and counter names */
+#define PROFILE_MAX_SITES 64
+
+#ifdef MEMETICO_PROFILE
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+/** @brief Time the enclosing scope under \a name */
+#define PROFILE_SCOPE(name) \
+    static const size_t PROFILE_CONCAT(profile_site_, __LINE__) = profile::site(name); \
+    profile::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_site_, __LINE__))
+
+/** @brief Add \a n to the counter \a name */
+#define PROFILE_COUNT(name, n) \
+    do { static const size_t profile_site = profile::site(name); profile::local().stats[profile_site].calls += (n); } while(0)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(name, n)
+
+#endif
+
+namespace profile {
+
+    /** @brief Calls to and nanoseconds within a scope, counters only use calls */
+    struct Stat {
+        uint64_t    calls = 0;
+        uint64_t    ns = 0;
+    };
+
+    /** @brief Statistics of a single thread indexed by site */
+    struct Table {
+        Stat        stats[PROFILE_MAX_SITES];
+    };
+
+    /** @brief Guards registration of sites and tables, never taken on the timed path once a site is registered */
+    inline mutex                        lock;
+
+    /** @brief Site names, indexes into Table::stats */
+    inline vector<const char*>          names;
+
+    /** @brief Tables of every thread that has recorded, owned here so they outlive their threads */
+    inline vector<unique_ptr<Table>>    tables;
+
+    /** @brief Return the index of \a name, registering it on first use. Template instantiations share a site */
+    inline size_t site(const char* name) {
+
+        lock_guard<mutex> guard(lock);
+        for(size_t i = 0; i < names.size(); i++)
+            if( strcmp(names[i], name) == 0 )
+                return i;
+
+        if( names.size() == PROFILE_MAX_SITES )
+            throw runtime_error("Profile site limit reached registering "+string(name));
+
+        names.push_back(name);
+        return names.size()-1;
+    }
+
+    /** @brief Return the table of the calling thread */
+    inline Table& local() {
+
+        thread_local Table* table = nullptr;
+        if( table == nullptr ) {
+            lock_guard<mutex> guard(lock);
+            tables.push_back(make_unique<Table>());
+            table = tables.back().get();
+        }
+        return *table;
+    }
+
+    /** @brief Add the lifetime of the Scope to a site of the calling thread */
+    struct Scope {
+
+        Stat&   stat;
+        chrono::steady_clock::time_point start;
+
+        Scope(size_t s) : stat(local().stats[s]), start(chrono::steady_clock::now()) {}
+
+        ~Scope() {
+            stat.calls++;
+            stat.ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-start).count();
+        }
+
+    };
+
+    /**
+     * @brief Write the statistics of each site merged over threads as CSV, nothing when no site was recorded
+     * - Max Thread ms is the largest time of a single thread, close to Total ms / Threads when work is balanced
+     * - Call once threads have finished recording, tables are read without synchronisation
+     */
+    inline void report(ostream& os) {
+
+        lock_guard<mutex> guard(lock);
+        if( names.empty() )
+            return;
+
+        os << "Scope,Calls,Total ms,Mean us,Threads,Max Thread ms" << endl;
+        for(size_t i = 0; i < names.size(); i++) {
+
+            uint64_t calls = 0, ns = 0, max_ns = 0;
+            size_t threads = 0;
+            for(auto& t : tables) {
+                Stat& s = t->stats[i];
+                if( s.calls == 0 )
+                    continue;
+                calls += s.calls;
+                ns += s.ns;
+                max_ns = max(max_ns, s.ns);
+                threads++;
+            }
+
+            os << names[i] << "," << calls << "," << ns/1e6 << "," << (calls > 0 ? ns/1e3/calls : 0) << "," << threads << "," << max_ns/1e6 << endl;
+        }
+    }
+
+}
+
+#endif
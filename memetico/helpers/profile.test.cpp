@@ -0,0 +1,49 @@
+
+#define MEMETICO_PROFILE
+#include "doctest.h"
+#include <memetico/helpers/profile.h>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+    void profiled(size_t n) {
+        PROFILE_SCOPE("test: scope");
+        PROFILE_COUNT("test: count", n);
+    }
+
+}
+
+TEST_CASE("Profile: scopes, counters, report") {
+
+    // 1. Scopes and counters accumulate per thread and merge in the report
+    for(size_t i = 0; i < 5; i++)
+        profiled(2);
+
+    thread t([](){
+        for(size_t i = 0; i < 3; i++)
+            profiled(1);
+    });
+    t.join();
+
+    stringstream ss;
+    profile::report(ss);
+
+    string line, scope, count;
+    while( getline(ss, line) ) {
+        if( line.rfind("test: scope,", 0) == 0 )   scope = line;
+        if( line.rfind("test: count,", 0) == 0 )   count = line;
+    }
+
+    // Scope,Calls,Total ms,Mean us,Threads,Max Thread ms
+    REQUIRE( scope != "" );
+    CHECK( scope.rfind("test: scope,8,", 0) == 0 );
+    REQUIRE( count != "" );
+    CHECK( count.rfind("test: count,13,0,", 0) == 0 );
+    CHECK( count.find(",2,0") != string::npos );
+
+    // 2. Sites are shared by name
+    CHECK( profile::site("test: scope") == profile::site("test: scope") );
+    CHECK( profile::site("test: scope") != profile::site("test: count") );
+
+}
@@ -10,6 +10,6 @@
 
 #include <memetico/helpers/rng.h>
 
-RandInt*        RandInt::RANDINT = nullptr;
-RandReal*       RandReal::RANDREAL = nullptr;
+thread_local RandInt*  RandInt::RANDINT = nullptr;
+thread_local RandReal* RandReal::RANDREAL = nullptr;
 
@@ -17,24 +17,109 @@ using namespace std;
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <unordered_set>
+#include <memetico/helpers/hash.h>
+#include <memetico/helpers/binary.h>
+
+/**
+ * @brief Philox4x32-10 counter-based random number engine
+ * 
+ * Each output block is a keyed bijection of a 128-bit counter, where the key is the seed and the upper 64 bits of the
+ * counter are the stream. Engines with the same seed and different streams are therefore independent, and any
+ * stream can be derived deterministically without advancing another. Satisfies UniformRandomBitGenerator.
+ */
+class Philox {
+
+    public:
+
+        using result_type = uint64_t;
+
+        /** @brief Construct engine for seed and stream */
+        Philox(uint64_t seed = 0, uint64_t stream = 0) : key(seed), stream(stream), counter(0), idx(2) {};
+
+        static constexpr result_type min()  { return 0; };
+        static constexpr result_type max()  { return ~uint64_t(0); };
+
+        /** @brief Return next 64 random bits */
+        result_type operator()() {
+            if( idx == 2 ) {
+                block(counter++, out);
+                idx = 0;
+            }
+            return out[idx++];
+        };
+
+        /** @brief Return seed */
+        uint64_t get_seed() const       { return key; };
+
+        /** @brief Return stream */
+        uint64_t get_stream() const     { return stream; };
+
+        /** @brief Write the full engine state, including the position within the current block */
+        void write(ostream& os) const   { binary::write(os, *this); };
+
+        /** @brief Restore the engine state written by write() */
+        void read(istream& is)          { binary::read(is, *this); };
+
+    private:
+
+        /** @brief Compute the two 64-bit outputs for counter value ctr */
+        void block(uint64_t ctr, uint64_t* res) const {
+            uint32_t c0 = ctr, c1 = ctr >> 32, c2 = stream, c3 = stream >> 32;
+            uint32_t k0 = key, k1 = key >> 32;
+            for(size_t r = 0; r < 10; r++) {
+                uint64_t p0 = uint64_t(0xD2511F53)*c0;
+                uint64_t p1 = uint64_t(0xCD9E8D57)*c2;
+                uint32_t n0 = (p1 >> 32)^c1^k0;
+                uint32_t n2 = (p0 >> 32)^c3^k1;
+                c1 = p1;
+                c3 = p0;
+                c0 = n0;
+                c2 = n2;
+                k0 += 0x9E3779B9;
+                k1 += 0xBB67AE85;
+            }
+            res[0] = (uint64_t(c1) << 32) | c0;
+            res[1] = (uint64_t(c3) << 32) | c2;
+        };
+
+        /** Seed used as the round key */
+        uint64_t key;
+
+        /** Stream, the upper 64 bits of the counter */
+        uint64_t stream;
+
+        /** Block counter, the lower 64 bits of the counter */
+        uint64_t counter;
+
+        /** Outputs of the current block and the next to return */
+        uint64_t out[2];
+        size_t   idx;
+
+};
 
 /** Class to manage randomisation of integers  */
 class RandInt {
 
     private:
-        mt19937 gen;
+        Philox gen;
 
     public:
 
         /** @brief Construct RandInt with a random device seed */
         RandInt() {
             random_device rd;
-            gen.seed(rd());
+            gen = Philox((uint64_t(rd()) << 32) | rd());
         }
 
-        /** @brief Construct RandInt with specified seed */
-        RandInt(int seed) {
-            gen.seed(seed);
+        /** @brief Construct RandInt with specified seed and stream */
+        RandInt(uint64_t seed, uint64_t stream = 0) : gen(seed, stream) {}
+
+        /** @brief Return RandInt for an independent stream derived from this seed and stream, e.g. per agent or thread */
+        RandInt split(uint64_t stream) const {
+            return RandInt(gen.get_seed(), hash_mix(gen.get_stream() ^ hash_mix(stream)));
         }
 
         /** @brief Return random integer between min and max */
@@ -47,39 +132,62 @@ class RandInt {
             if(min > max) {
                 throw runtime_error( "Invalid Range min:"+to_string(min)+" max:"+to_string(max) );
             }
-            return uniform_int_distribution<> (min, max) (gen);
+            return min + (int) below((uint64_t) ((int64_t) max - min) + 1);
+        }
+
+        /** @brief Return uniform integer in [0, n) by Lemire's multiply and reject method */
+        uint64_t below(uint64_t n) {
+            __uint128_t m = (__uint128_t) gen() * n;
+            uint64_t low = (uint64_t) m;
+            if( low < n ) {
+                uint64_t threshold = -n % n;
+                while( low < threshold ) {
+                    m = (__uint128_t) gen() * n;
+                    low = (uint64_t) m;
+                }
+            }
+            return m >> 64;
         }
 
-        /** @brief Return unique list of random values between start and end */
+        /**
+         * @brief Return unique list of random values between start and end in ascending order
+         * Uses Floyd's algorithm so the cost is O(amount) regardless of the range
+         */
         vector<size_t> unique_set(size_t amount, size_t start, size_t end) {
 
-            vector<size_t> population;
-            for( size_t i = start; i < end; i++)
-                population.push_back(i);
+            size_t n = end > start ? end-start : 0;
+            amount = min(amount, n);
+
+            unordered_set<size_t> chosen;
+            chosen.reserve(amount);
+            for(size_t j = n-amount; j < n; j++) {
+                size_t t = below(j+1);
+                if( !chosen.insert(t).second )
+                    chosen.insert(j);
+            }
 
             vector<size_t> selection;
-            sample(
-                population.begin(), 
-                population.end(), 
-                back_inserter(selection),
-                amount,
-                gen);
+            selection.reserve(amount);
+            for(size_t v : chosen)
+                selection.push_back(start+v);
+            sort(selection.begin(), selection.end());
 
             return selection;
         }
 
-        /** @brief Return unique list of random values between start and end */
-        vector<bool> unique_bools(size_t amount) {
+        /** @brief Return 64 uniformly random bits */
+        uint64_t rand64() {
+            return gen();
+        }
 
-            vector<bool> set;
-            for( size_t i = 0; i < amount; i++)
-                set.push_back(rand(0,1));
+        /** @brief Write the generator state for a checkpoint */
+        void write(ostream& os) const   { gen.write(os); }
 
-            return set;
-        }
+        /** @brief Restore the generator state written by write() */
+        void read(istream& is)          { gen.read(is); }
 
-        /** @brief Reference to global int randomiser */
-        static RandInt*         RANDINT;
+        /** @brief Reference to global int randomiser of the run on this thread */
+        static thread_local RandInt*    RANDINT;
 };
 
 /** Class to manage randomisation of doubles */
@@ -87,20 +195,22 @@ class RandReal {
 
     private:
 
-        mt19937 gen;
-        uniform_real_distribution<> dis;
+        Philox gen;
 
     public:
 
         /** @brief Construct RandReal with a random device seed */
         RandReal() {
             random_device rd;
-            gen.seed(rd());
+            gen = Philox((uint64_t(rd()) << 32) | rd(), 1);
         }
 
-        /** @brief Construct RandInt with specified seed */
-        RandReal(int seed) {
-            gen.seed(seed);
+        /** @brief Construct RandReal with specified seed, stream 1 by default so it is independent of RandInt of the same seed */
+        RandReal(uint64_t seed, uint64_t stream = 1) : gen(seed, stream) {}
+
+        /** @brief Return RandReal for an independent stream derived from this seed and stream, e.g. per agent or thread */
+        RandReal split(uint64_t stream) const {
+            return RandReal(gen.get_seed(), hash_mix(gen.get_stream() ^ hash_mix(stream)));
         }
 
         /** @brief Return random real between 0 and 1 */
@@ -113,17 +223,23 @@ class RandReal {
             return rand(min,max);
         }
 
-        /** @brief Return random real between min and max */
+        /** @brief Return random real in [min, max) from 53 random bits */
         double rand(double min = 0, double max = 1) {
             
             if(min > max) 
                 throw invalid_argument( "Invalid Range a:"+to_string(min)+" b:"+to_string(max) );
                 
-            return uniform_real_distribution<> (min, max) (gen);
+            return min + (gen() >> 11) * 0x1.0p-53 * (max-min);
         }
 
-        /** @brief Reference to global real randomiser */
-        static RandReal*        RANDREAL;
+        /** @brief Write the generator state for a checkpoint */
+        void write(ostream& os) const   { gen.write(os); }
+
+        /** @brief Restore the generator state written by write() */
+        void read(istream& is)          { gen.read(is); }
+
+        /** @brief Reference to global real randomiser of the run on this thread */
+        static thread_local RandReal*   RANDREAL;
 
 };
 
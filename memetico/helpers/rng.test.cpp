@@ -1,8 +1,104 @@
 
 #include "doctest.h"
+#include <memetico/helpers/rng.h>
+#include <set>
+#include <sstream>
+#include <thread>
 
-// Much to do here
+TEST_CASE("Philox: known answer") {
 
-TEST_CASE("CUSR: ") {
+    // Philox4x32-10 with zero key and counter, Salmon et al. (2011) reference values
+    Philox zero(0, 0);
+    uint64_t r0 = zero();
+    uint64_t r1 = zero();
+    CHECK( (uint32_t) r0 == 0x6627e8d5 );
+    CHECK( (uint32_t) (r0 >> 32) == 0xe169c58d );
+    CHECK( (uint32_t) r1 == 0xbc57ac4c );
+    CHECK( (uint32_t) (r1 >> 32) == 0x9b00dbd8 );
+
+}
+
+TEST_CASE("RandInt: rand, split, unique_set") {
+
+    RandInt ri = RandInt(42);
+
+    // 1. Bounds are inclusive and all values are reached
+    set<int> seen;
+    for(size_t i = 0; i < 1000; i++) {
+        int v = ri.rand(-3, 3);
+        REQUIRE( v >= -3 );
+        REQUIRE( v <= 3 );
+        seen.insert(v);
+    }
+    CHECK( seen.size() == 7 );
+    CHECK( ri.rand(5, 5) == 5 );
+    CHECK_THROWS( ri.rand(2, 1) );
+
+    // 2. Streams are reproducible and distinct
+    RandInt a = RandInt(42).split(7);
+    RandInt b = RandInt(42).split(7);
+    RandInt c = RandInt(42).split(8);
+    uint64_t va = a.rand64();
+    CHECK( va == b.rand64() );
+    CHECK( va != c.rand64() );
+
+    // 3. Unique sorted subsets within range
+    vector<size_t> sub = ri.unique_set(100, 1000, 10000000);
+    REQUIRE( sub.size() == 100 );
+    CHECK( is_sorted(sub.begin(), sub.end()) );
+    CHECK( set<size_t>(sub.begin(), sub.end()).size() == 100 );
+    CHECK( sub.front() >= 1000 );
+    CHECK( sub.back() < 10000000 );
+
+    // 4. Whole range when amount covers it
+    sub = ri.unique_set(20, 0, 10);
+    REQUIRE( sub.size() == 10 );
+    for(size_t i = 0; i < sub.size(); i++)
+        CHECK( sub[i] == i );
+
+    // 5. Written state resumes the sequence, including part way through an output block
+    ri.rand64();
+    stringstream ss;
+    ri.write(ss);
+    RandInt restored = RandInt(1);
+    restored.read(ss);
+    for(size_t i = 0; i < 5; i++)
+        CHECK( restored.rand64() == ri.rand64() );
+
+}
+
+TEST_CASE("RandReal: rand") {
+
+    RandReal rr = RandReal(42);
+    double sum = 0;
+    for(size_t i = 0; i < 10000; i++) {
+        double v = rr.rand(-2, 2);
+        REQUIRE( v >= -2 );
+        REQUIRE( v < 2 );
+        sum += v;
+    }
+    CHECK( sum/10000 == doctest::Approx(0).epsilon(0.05) );
+
+}
+
+TEST_CASE("RandInt: per thread randomiser") {
+
+    // Concurrent runs of a batch each point the global randomisers at their own generator
+    RandInt ri = RandInt(42);
+    RandInt::RANDINT = &ri;
+
+    RandInt* seen = &ri;
+    uint64_t first = 0;
+    thread t([&]() {
+        seen = RandInt::RANDINT;
+        RandInt own = RandInt(42);
+        RandInt::RANDINT = &own;
+        first = RandInt::RANDINT->rand64();
+    });
+    t.join();
+
+    CHECK( seen == nullptr );
+    CHECK( RandInt::RANDINT == &ri );
+    CHECK( first == ri.rand64() );
 
 }
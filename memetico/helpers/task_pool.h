@@ -0,0 +1,212 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Work stealing pool of threads for fork-join tasks
+ *
+ * - Each worker has its own deque, taking its newest task first and stealing the oldest task of another when empty
+ * - Threads outside the pool submit to a shared deque that workers steal from
+ * - A thread waiting on a Group runs queued tasks until the group has finished, so tasks may fork and wait on
+ *   their own groups and a pool of one thread runs every task on the waiting thread
+ *
+ */
+
+#ifndef MEMETICO_HELPERS_TASK_POOL_H_
+#define MEMETICO_HELPERS_TASK_POOL_H_
+
+// Std
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace tasks {
+
+    /** @brief Tasks submitted together and waited on with Pool::wait() */
+    class Group {
+
+        friend class Pool;
+
+        public:
+
+            /** @brief Return the number of submitted tasks that have not finished */
+            size_t pending() const          { return count.load(memory_order_acquire); };
+
+        private:
+
+            atomic<size_t>  count{0};
+            mutex           lock;
+
+            /** First exception thrown by a task of the group */
+            exception_ptr   error;
+
+    };
+
+    class Pool {
+
+        public:
+
+            /** @brief Construct a pool of \a threads threads, threads-1 workers and the thread that waits */
+            Pool(size_t threads) {
+
+                size_t n = max(threads, (size_t) 1);
+                for(size_t i = 0; i < n; i++)
+                    queues.push_back(make_unique<Queue>());
+
+                for(size_t i = 1; i < n; i++)
+                    workers.emplace_back(&Pool::work, this, i);
+            };
+
+            ~Pool() {
+                {
+                    lock_guard<mutex> guard(sleep_lock);
+                    stopping = true;
+                }
+                wake.notify_all();
+                for(thread& w : workers)
+                    w.join();
+            };
+
+            /** @brief Return the number of threads, including the thread that waits */
+            size_t size() const             { return queues.size(); };
+
+            /** @brief Queue \a fn as a task of \a group */
+            void submit(Group& group, function<void()> fn) {
+
+                group.count.fetch_add(1, memory_order_relaxed);
+                Queue& q = *queues[self()];
+                {
+                    lock_guard<mutex> guard(q.lock);
+                    q.tasks.push_back({move(fn), &group});
+                }
+                {
+                    lock_guard<mutex> guard(sleep_lock);
+                    queued++;
+                }
+                wake.notify_all();
+            };
+
+            /** @brief Run queued tasks until every task of \a group has finished, then rethrow the first exception of the group */
+            void wait(Group& group) {
+
+                size_t me = self();
+                while( group.pending() > 0 ) {
+                    if( try_run(me) )
+                        continue;
+                    unique_lock<mutex> guard(sleep_lock);
+                    wake.wait_for(guard, chrono::milliseconds(1), [&]() { return group.pending() == 0 || queued > 0; });
+                }
+
+                if( group.error ) {
+                    exception_ptr err = group.error;
+                    group.error = nullptr;
+                    rethrow_exception(err);
+                }
+            };
+
+        private:
+
+            struct Task {
+                function<void()>    fn;
+                Group*              group;
+            };
+
+            struct Queue {
+                mutex               lock;
+                deque<Task>         tasks;
+            };
+
+            /** Deque of each thread, 0 is shared by threads outside the pool */
+            vector<unique_ptr<Queue>>   queues;
+            vector<thread>              workers;
+
+            mutex                       sleep_lock;
+            condition_variable          wake;
+
+            /** Tasks in the deques, changed under sleep_lock so sleeping threads are not missed */
+            size_t                      queued = 0;
+            bool                        stopping = false;
+
+            /** Pool and deque of the worker running on this thread */
+            inline static thread_local Pool*    owner = nullptr;
+            inline static thread_local size_t   index = 0;
+
+            /** @brief Return the deque of the calling thread */
+            size_t self() const             { return owner == this ? index : 0; };
+
+            /** @brief Run the newest task of deque \a me, or steal the oldest of another, returning false when there are none */
+            bool try_run(size_t me) {
+
+                Task task;
+                bool found = false;
+                for(size_t k = 0; k < queues.size() && !found; k++) {
+
+                    Queue& q = *queues[(me+k) % queues.size()];
+                    lock_guard<mutex> guard(q.lock);
+                    if( q.tasks.empty() )
+                        continue;
+
+                    if( k == 0 ) {
+                        task = move(q.tasks.back());
+                        q.tasks.pop_back();
+                    } else {
+                        task = move(q.tasks.front());
+                        q.tasks.pop_front();
+                    }
+                    found = true;
+                }
+
+                if( !found )
+                    return false;
+
+                {
+                    lock_guard<mutex> guard(sleep_lock);
+                    queued--;
+                }
+
+                try {
+                    task.fn();
+                } catch(...) {
+                    lock_guard<mutex> guard(task.group->lock);
+                    if( !task.group->error )
+                        task.group->error = current_exception();
+                }
+
+                // Completion is published under sleep_lock so a thread about to wait on the group is woken
+                {
+                    lock_guard<mutex> guard(sleep_lock);
+                    task.group->count.fetch_sub(1, memory_order_release);
+                }
+                wake.notify_all();
+                return true;
+            };
+
+            /** @brief Run tasks on worker \a i until the pool is destroyed */
+            void work(size_t i) {
+
+                owner = this;
+                index = i;
+                while( true ) {
+                    if( try_run(i) )
+                        continue;
+                    unique_lock<mutex> guard(sleep_lock);
+                    wake.wait(guard, [&]() { return stopping || queued > 0; });
+                    if( stopping && queued == 0 )
+                        return;
+                }
+            };
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,50 @@
+
+#include "doctest.h"
+#include <memetico/helpers/task_pool.h>
+#include <stdexcept>
+
+namespace {
+
+    /** @brief Sum of [a, b) by forking halves down to single values */
+    size_t fork_sum(tasks::Pool& pool, size_t a, size_t b) {
+
+        if( b-a == 1 )
+            return a;
+
+        size_t left = 0, right = 0, mid = (a+b)/2;
+        tasks::Group group;
+        pool.submit(group, [&]() { left = fork_sum(pool, a, mid); });
+        pool.submit(group, [&]() { right = fork_sum(pool, mid, b); });
+        pool.wait(group);
+        return left+right;
+    }
+
+}
+
+TEST_CASE("TaskPool: fork join, exceptions") {
+
+    // 1. Nested fork-join completes on any number of threads, including the waiting thread alone
+    for(size_t threads : {1, 2, 4}) {
+        tasks::Pool pool(threads);
+        CHECK( pool.size() == threads );
+        CHECK( fork_sum(pool, 0, 1000) == 999*1000/2 );
+    }
+
+    // 2. The first exception of a group is rethrown by wait(), the other tasks still run
+    tasks::Pool pool(3);
+    tasks::Group group;
+    atomic<size_t> ran(0);
+    for(size_t i = 0; i < 10; i++)
+        pool.submit(group, [&, i]() {
+            ran++;
+            if( i == 5 )
+                throw runtime_error("task failed");
+        });
+    CHECK_THROWS_AS( pool.wait(group), runtime_error );
+    CHECK( ran == 10 );
+    CHECK( group.pending() == 0 );
+
+    // 3. The pool is reusable after a failure
+    CHECK( fork_sum(pool, 0, 64) == 63*64/2 );
+
+}
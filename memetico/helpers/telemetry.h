@@ -0,0 +1,263 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Per generation counters and timings written asynchronously to a JSONL or binary log
+ *
+ */
+
+#ifndef MEMETICO_HELPERS_TELEMETRY_H_
+#define MEMETICO_HELPERS_TELEMETRY_H_
+
+// Std
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+
+/** @brief Fraction depths recorded individually in the depth histogram, deeper fractions share the last bin */
+#define TELEMETRY_DEPTH_BINS 16
+
+/** @brief Records held between the run and the writer thread, a power of two */
+#define TELEMETRY_RING_SIZE 1024
+
+namespace telemetry {
+
+    /** @brief Counters accumulated during a generation */
+    enum Counter {
+        ObjectiveCalls,         ///< Objective evaluations, including local search trial points
+        CacheHits,              ///< Compiled models reused from the jit::compile() cache
+        NelderMeadIterations,   ///< Nelder-Mead iterations over all searches
+        Improvements,           ///< Improvements to the best solution
+        EvolveNs,               ///< Nanoseconds in Population::evolve()
+        LocalSearchNs,          ///< Nanoseconds in Population::local_search()
+        StaleNs,                ///< Nanoseconds in Population::stale()
+        BubbleNs,               ///< Nanoseconds in Population::bubble(), also counted within the phase that called it
+        COUNTERS
+    };
+
+    /** @brief Field names of the counters in the JSONL log */
+    inline const char* COUNTER_NAMES[COUNTERS] = {
+        "objective_calls", "cache_hits", "nm_iterations", "improvements",
+        "evolve_ns", "local_search_ns", "stale_ns", "bubble_ns"
+    };
+
+    /** @brief Counters of one run, relaxed atomics so threads working for the run count at the cost of an add */
+    struct Counters {
+        atomic<uint64_t>    values[COUNTERS] = {};
+    };
+
+    /**
+     * @brief Counters of the run on the calling thread, nullptr when it counts nothing
+     * - Runs sharing a process each count into their own Counters
+     * - Threads working for a run, e.g. the tasks of Population::evolve_subtrees(), are handed its pointer
+     */
+    inline thread_local Counters* current = nullptr;
+
+    /** @brief Count into \a c on the calling thread for the lifetime of the Scope, then restore the previous counters */
+    struct Scope {
+        Counters*   previous;
+        Scope(Counters* c) : previous(current)  { current = c; }
+        ~Scope()                                { current = previous; }
+    };
+
+    /** @brief Add \a n to counter \a c of the run on the calling thread */
+    inline void count(Counter c, uint64_t n = 1) {
+        if( current != nullptr )
+            current->values[c].fetch_add(n, memory_order_relaxed);
+    }
+
+    /** @brief Zero all counters of the run on the calling thread */
+    inline void reset() {
+        if( current != nullptr )
+            for(size_t i = 0; i < COUNTERS; i++)
+                current->values[i].store(0, memory_order_relaxed);
+    }
+
+    /** @brief Add the lifetime of the Timer in nanoseconds to a counter */
+    struct Timer {
+
+        Counter c;
+        bool    active;
+        chrono::steady_clock::time_point start;
+
+        /** @brief Start timing for counter \a c, or do nothing when \a active is false */
+        Timer(Counter c, bool active = true) : c(c), active(active) {
+            if( active )
+                start = chrono::steady_clock::now();
+        }
+
+        ~Timer() {
+            if( active )
+                count(c, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-start).count());
+        }
+
+    };
+
+    /** @brief Telemetry of one generation, trivially copyable so it is written as is to the binary log */
+    struct Record {
+        uint64_t    gen;
+        double      best_fitness;
+        double      elapsed;                        ///< Seconds since the run started
+        uint64_t    best_depth;
+        uint64_t    values[COUNTERS];               ///< Counter values over the generation
+        uint32_t    depths[TELEMETRY_DEPTH_BINS];   ///< Number of pocket and current solutions of each depth
+    };
+
+    /** @brief Move the counters of the run on the calling thread into \a r, starting the next generation from zero */
+    inline void take(Record& r) {
+        for(size_t i = 0; i < COUNTERS; i++)
+            r.values[i] = current != nullptr ? current->values[i].exchange(0, memory_order_relaxed) : 0;
+    }
+
+    /**
+     * @brief Bounded single producer, single consumer queue without locks
+     * - head and tail only increase, the slot is their value modulo N
+     * - Each index is written by one thread only, with release/acquire ordering the slot contents
+     */
+    template <typename T, size_t N>
+    class Ring {
+
+        static_assert((N & (N-1)) == 0, "Ring size must be a power of two");
+
+        public:
+
+            /** @brief Append v, returning false without blocking when full */
+            bool push(const T& v) {
+                size_t h = head.load(memory_order_relaxed);
+                if( h - tail.load(memory_order_acquire) == N )
+                    return false;
+                buf[h & (N-1)] = v;
+                head.store(h+1, memory_order_release);
+                return true;
+            }
+
+            /** @brief Remove the oldest value into v, returning false when empty */
+            bool pop(T& v) {
+                size_t t = tail.load(memory_order_relaxed);
+                if( t == head.load(memory_order_acquire) )
+                    return false;
+                v = buf[t & (N-1)];
+                tail.store(t+1, memory_order_release);
+                return true;
+            }
+
+        private:
+
+            array<T, N>             buf;
+
+            /** Next slot to write, owned by the producer */
+            alignas(64) atomic<size_t>  head{0};
+
+            /** Next slot to read, owned by the consumer */
+            alignas(64) atomic<size_t>  tail{0};
+
+    };
+
+    /** @brief Log file formats */
+    enum Format {
+        FormatJsonl,    ///< One JSON object per line
+        FormatBinary    ///< Consecutive Record structs
+    };
+
+    /**
+     * @brief Telemetry log written by a background thread
+     * - push() never blocks the run, records are dropped and counted when the writer falls behind
+     * - close() drains the queue, so every pushed record is written
+     */
+    class Log {
+
+        public:
+
+            /** @brief Open \a filename and start the writer, throws runtime_error when the file cannot be opened */
+            Log(string filename, Format format) : format(format) {
+                file = fopen(filename.c_str(), format == FormatBinary ? "wb" : "w");
+                if( file == nullptr )
+                    throw runtime_error("Unable to open telemetry log "+filename);
+                writer = thread(&Log::loop, this);
+            }
+
+            ~Log() {
+                close();
+            }
+
+            /** @brief Queue \a r for writing, returning false if it was dropped */
+            bool push(const Record& r) {
+                if( ring.push(r) )
+                    return true;
+                dropped.fetch_add(1, memory_order_relaxed);
+                return false;
+            }
+
+            /** @brief Write all queued records, stop the writer and close the file */
+            void close() {
+                if( file == nullptr )
+                    return;
+                running.store(false, memory_order_release);
+                writer.join();
+                fclose(file);
+                file = nullptr;
+            }
+
+            /** @brief Return number of records dropped because the queue was full */
+            uint64_t get_dropped() const { return dropped.load(memory_order_relaxed); }
+
+        private:
+
+            /** @brief Writer thread, polls the queue and writes until stopped and empty */
+            void loop() {
+                Record r;
+                while( true ) {
+                    bool stopping = !running.load(memory_order_acquire);
+                    bool any = false;
+                    while( ring.pop(r) ) {
+                        write(r);
+                        any = true;
+                    }
+                    if( stopping )
+                        break;
+                    if( any )
+                        fflush(file);
+                    else
+                        this_thread::sleep_for(chrono::milliseconds(5));
+                }
+                fflush(file);
+            }
+
+            /** @brief Write a single record */
+            void write(const Record& r) {
+
+                if( format == FormatBinary ) {
+                    fwrite(&r, sizeof(Record), 1, file);
+                    return;
+                }
+
+                fprintf(file, "{\"gen\":%llu,\"best_fitness\":%.17g,\"elapsed\":%.6f,\"best_depth\":%llu",
+                    (unsigned long long) r.gen, r.best_fitness, r.elapsed, (unsigned long long) r.best_depth);
+                for(size_t i = 0; i < COUNTERS; i++)
+                    fprintf(file, ",\"%s\":%llu", COUNTER_NAMES[i], (unsigned long long) r.values[i]);
+                fputs(",\"depths\":[", file);
+                for(size_t i = 0; i < TELEMETRY_DEPTH_BINS; i++)
+                    fprintf(file, "%s%u", i == 0 ? "" : ",", r.depths[i]);
+                fputs("]}\n", file);
+            }
+
+            Format                  format;
+            FILE*                   file = nullptr;
+            Ring<Record, TELEMETRY_RING_SIZE> ring;
+            atomic<bool>            running{true};
+            atomic<uint64_t>        dropped{0};
+            thread                  writer;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+
+#include "doctest.h"
+#include <memetico/helpers/telemetry.h>
+#include <fstream>
+#include <string>
+#include <thread>
+
+TEST_CASE("Telemetry: ring, counters, log") {
+
+    // 1. Ring is FIFO and refuses pushes when full
+    telemetry::Ring<int, 4> ring;
+    int v;
+    CHECK( !ring.pop(v) );
+    for(int i = 0; i < 4; i++)
+        CHECK( ring.push(i) );
+    CHECK( !ring.push(4) );
+    REQUIRE( ring.pop(v) );
+    CHECK( v == 0 );
+    CHECK( ring.push(4) );
+    for(int i = 1; i <= 4; i++) {
+        REQUIRE( ring.pop(v) );
+        CHECK( v == i );
+    }
+    CHECK( !ring.pop(v) );
+
+    // 2. take() moves counters into the record and zeros them, nothing is counted without a run
+    telemetry::count(telemetry::ObjectiveCalls, 5);
+    telemetry::Counters counters;
+    telemetry::current = &counters;
+    telemetry::reset();
+    telemetry::count(telemetry::ObjectiveCalls, 3);
+    telemetry::count(telemetry::Improvements);
+    telemetry::Record r = {};
+    telemetry::take(r);
+    CHECK( r.values[telemetry::ObjectiveCalls] == 3 );
+    CHECK( r.values[telemetry::Improvements] == 1 );
+    CHECK( r.values[telemetry::CacheHits] == 0 );
+    telemetry::take(r);
+    CHECK( r.values[telemetry::ObjectiveCalls] == 0 );
+
+    // Runs on other threads count into their own counters
+    telemetry::Counters other;
+    thread t([&]() {
+        telemetry::current = &other;
+        telemetry::count(telemetry::ObjectiveCalls, 2);
+        telemetry::current = nullptr;
+    });
+    t.join();
+    telemetry::take(r);
+    CHECK( r.values[telemetry::ObjectiveCalls] == 0 );
+    CHECK( other.values[telemetry::ObjectiveCalls].load() == 2 );
+
+    // 3. Inactive timers leave the counter untouched
+    {
+        telemetry::Timer timer(telemetry::BubbleNs, false);
+    }
+    CHECK( counters.values[telemetry::BubbleNs].load() == 0 );
+    telemetry::current = nullptr;
+
+    // 4. Closing the log writes every pushed record, one JSON object per line
+    string filename = "/tmp/memetico_telemetry_test.jsonl";
+    telemetry::Log log(filename, telemetry::FormatJsonl);
+    for(size_t i = 0; i < 10; i++) {
+        r = {};
+        r.gen = i;
+        r.best_fitness = 1.0/(i+1);
+        r.depths[2] = 7;
+        CHECK( log.push(r) );
+    }
+    log.close();
+    CHECK( log.get_dropped() == 0 );
+
+    ifstream in(filename);
+    string line;
+    size_t lines = 0;
+    while( getline(in, line) ) {
+        CHECK( line.find("{\"gen\":"+to_string(lines)+",") == 0 );
+        CHECK( line.find("\"objective_calls\":0") != string::npos );
+        CHECK( line.find("\"depths\":[0,0,7,0") != string::npos );
+        CHECK( line.back() == '}' );
+        lines++;
+    }
+    CHECK( lines == 10 );
+    remove(filename.c_str());
+
+}
@@ -15,6 +15,7 @@ using namespace std;
 #include <memetico/data/data_set.h>
 #include <memetico/gpu/tree_node.h>
 #include <memetico/helpers/print.h>
+#include <memetico/helpers/binary.h>
 
 using namespace cusr;
 
@@ -50,12 +51,7 @@ class Model {
     
         }
             
-        ~Model() {
-            if( node != nullptr ) {
-                delete node;
-                node = nullptr;
-            }
-        }
+        virtual ~Model() {}
 
         /** @brief setter for penalty */
         void            set_penalty(double val)     { penalty = val; };
@@ -78,6 +74,24 @@ class Model {
         /** @brief Return TreeNode for GPU evaluation */
         virtual void    get_node(TreeNode * n)      {};
 
+        /** 
+         * @brief Append the prefix encoding of the model for GPU evaluation
+         * Models should override this to emit nodes directly, the default flattens the tree from get_node()
+         * @param prefix nodes are appended, allowing the caller to reuse its capacity
+         */
+        virtual void    get_prefix(prefix_t& prefix) {
+            TreeNode n;
+            get_node(&n);
+            cusr::get_prefix(prefix, &n);
+        };
+
+        /** 
+         * @brief Append the program using the fused LINTERM and CFSTEP opcodes where the model supports them
+         * Shorter than get_prefix() with bounded stack use, the default is the plain prefix
+         * @param prefix nodes are appended, allowing the caller to reuse its capacity
+         */
+        virtual void    get_fused_prefix(prefix_t& prefix) { get_prefix(prefix); };
+
         /** 
          * @brief evaluate the fitness of the model
          * @param values 
@@ -87,11 +101,71 @@ class Model {
          */
         virtual double  evaluate(vector<double> & values) { return numeric_limits<double>::max(); };
 
-        virtual vector<double>  evaluate_der(vector<double> & values) { return {numeric_limits<double>::max(),numeric_limits<double>::max()}; };
-        virtual vector<double>  evaluate_der2(vector<double> & values) { return {numeric_limits<double>::max(),numeric_limits<double>::max(),numeric_limits<double>::max()}; };
+        /**
+         * @brief evaluate the model at many samples, models override this to hoist per-model work out of the sample loop
+         * @param samples sample values
+         * @param selected indices of samples to evaluate, all samples when empty
+         * @param out model values in the order of selected, resized
+         */
+        virtual void    evaluate_batch(vector<vector<double>>& samples, vector<size_t>& selected, vector<double>& out) {
+            size_t n = selected.empty() ? samples.size() : selected.size();
+            out.resize(n);
+            for(size_t i = 0; i < n; i++)
+                out[i] = evaluate(samples[selected.empty() ? i : selected[i]]);
+        };
+
+        /**
+         * @brief evaluate the model in single precision over column-major samples, see DataSet::columns_float
+         * The default evaluates each sample in double
+         * @param columns columns[j][i] is variable j of sample i
+         * @param count number of samples
+         * @param selected indices of samples to evaluate, all samples when empty
+         * @param out model values in the order of selected, resized
+         */
+        virtual void    evaluate_batch_float(vector<vector<float>>& columns, size_t count, vector<size_t>& selected, vector<float>& out) {
+            size_t n = selected.empty() ? count : selected.size();
+            out.resize(n);
+            vector<double> row(columns.size());
+            for(size_t i = 0; i < n; i++) {
+                size_t r = selected.empty() ? i : selected[i];
+                for(size_t j = 0; j < columns.size(); j++)
+                    row[j] = columns[j][r];
+                out[i] = evaluate(row);
+            }
+        };
+
+        /**
+         * @brief evaluate the model and its derivatives with respect to a single independent variable
+         * @param values sample values to evaluate at
+         * @param order highest derivative order to return
+         * @param iv index of the independent variable to differentiate against
+         * @return vector of order+1 values, the evaluation followed by the 1st..order-th derivative
+         */
+        virtual vector<double>  evaluate_ders(vector<double> & values, size_t order, size_t iv = 0) { return vector<double>(order+1, numeric_limits<double>::max()); };
 
-        virtual vector<double>  evaluate_der3(vector<double> & values) { return {numeric_limits<double>::max(),numeric_limits<double>::max(),numeric_limits<double>::max(),numeric_limits<double>::max()}; };
+        /** @brief evaluation and 1st derivative with respect to the first independent variable */
+        vector<double>  evaluate_der(vector<double> & values)   { return evaluate_ders(values, 1); };
+
+        /** @brief evaluation, 1st and 2nd derivative with respect to the first independent variable */
+        vector<double>  evaluate_der2(vector<double> & values)  { return evaluate_ders(values, 2); };
+
+        /** @brief evaluation, 1st, 2nd and 3rd derivative with respect to the first independent variable */
+        vector<double>  evaluate_der3(vector<double> & values)  { return evaluate_ders(values, 3); };
         
+        /** @brief Write the model state for a checkpoint, derived models append their own state after the fitness */
+        virtual void    write(ostream& os) {
+            binary::write(os, penalty);
+            binary::write(os, error);
+            binary::write(os, fitness);
+        };
+
+        /** @brief Restore the model state written by write() */
+        virtual void    read(istream& is) {
+            binary::read(is, penalty);
+            binary::read(is, error);
+            binary::read(is, fitness);
+        };
+
         virtual void    print()                     {   cout << "model" << endl;};
 
         virtual string  str()                       {   return "model";};
@@ -120,9 +194,6 @@ class Model {
     /** @brief Format to print all CF as naive or recurrence */
         static ExpressionType        EXPRESSION;
 
-        /** @brief TreeNode representation for GPU processing */
-        TreeNode* node = nullptr;
-
     private:
 
         /** @brief Penalty associated to the Model */
@@ -12,6 +12,8 @@ using namespace std;
 
 #include <memetico/model_base/model.h>
 #include <memetico/helpers/rng.h>
+#include <memetico/helpers/telemetry.h>
+#include <memetico/helpers/profile.h>
 
 /**
  * @brief A class extending Model to represent a solution in a genetic or memetic algorithm
@@ -64,7 +66,7 @@ class MemeticModel : public Model {
     public:
         
         MemeticModel() : Model()                            {};
-        MemeticModel(const MemeticModel<T>& m) : Model(m)   {};
+        MemeticModel(const MemeticModel<T>& m) : Model(m), fingerprint(m.fingerprint), fingerprint_key(m.fingerprint_key) {};
 
         /** 
          * @brief setter for active flag at \a pos with value \a val
@@ -109,6 +111,41 @@ class MemeticModel : public Model {
          */
         virtual vector<size_t>      get_active_positions()      {return vector<size_t>();};
 
+        /**  
+         * @brief hash of the structure, active flags and values of all parameters
+         * @returns hash that differs, with high probability, when the model would evaluate differently, or 0 when not supported
+         */
+        virtual size_t  coefficient_hash()                  { return 0; };
+
+        /** Squared residuals on the probe samples of Population::fingerprint(), copied with the model */
+        vector<double>  fingerprint;
+
+        /** coefficient_hash() and probe set the fingerprint was computed for, 0 when not computed */
+        size_t          fingerprint_key = 0;
+
+        /**  
+         * @brief evaluate the model and its gradient with respect to the parameters at \a positions
+         * The default takes central differences through set_value(), models override with analytic gradients
+         * @param values sample values to evaluate at
+         * @param positions parameter positions to differentiate against, e.g. get_active_positions()
+         * @param grad gradient output, resized to positions.size()
+         * @returns evaluation of the model at \a values
+         */
+        virtual double  evaluate_grad(vector<double>& values, vector<size_t>& positions, vector<double>& grad) {
+            grad.resize(positions.size());
+            for(size_t j = 0; j < positions.size(); j++) {
+                T orig = get_value(positions[j]);
+                double h = 1e-6*max(1.0, fabs(double(orig)));
+                set_value(positions[j], orig+h);
+                double fp = evaluate(values);
+                set_value(positions[j], orig-h);
+                double fm = evaluate(values);
+                set_value(positions[j], orig);
+                grad[j] = (fp-fm)/(2*h);
+            }
+            return evaluate(values);
+        };
+
         /**  
          * @brief mutate \a this MemeticModel and optionally consider another model m 
          * @param m another model to consider in the mutation
@@ -131,6 +168,7 @@ class MemeticModel : public Model {
 
         /** @brief Perform objective function on MemeticModel */
         virtual double  objective(DataSet* data, vector<size_t> idx = vector<size_t>()) {
+            telemetry::count(telemetry::ObjectiveCalls);
             return OBJECTIVE(this, data, idx);
         };
 
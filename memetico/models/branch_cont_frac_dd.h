@@ -163,34 +163,24 @@ class BranchedContinuedFraction : public ContinuedFractionDynamicDepth<Traits> {
             return true;
         }
 
-        void set_depth(size_t new_depth) {
+        /** @brief Set depth as ContinuedFraction::set_depth(), new sub fractions are copies of the last set to a constant */
+        void set_depth(size_t new_depth)    { ContinuedFraction<Traits>::set_depth(new_depth); };
 
-            size_t  new_frac_terms = 2*new_depth+1;
-
-            // If we are reducing terms, simply remove the number of terms from the vector
-            if( new_frac_terms < this->get_frac_terms()) {
-
-                size_t excess_terms = this->get_frac_terms()-new_frac_terms;
-                for(size_t i = 0; i < excess_terms; i++)
-                    this->pop_terms();
-
-            // If we are adding terms, we need to increase terms
-            } else {
-
-                size_t new_terms = new_frac_terms-this->get_frac_terms();
-                for(size_t i = 0; i < new_terms; i++) {
-                    typename Traits::TType new_term  = typename Traits::TType(1);
-                    new_term.randomise();
-                    this->add_terms(new_term);
-                }
-
-            }
-
-            this->set_depth_val(new_depth);
+        size_t get_sub_depth() {return this->sub_depth;};
 
-        }
+        /** @brief Write as ContinuedFraction::write() followed by the sub fraction depth */
+        void    write(ostream& os) override {
+            ContinuedFraction<Traits>::write(os);
+            binary::write(os, (uint64_t) sub_depth);
+        };
 
-        size_t get_sub_depth() {return this->sub_depth;};
+        /** @brief Restore a fraction written by write() */
+        void    read(istream& is) override {
+            ContinuedFraction<Traits>::read(is);
+            uint64_t d;
+            binary::read(is, d);
+            sub_depth = d;
+        };
 
     private:
 
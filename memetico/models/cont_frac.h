@@ -15,6 +15,7 @@
 #include <memetico/model_base/model_meme.h>
 #include <memetico/helpers/print.h>
 #include <memetico/models/regression.h>
+#include <memetico/models/cont_frac_eval.h>
 
 // Std
 #include <stdexcept>
@@ -24,6 +25,7 @@
 #include <math.h>
 #include <unordered_set>
 #include <unordered_map>
+#include <cstring>
 
 /**
  * @brief The ContinuedFraction class extends the MemeticModel class for a new Model representation
@@ -95,8 +97,16 @@ class ContinuedFraction : public MemeticModel<typename Traits::UType>,
             terms[term_from_pos(pos)].set_active(param_from_pos(pos), val);
         };
 
-        /** @brief Return total number of active parameters across the entire fraction */
-        size_t  get_count_active() override { return get_active_positions().size(); };
+        /** @brief Return total number of active parameters across the entire fraction, from the active counts kept by each term */
+        size_t  get_count_active() override {
+            size_t count = 0;
+            for(size_t i = 0; i < get_frac_terms(); i++)
+                count += terms[i].get_count_active();
+            return count;
+        };
+
+        /** @brief Hash of the depth and the active flags and values of every term */
+        size_t  coefficient_hash() override;
 
         /** @brief Return vector of indices of the active variables positions*/
         vector<size_t>  get_active_positions() override;
@@ -104,6 +114,15 @@ class ContinuedFraction : public MemeticModel<typename Traits::UType>,
         /** @brief Return TreeNode for GPU processing */
         void    get_node(TreeNode * n) override;
 
+        /** @brief Append prefix encoding g0 + h0/(g1 + h1/(...)) i.e. ADD g0 DIV h0 ADD g1 DIV h1 ... gd */
+        void    get_prefix(prefix_t& prefix) override;
+
+        /** 
+         * @brief Append the fused program CFSTEP_d h_{d-1} g_d ... CFSTEP_1 h0 g1 CFSTEP_0 g0 with each term a LINTERM
+         * - Evaluates by the modified Lentz algorithm as evaluate(), with a stack depth of at most 3 for any depth
+         */
+        void    get_fused_prefix(prefix_t& prefix) override;
+
         /** @brief Comparison operator for ContinuedFraction<T> */
         bool    operator== (ContinuedFraction<Traits>& o);
 
@@ -145,6 +164,8 @@ class ContinuedFraction : public MemeticModel<typename Traits::UType>,
          */
         void    mutate(MemeticModel<typename Traits::UType>& pocket) override {
 
+            PROFILE_SCOPE("mutate");
+
             // Call mutation policy
             Traits::template MPType<typename Traits::UType, ContinuedFraction<Traits>>::mutate(pocket);
 
@@ -171,12 +192,86 @@ class ContinuedFraction : public MemeticModel<typename Traits::UType>,
          */
         double  evaluate(vector<double>& values) override;
 
-        vector<double>  evaluate_der(vector<double>& values) override;
+        /** 
+         * @brief Evaluate a ContinuedFraction at many samples
+         * - Flatten the coefficients once, with inactive parameters as zero
+         * - Evaluate every sample with the evaluator for the depth and variable count, see cont_frac_eval.h
+         * - Without a compile time evaluator, only the active coefficients of each term are evaluated by cf_eval_sparse()
+         * - Samples that are not finite are re-evaluated by evaluate() so failures are handled as before
+         * - Fractions whose terms are not Regressions use the per sample evaluate()
+         *
+         * @param samples sample values
+         * @param selected indices of samples to evaluate, all samples when empty
+         * @param out values of the fraction in the order of selected
+         */
+        void    evaluate_batch(vector<vector<double>>& samples, vector<size_t>& selected, vector<double>& out) override;
+
+        /** 
+         * @brief Evaluate a ContinuedFraction in single precision over column-major samples
+         * - As evaluate_batch() with float coefficients, vectorised across samples
+         * - Samples that are not finite are re-evaluated in double by evaluate()
+         *
+         * @param columns columns[j][i] is variable j of sample i
+         * @param count number of samples
+         * @param selected indices of samples to evaluate, all samples when empty
+         * @param out values of the fraction in the order of selected
+         */
+        void    evaluate_batch_float(vector<vector<float>>& columns, size_t count, vector<size_t>& selected, vector<float>& out) override;
+
+        /** 
+         * @brief Evaluate a ContinuedFraction and its gradient with respect to the parameters at \a positions
+         * - Evaluate each term once and form the tails \f$T_i = g_i + h_i/T_{i+1}\f$ from the bottom of the fraction
+         * - Propagate adjoints from \f$T_0\f$ down the tails, giving \f$\partial f/\partial t\f$ for every term \f$t\f$
+         * - Chain each term adjoint with the partial derivative of the term w.r.t. its own parameter
+         * - Throws on numerical failure of the underlying terms
+         *
+         * @param values an array of sample values to evaluate at
+         * @param positions parameter positions to differentiate against, e.g. get_active_positions()
+         * @param grad gradient output, resized to positions.size()
+         * @return value of the continued fraction evaluated at \a values
+         */
+        double  evaluate_grad(vector<double>& values, vector<size_t>& positions, vector<double>& grad) override;
+
+        /** @brief Partial derivative of the fraction with respect to the parameter at \a pos */
+        double  get_partial(vector<double>& values, size_t pos) {
+            vector<size_t> p = {pos};
+            vector<double> g;
+            evaluate_grad(values, p, g);
+            return g[0];
+        };
 
-        vector<double>  evaluate_der2(vector<double>& values) override;
+        /** 
+         * @brief Evaluate a ContinuedFraction and its derivatives with respect to one independent variable
+         * - Run the modified Lentz algorithm over Jet<order> values so each term is evaluated once per sample
+         *
+         * @param values an array of sample values to evaluate at
+         * @param order highest derivative order, up to JET_MAX_ORDER
+         * @param iv index of the independent variable to differentiate against
+         * @return evaluation followed by the 1st..order-th derivatives, or max values on numerical failure
+         */
+        vector<double>  evaluate_ders(vector<double>& values, size_t order, size_t iv = 0) override;
 
-        vector<double>  evaluate_der3(vector<double>& values) override;
+        /** 
+         * @brief Evaluate a ContinuedFraction as a Jet, i.e. its value and first N derivatives with respect to \a iv
+         * - Modified Lentz algorithm with the tiny value safeguards applied to the value of each Jet
+         * - Throws on numerical failure of the underlying terms
+         *
+         * @param values an array of sample values to evaluate at
+         * @param iv index of the independent variable to differentiate against
+         * @return Jet of the fraction at \a values
+         */
+        template <size_t N>
+        Jet<N>  evaluate_jet(vector<double>& values, size_t iv);
     
+        /** 
+         * @brief Write the fitness, shape, terms and mutation policy state for a checkpoint
+         * - Terms write themselves, so fractions of fractions nest
+         */
+        void    write(ostream& os) override;
+
+        /** @brief Restore a fraction written by write(), replacing its depth and terms */
+        void    read(istream& is) override;
+
         /** @brief Print the solution to stdout */
         void print() override { 
             cout << *this << endl; 
@@ -215,12 +310,23 @@ class ContinuedFraction : public MemeticModel<typename Traits::UType>,
 
         void    pop_terms()    { terms.pop_back(); };
 
-        void    set_params_per_term(size_t p)    { params_per_term = p; };
+        void    set_params_per_term(size_t p)    { params_per_term = p; select_evaluator(); };
 
-        /** @brief Set depth of the fraction and remove/add randomised terms */
+        /**
+         * @brief Set depth of the fraction, warm starting from its current coefficients
+         * - Growth appends a zero numerator and a constant 1 denominator per level, leaving the value unchanged
+         * - Shrink folds the removed tail into the new last term as its linear approximation about the origin,
+         *   or truncates when the tail is not finite there
+         */
         void    set_depth(size_t new_depth);
+
+        /** @brief Set every term to a constant so the fraction is \a c everywhere, keeping the active flags */
+        void    set_constant(typename Traits::UType c);
+
+        /** @brief Add the linear function \a coeffs, one coefficient per variable followed by the constant, to the first term */
+        void    add_linear(vector<typename Traits::UType>& coeffs)  { terms[0].add_linear(coeffs); };
         
-        void    set_depth_val(size_t new_depth) {depth = new_depth;};
+        void    set_depth_val(size_t new_depth) {depth = new_depth; select_evaluator(); };
 
         /**
          * @brief 
@@ -244,6 +350,55 @@ class ContinuedFraction : public MemeticModel<typename Traits::UType>,
         /** Number of parameters in each term. As this is a linear model we have Data::IVS.size()+1 where the +1 is the constant*/
         size_t  params_per_term;
 
+        /** Compile time evaluators for the depth and variable count, nullptr for the runtime evaluator */
+        const CFEvalEntry*  evaluator;
+
+        /** @brief Return the value at \a values of the tail of the fraction below term \a last, by backward recurrence */
+        double  tail(vector<double>& values, size_t last);
+
+        /** @brief Call \a fn(j) for each active parameter j of term \a t in ascending order, without copying the list of a Regression */
+        template <class F>
+        void    for_active(size_t t, F fn) {
+            if constexpr ( is_same<typename Traits::TType, Regression<typename Traits::UType>>::value ) {
+                for(size_t j : terms[t].get_active_list())
+                    fn(j);
+            } else {
+                for(size_t j : terms[t].get_active_positions())
+                    fn(j);
+            }
+        };
+
+        /** @brief Return true when no active parameter of term \a t is larger than 1e-16 in magnitude */
+        bool    term_is_zero(size_t t) {
+            bool zero = true;
+            for_active(t, [&](size_t j) { zero = zero && !(fabs(terms[t].get_value(j)) > 1e-16); });
+            return zero;
+        };
+
+        /** @brief Fill \a s with the active coefficients of every term for cf_eval_sparse() */
+        template <typename T>
+        void    sparse_coefficients(CFSparse<T>& s) {
+            size_t constant = params_per_term-1;
+            s.start.assign(1, 0);
+            s.idx.clear();
+            s.coef.clear();
+            s.constant.assign(get_frac_terms(), 0);
+            for(size_t t = 0; t < get_frac_terms(); t++) {
+                for_active(t, [&](size_t j) {
+                    if( j == constant ) {
+                        s.constant[t] = terms[t].get_value(j);
+                    } else {
+                        s.idx.push_back(j);
+                        s.coef.push_back(terms[t].get_value(j));
+                    }
+                });
+                s.start.push_back(s.idx.size());
+            }
+        };
+
+        /** @brief Choose the evaluator after the depth or params_per_term change */
+        void    select_evaluator() { evaluator = params_per_term > 0 ? cf_eval_select(depth, params_per_term-1) : nullptr; };
+
 };
 
 #include <memetico/models/cont_frac.tpp>
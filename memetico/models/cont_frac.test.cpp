@@ -5,6 +5,7 @@
 #include <sstream>
 #include <memetico/optimise/objective.h>
 #include <memetico/models/mutation.h>
+#include <memetico/gpu/interpreter.h>
 
 // Define the template strucutre of a model
 template<
@@ -294,6 +295,68 @@ TEST_CASE("ContinuedFractions: set_depth, get_terms, set_terms, get_count_active
 
 }
 
+TEST_CASE("ContinuedFractions: set_depth warm start") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    size_t params = 6;
+    setup_cont_frac_ivs(params);
+
+    vector<vector<double>> samples;
+    for(size_t i = 0; i < 20; i++) {
+        vector<double> s;
+        for(size_t j = 0; j < params-1; j++)
+            s.push_back(rr.rand()*2-1);
+        samples.push_back(s);
+    }
+
+    // 1. Growth keeps the value and the active flags of the last term, new numerators are zero
+    ModelType c = frac_3();
+    ModelType grown = c;
+    grown.set_depth(3);
+    REQUIRE( grown.get_depth() == 3 );
+    REQUIRE( grown.terms.size() == 7 );
+    for(vector<double>& s : samples) {
+        CHECK( grown.evaluate(s) == doctest::Approx(c.evaluate(s)) );
+        CHECK( grown.get_terms(3).evaluate(s) == 0 );
+        CHECK( grown.get_terms(4).evaluate(s) == 1 );
+    }
+    for(size_t j = 0; j < params-1; j++)
+        CHECK( grown.get_terms(5).get_active(j) == c.get_terms(2).get_active(j) );
+
+    // 2. Shrinking to the original depth truncates the neutral tail exactly
+    grown.set_depth(1);
+    for(vector<double>& s : samples)
+        CHECK( grown.evaluate(s) == doctest::Approx(c.evaluate(s)) );
+
+    // 3. A linear tail is folded into the last term, t1(x) + t2(x) / (t3(x) + (3x2+1)/2), turning x2 on
+    ModelType d = frac_3();
+    d.set_depth(2);
+    TermType h = build_reg_frac({false, true, false, false, false, true}, {0, 3, 0, 0, 0, 1}, params);
+    TermType g = build_reg_frac({false, false, false, false, false, true}, {0, 0, 0, 0, 0, 2}, params);
+    d.set_terms(3, h);
+    d.set_terms(4, g);
+    ModelType folded = d;
+    folded.set_depth(1);
+    REQUIRE( folded.get_depth() == 1 );
+    CHECK( folded.get_terms(2).get_active(1) );
+    CHECK( folded.get_terms(2).get_value(1) == doctest::Approx(1.5) );
+    CHECK( folded.get_terms(2).get_value(5) == doctest::Approx(-20+0.5) );
+    for(vector<double>& s : samples)
+        CHECK( folded.evaluate(s) == doctest::Approx(d.evaluate(s)) );
+
+    // 4. A tail with a pole at the origin is truncated
+    g = build_reg_frac({true, false, false, false, false, false}, {1, 0, 0, 0, 0, 0}, params);
+    d.set_terms(4, g);
+    ModelType truncated = d;
+    truncated.set_depth(1);
+    CHECK( truncated.get_terms(2) == d.get_terms(2) );
+
+}
+
 TEST_CASE("ContinuedFractions: ==, ContinuedFractions<T>(ContinuedFractions<T>) ") {
 
     RandInt ri = RandInt(42);
@@ -409,6 +472,99 @@ TEST_CASE("ContinuedFractions: evaluate ") {
 
 }
 
+TEST_CASE("ContinuedFractions: evaluate_ders ") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    size_t params = 6;
+    setup_cont_frac_ivs(params);
+
+    // t1(x) =  x1 + 2x3 + 3x5 - 20
+    // t2(x) = -3x2 + 4x4 + 3x5 - 3
+    // t3(x) =  x1 + 2x3 + 3x5 - 20
+    // f(x) = t1(x) + t2(x) / t3(x)
+    ModelType o = frac_3();
+    vector<double> values = {4, 20, -3, 15, -3};
+    double t1 = -31;
+    double t2 = -12;
+
+    // 1. Order 0 is the evaluation
+    vector<double> ders = o.evaluate_ders(values, 0);
+    REQUIRE( ders.size() == 1 );
+    CHECK( ders[0] == doctest::Approx(o.evaluate(values)) );
+
+    // 2. With respect to x1, t1' = t3' = 1 and t2' = 0
+    // f' = 1 - t2/t1^2, f'' = 2t2/t1^3, f''' = -6t2/t1^4, f'''' = 24t2/t1^5, f''''' = -120t2/t1^6
+    ders = o.evaluate_ders(values, 5, 0);
+    REQUIRE( ders.size() == 6 );
+    CHECK( ders[0] == doctest::Approx(t1 + t2/t1) );
+    CHECK( ders[1] == doctest::Approx(1 - t2/pow(t1,2)).scale(0) );
+    CHECK( ders[2] == doctest::Approx(2*t2/pow(t1,3)).scale(0) );
+    CHECK( ders[3] == doctest::Approx(-6*t2/pow(t1,4)).scale(0) );
+    CHECK( ders[4] == doctest::Approx(24*t2/pow(t1,5)).scale(0) );
+    CHECK( ders[5] == doctest::Approx(-120*t2/pow(t1,6)).scale(0) );
+
+    // 3. Legacy wrappers match the general form
+    vector<double> ders3 = o.evaluate_der3(values);
+    REQUIRE( ders3.size() == 4 );
+    for(size_t k = 0; k < ders3.size(); k++)
+        CHECK( ders3[k] == doctest::Approx(ders[k]).scale(0) );
+
+    // 4. With respect to x2 only t2 varies, f' = -3/t1 and higher orders vanish
+    ders = o.evaluate_ders(values, 3, 1);
+    CHECK( ders[1] == doctest::Approx(-3/t1).scale(0) );
+    CHECK( ders[2] == doctest::Approx(0) );
+    CHECK( ders[3] == doctest::Approx(0) );
+
+    // 5. Orders beyond the compiled jets are rejected
+    CHECK_THROWS( o.evaluate_ders(values, JET_MAX_ORDER+1) );
+
+}
+
+TEST_CASE("ContinuedFractions: evaluate_grad ") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    size_t params = 6;
+    setup_cont_frac_ivs(params);
+
+    // t1(x) =  x1 + 2x3 + 3x5 - 20, t2(x) = -3x2 + 4x4 + 3x5 - 3
+    // f(x) = t1 + t2/(t1 + t1/(t1 + t2/t1))
+    ModelType o2 = frac_3();
+    ModelType o = ModelType(2);
+    o.set_terms(0, o2.get_terms(0));
+    o.set_terms(1, o2.get_terms(1));
+    o.set_terms(2, o2.get_terms(0));
+    o.set_terms(3, o2.get_terms(0));
+    o.set_terms(4, o2.get_terms(1));
+    vector<double> values = {3.1, -43.2, -32.1, 34.2, -3.1};
+
+    // 1. Value matches evaluate
+    vector<size_t> positions = o.get_active_positions();
+    vector<double> grad;
+    CHECK( o.evaluate_grad(values, positions, grad) == doctest::Approx(o.evaluate(values)) );
+    REQUIRE( grad.size() == positions.size() );
+
+    // 2. Gradient matches central differences
+    vector<double> numeric;
+    o.MemeticModel<double>::evaluate_grad(values, positions, numeric);
+    for(size_t j = 0; j < positions.size(); j++)
+        CHECK( grad[j] == doctest::Approx(numeric[j]).epsilon(1e-5) );
+
+    // 3. Subset of positions, g0 is additive so every parameter of t0 has its variable as gradient
+    vector<size_t> first = {0, 5};
+    o.evaluate_grad(values, first, grad);
+    CHECK( grad[0] == doctest::Approx(values[0]) );
+    CHECK( grad[1] == doctest::Approx(1) );
+
+}
+
 TEST_CASE("ContinuedFractions: mutate ") {
 
     RandInt ri = RandInt(42);
@@ -508,7 +664,8 @@ TEST_CASE("ContinuedFractions: recombine ") {
     // Now results will match those in Regression tests
     ri = RandInt(42);
     rr = RandReal(42);
-    c.recombine(&c1, &c2);
+    // Intersection, shared parameters take c1 + r*(c2-c1)/3 for a random integer r in [-1, 4]
+    c.recombine(&c1, &c2, 1);
     REQUIRE( c.get_active(0) == false );
     REQUIRE( c.get_active(1) == false );
     REQUIRE( c.get_active(2) == false );
@@ -516,7 +673,10 @@ TEST_CASE("ContinuedFractions: recombine ") {
     REQUIRE( c.get_active(4) == true );
     REQUIRE( c.get_active(5) == true );
     REQUIRE( c.get_value(4) == 3 );
-    REQUIRE( to_string(c.get_value(5)) == to_string((double)8/3) );
+    double r = (c.get_value(5)+20)*3/17;
+    REQUIRE( r == doctest::Approx(round(r)) );
+    REQUIRE( round(r) >= -1 );
+    REQUIRE( round(r) <= 4 );
     
     // 2. 
     depth = 1;
@@ -577,6 +737,228 @@ TEST_CASE("ContinuedFractions: << ") {
 
 }
 
+TEST_CASE("ContinuedFractions: get_prefix ") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    size_t params = 6;
+    setup_cont_frac_ivs(params);
+
+    // Prefix matches the flattened TreeNode for depth 0, 1 and 2 fractions
+    ModelType c2 = ModelType(2);
+    c2.set_terms(0, frac_3().get_terms(0));
+    c2.set_terms(1, frac_3().get_terms(1));
+    c2.set_terms(2, frac_3().get_terms(2));
+    c2.set_terms(3, frac_2().get_terms(0));
+    // Term with no active parameters and a term with only a coefficient
+    TermType empty = TermType(params);
+    c2.set_terms(4, empty);
+    TermType single = TermType(params);
+    single.set_active(2, true);
+    single.set_value(2, -5);
+    c2.set_terms(3, single);
+
+    vector<ModelType> fracs = {frac_1(), frac_3(), c2};
+    for(ModelType& c : fracs) {
+
+        TreeNode n;
+        c.get_node(&n);
+        prefix_t from_tree;
+        get_prefix(from_tree, &n);
+
+        prefix_t direct;
+        c.get_prefix(direct);
+
+        REQUIRE( direct.size() == from_tree.size() );
+        for(size_t i = 0; i < direct.size(); i++)
+            CHECK( direct[i] == from_tree[i] );
+    }
+
+    // Appending reuses the buffer
+    prefix_t buf;
+    fracs[1].get_prefix(buf);
+    size_t len = buf.size();
+    buf.clear();
+    fracs[1].get_prefix(buf);
+    CHECK( buf.size() == len );
+
+}
+
+TEST_CASE("ContinuedFractions: evaluate_batch ") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    // Compile time evaluators up to the table limits, runtime beyond
+    CHECK( cf_eval_select(CF_EVAL_MAX_DEPTH, CF_EVAL_MAX_IVS)->batch == &CFEval<CF_EVAL_MAX_DEPTH, CF_EVAL_MAX_IVS>::batch );
+    CHECK( cf_eval_select(CF_EVAL_MAX_DEPTH+1, 1) == nullptr );
+    CHECK( cf_eval_select(1, CF_EVAL_MAX_IVS+1) == nullptr );
+
+    // Batch matches evaluate() for fractions on both sides of the limits, for all samples and a selection
+    for(size_t params : {6, CF_EVAL_MAX_IVS+3}) {
+
+        setup_cont_frac_ivs(params);
+        vector<vector<double>> samples;
+        for(size_t i = 0; i < 20; i++) {
+            samples.push_back({});
+            for(size_t j = 0; j < params-1; j++)
+                samples[i].push_back(RandReal::RANDREAL->rand(-5, 5));
+        }
+        vector<size_t> all;
+        vector<size_t> some = {3, 7, 11};
+
+        for(size_t d = 0; d <= CF_EVAL_MAX_DEPTH+2; d++) {
+
+            ModelType c = ModelType(d);
+            vector<double> out;
+            c.evaluate_batch(samples, all, out);
+            REQUIRE( out.size() == samples.size() );
+            for(size_t i = 0; i < samples.size(); i++)
+                CHECK( out[i] == doctest::Approx(c.evaluate(samples[i])) );
+
+            c.evaluate_batch(samples, some, out);
+            REQUIRE( out.size() == some.size() );
+            for(size_t i = 0; i < some.size(); i++)
+                CHECK( out[i] == doctest::Approx(c.evaluate(samples[some[i]])) );
+
+            // Single precision over columns
+            vector<vector<float>> columns(params-1, vector<float>(samples.size()));
+            for(size_t i = 0; i < samples.size(); i++)
+                for(size_t j = 0; j < params-1; j++)
+                    columns[j][i] = samples[i][j];
+            vector<float> out_float;
+            c.evaluate_batch_float(columns, samples.size(), some, out_float);
+            REQUIRE( out_float.size() == some.size() );
+            for(size_t i = 0; i < some.size(); i++)
+                CHECK( out_float[i] == doctest::Approx(c.evaluate(samples[some[i]])).epsilon(1e-3) );
+
+            // Depth changes select a new evaluator
+            c.set_depth(d+1);
+            c.evaluate_batch(samples, all, out);
+            CHECK( out[0] == doctest::Approx(c.evaluate(samples[0])) );
+        }
+    }
+
+}
+
+TEST_CASE("ContinuedFractions: active lists ") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    // Term lists stay sorted and match the flags through set_active, copies and read
+    TermType r = TermType({false, true, false, true}, {1, 2, 3, 4});
+    CHECK( r.get_active_list() == vector<size_t>({1, 3}) );
+    r.set_active(2, true);
+    r.set_active(2, true);
+    r.set_active(1, false);
+    r.set_active(1, false);
+    r.set_active(0, true);
+    CHECK( r.get_active_list() == vector<size_t>({0, 2, 3}) );
+    CHECK( r.get_count_active() == 3 );
+
+    TermType copy = r;
+    CHECK( copy.get_active_list() == vector<size_t>({0, 2, 3}) );
+    stringstream ss;
+    r.write(ss);
+    TermType loaded;
+    loaded.read(ss);
+    CHECK( loaded.get_active_list() == vector<size_t>({0, 2, 3}) );
+
+    // Only the active variables and constant are evaluated
+    vector<double> x = {10, 20, 30};
+    CHECK( r.evaluate(x) == 1*10+3*30+4 );
+
+    // Fraction counts and positions follow mutation and recombination of the terms
+    size_t params = CF_EVAL_MAX_IVS+3;
+    setup_cont_frac_ivs(params);
+    for(size_t d : {0, 3, CF_EVAL_MAX_DEPTH+1}) {
+
+        ModelType c1 = ModelType(d);
+        ModelType c2 = ModelType(d);
+        ModelType c3 = ModelType(d);
+        for(size_t i = 0; i < 20; i++) {
+
+            c1.mutate(c2);
+            c3.recombine(&c1, &c2);
+
+            vector<size_t> pos;
+            for(size_t p = 0; p < c3.get_param_count(); p++)
+                if( c3.get_active(p) )
+                    pos.push_back(p);
+            CHECK( c3.get_active_positions() == pos );
+            CHECK( c3.get_count_active() == pos.size() );
+        }
+
+        // Sparse evaluation matches the dense runtime evaluator exactly
+        vector<vector<double>> samples(100, vector<double>(params-1));
+        for(vector<double>& sample : samples)
+            for(double& v : sample)
+                v = RandReal::RANDREAL->rand(-5, 5);
+
+        vector<double> dense(params*c3.get_frac_terms());
+        for(size_t p = 0; p < c3.get_param_count(); p++)
+            dense[p] = c3.get_active(p) ? c3.get_value(p) : 0;
+
+        CFSparse<double> s;
+        s.start = {0};
+        for(size_t t = 0; t < c3.get_frac_terms(); t++) {
+            s.constant.push_back(dense[t*params+params-1]);
+            for(size_t j : c3.get_terms(t).get_active_list())
+                if( j != params-1 ) {
+                    s.idx.push_back(j);
+                    s.coef.push_back(dense[t*params+j]);
+                }
+            s.start.push_back(s.idx.size());
+        }
+
+        vector<double> out(samples.size());
+        cf_eval_sparse(s, [&samples](size_t j, size_t i) { return samples[i][j]; }, d, samples.size(), out.data());
+        for(size_t i = 0; i < samples.size(); i++)
+            CHECK( out[i] == cf_eval_runtime(dense.data(), [&](size_t j) { return samples[i][j]; }, d, params-1) );
+    }
+
+}
+
+TEST_CASE("ContinuedFractions: get_fused_prefix ") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    size_t params = 6;
+    setup_cont_frac_ivs(params);
+
+    // Fused program matches evaluate() for fixed fractions and random fractions up to depth 12
+    vector<ModelType> fracs = {frac_1(), frac_3()};
+    for(size_t d = 0; d <= 12; d += 3)
+        fracs.push_back(ModelType(d));
+
+    vector<double> values = {3.1, -43.2, -32.1, 34.2, -3.1};
+    for(ModelType& c : fracs) {
+
+        prefix_t fused;
+        c.get_fused_prefix(fused);
+        CHECK( interpret<double>(fused, values) == doctest::Approx(c.evaluate(values)) );
+
+        // Bounded stack use and shorter than the plain prefix
+        prefix_t plain;
+        c.get_prefix(plain);
+        CHECK( stack_depth(fused) <= 3 );
+        CHECK( fused.size() <= plain.size() );
+        CHECK( interpret<double>(plain, values) == doctest::Approx(c.evaluate(values)).epsilon(1e-6) );
+    }
+
+}
+
 TEST_CASE("ContinuedFractions: get_node ") {
 
     RandInt ri = RandInt(42);
@@ -585,7 +967,6 @@ TEST_CASE("ContinuedFractions: get_node ") {
     RandReal::RANDREAL = &rr;
 
     size_t params = 6;
-    size_t depth = 0;
     setup_cont_frac_ivs(params);
     
     // Test
@@ -12,6 +12,7 @@ ContinuedFraction<Traits>::ContinuedFraction(size_t frac_depth) : MemeticModel<t
     // Default values
     depth = frac_depth;
     params_per_term = MemeticModel<typename Traits::UType>::IVS.size()+1;
+    select_evaluator();
 
     for(size_t i = 0; i < get_frac_terms(); i++)
         terms.push_back(typename Traits::TType(params_per_term));
@@ -27,6 +28,7 @@ ContinuedFraction<Traits>::ContinuedFraction(const ContinuedFraction<Traits> &o)
 
     depth = o.get_depth();
     params_per_term = o.get_params_per_term();
+    evaluator = o.evaluator;
 
     for(size_t i = 0; i < o.get_frac_terms(); i++) {
         typename Traits::TType temp = typename Traits::TType(o.terms[i]);
@@ -35,6 +37,66 @@ ContinuedFraction<Traits>::ContinuedFraction(const ContinuedFraction<Traits> &o)
 
 }
 
+template <typename Traits>
+void ContinuedFraction<Traits>::write(ostream& os) {
+
+    Model::write(os);
+    binary::write(os, (uint64_t) depth);
+    binary::write(os, (uint64_t) params_per_term);
+    binary::write(os, (uint64_t) terms.size());
+    for(size_t i = 0; i < terms.size(); i++)
+        terms[i].write(os);
+
+    Traits::template MPType<typename Traits::UType, ContinuedFraction<Traits>>::write_policy(os);
+
+}
+
+template <typename Traits>
+void ContinuedFraction<Traits>::read(istream& is) {
+
+    Model::read(is);
+
+    uint64_t d, p, n;
+    binary::read(is, d);
+    binary::read(is, p);
+    binary::read(is, n);
+    depth = d;
+    params_per_term = p;
+
+    if( n != get_frac_terms() )
+        throw runtime_error("ContinuedFraction::read() term count does not match the depth");
+
+    terms.resize(n);
+    for(size_t i = 0; i < n; i++)
+        terms[i].read(is);
+
+    Traits::template MPType<typename Traits::UType, ContinuedFraction<Traits>>::read_policy(is);
+    select_evaluator();
+
+}
+
+template <typename Traits>
+size_t ContinuedFraction<Traits>::coefficient_hash() {
+
+    // Mixed word by word as hash_words(), sub fractions of branched models hash recursively
+    uint64_t value = hash_mix(depth);
+
+    for(size_t t = 0; t < get_frac_terms(); t++) {
+        if constexpr ( is_same<typename Traits::TType, Regression<typename Traits::UType>>::value ) {
+            for(size_t j = 0; j < terms[t].get_count(); j++) {
+                double v = terms[t].get_active(j) ? (double) terms[t].get_value(j) : 0;
+                uint64_t bits;
+                memcpy(&bits, &v, sizeof(bits));
+                value = hash_mix(value ^ bits ^ (uint64_t) terms[t].get_active(j));
+            }
+        } else {
+            value = hash_mix(value ^ terms[t].coefficient_hash());
+        }
+    }
+
+    return value;
+}
+
 template <typename Traits>
 void ContinuedFraction<Traits>::sanitise() {
 
@@ -45,25 +107,10 @@ void ContinuedFraction<Traits>::sanitise() {
     // Process terms from 2 to end of terms, using two at a time
     for(size_t idx_term = 2; idx_term < get_frac_terms()-1; idx_term+=2) {
         
-        actives_are_zero_even = true;
-        actives_are_zero_odd = true;
+        // if any active parameter of either term is larger than epsilon, then no sanitise to occur
+        actives_are_zero_even = term_is_zero(idx_term);
+        actives_are_zero_odd = term_is_zero(idx_term+1);
 
-        // Get active elements in term
-        for(size_t j : terms[idx_term].get_active_positions()) {
-            
-            // if any term is non-zero or larger than epsilon, then no sanitise to occur
-            if( fabs(terms[idx_term].get_value(j))>1e-16 ){
-                actives_are_zero_even = false;
-                break;
-            }
-        }
-        // Same for the next term
-        for(size_t j : terms[idx_term+1].get_active_positions()) {
-            if( fabs(terms[idx_term+1].get_value(j))>1e-16 ){
-                actives_are_zero_odd = false;
-                break;
-            }
-	    }
         // If either numerator or denominator is empty, set constant as on and to 1
         if( actives_are_zero_even && actives_are_zero_odd ){
             
@@ -75,13 +122,7 @@ void ContinuedFraction<Traits>::sanitise() {
     }
 
     // Process last term
-    actives_are_zero_even = true;
-    for(size_t j : terms[get_frac_terms()-1].get_active_positions()) {
-        if( fabs(terms[get_frac_terms()-1].get_value(j))>1e-16 ){
-            actives_are_zero_even = false;
-            break;
-        }
-    }    
+    actives_are_zero_even = term_is_zero(get_frac_terms()-1);
     if( actives_are_zero_even ) {
         terms[get_frac_terms()-1].set_active(params_per_term-1, true);
         if( fabs(terms[get_frac_terms()-1].get_value(params_per_term-1))<1e-16 )
@@ -92,6 +133,8 @@ void ContinuedFraction<Traits>::sanitise() {
 template <typename Traits>
 double ContinuedFraction<Traits>::evaluate(vector<double>& values) {
 
+    PROFILE_SCOPE("evaluate");
+
     sanitise();
     double ret = 0;
 
@@ -181,355 +224,258 @@ double ContinuedFraction<Traits>::evaluate(vector<double>& values) {
 }
 
 template <typename Traits>
-vector<double> ContinuedFraction<Traits>::evaluate_der(vector<double>& values) {
+void ContinuedFraction<Traits>::evaluate_batch(vector<vector<double>>& samples, vector<size_t>& selected, vector<double>& out) {
 
-    // Returns CF evaluation and 1st derivative
-    // Assuming linear terms
-    
-    sanitise();
-    vector<double> ret = {0.0, 0.0};
+    PROFILE_SCOPE("evaluate: batch");
 
-    //--------------- modified Lentz algorithm
-    try {
+    if constexpr ( !is_same<typename Traits::TType, Regression<typename Traits::UType>>::value ) {
+        MemeticModel<typename Traits::UType>::evaluate_batch(samples, selected, out);
+    } else {
 
-        double f_old = terms[0].evaluate(values);
+        if( params_per_term == 0 ) {
+            MemeticModel<typename Traits::UType>::evaluate_batch(samples, selected, out);
+            return;
+        }
 
-        if ( fabs(f_old) < 1.0e-30 )
-            f_old = 1.0e-30;
+        sanitise();
 
-        double C_old = f_old;
-        double D_old = 0.0;
-        double f_new = f_old;
-        double C_new = C_old;
-        double D_new = D_old;
-        double Delta;
-        
-        double df_old = 0;
+        size_t n = selected.empty() ? samples.size() : selected.size();
+        out.resize(n);
 
-        if(terms[0].get_active(0))
-            df_old = terms[0].get_value(0);
+        if( evaluator != nullptr ) {
 
-        double dC_old = df_old;
-        double dD_old = 0;
-        double df_new = df_old;
-        double dC_new = dC_old;
-        double dD_new = dD_old;
+            // Flatten coefficients, inactive parameters contribute nothing
+            static thread_local vector<double> c;
+            c.resize(get_frac_terms()*params_per_term);
+            for(size_t t = 0; t < get_frac_terms(); t++)
+                for(size_t j = 0; j < params_per_term; j++)
+                    c[t*params_per_term+j] = terms[t].get_active(j) ? terms[t].get_value(j) : 0;
 
-        double dbj;
-        double daj;
+            evaluator->batch(c.data(), samples, selected, out.data());
 
-        for(int i=1; i<=get_depth(); i++){
-            
-            // function evaluation
-            D_new = terms[2*i].evaluate(values) + terms[2*i-1].evaluate(values)*D_old;
-            
-            if ( fabs(D_new) < 1.0e-30 )
-                D_new = 1.0e-30;
-
-            D_new = 1.0/D_new;
-            C_new = terms[2*i].evaluate(values) + terms[2*i-1].evaluate(values)/C_old;
-
-            if ( fabs(C_new) < 1.0e-30 )
-                C_new = 1.0e-30;
-
-            Delta = D_new*C_new;
-            f_new = f_old*Delta;
-
-            // derivative evaluation
-            if ( terms[2*i].get_active(0) )
-                dbj = terms[2*i].get_value(0);
-            else
-                dbj = 0;
-
-            if ( terms[2*i-1].get_active(0) )
-                daj = terms[2*i-1].get_value(0);
-            else
-                daj = 0;
-
-            dC_new = dbj + (daj*C_old - terms[2*i-1].evaluate(values)*dC_old)/(C_old*C_old);
-            dD_new = -D_new*D_new*(dbj + daj*D_old + terms[2*i-1].evaluate(values)*dD_old);	    
-            df_new = df_old*Delta + f_old*dC_new*D_new + f_old*C_new*dD_new;
-
-            D_old = D_new;
-            C_old = C_new;
-            f_old = f_new;
-            dD_old = dD_new;
-            dC_old = dC_new;
-            df_old = df_new;	    
-            
+        } else {
+
+            // Wide or deep fractions gather only the active variables of each row
+            static thread_local CFSparse<double> s;
+            static thread_local vector<const double*> rows;
+            sparse_coefficients(s);
+            rows.resize(n);
+            for(size_t i = 0; i < n; i++)
+                rows[i] = samples[selected.empty() ? i : selected[i]].data();
+            const double* const* r = rows.data();
+            cf_eval_sparse(s, [r](size_t j, size_t i) { return r[i][j]; }, depth, n, out.data());
         }
-        ret[0] = f_new;
-        ret[1] = df_new;
-    }
-    catch (exception& e) {
-        // cout << "[cont_frac.tpp] numerical exception in evaluate_der()" << endl;
-        // print();
-        ret[0] = numeric_limits<double>::max();
-        ret[1] = numeric_limits<double>::max();
-        return ret;
+
+        // Failures take the reference path, which throws or falls back to the recurrence formula
+        for(size_t i = 0; i < n; i++)
+            if( !isfinite(out[i]) )
+                out[i] = evaluate(samples[selected.empty() ? i : selected[i]]);
     }
 
-    return ret;
 }
 
 template <typename Traits>
-vector<double> ContinuedFraction<Traits>::evaluate_der2(vector<double>& values) {
+void ContinuedFraction<Traits>::evaluate_batch_float(vector<vector<float>>& columns, size_t count, vector<size_t>& selected, vector<float>& out) {
+
+    PROFILE_SCOPE("evaluate: batch_float");
+
+    if constexpr ( !is_same<typename Traits::TType, Regression<typename Traits::UType>>::value ) {
+        MemeticModel<typename Traits::UType>::evaluate_batch_float(columns, count, selected, out);
+    } else {
+
+        if( params_per_term == 0 ) {
+            MemeticModel<typename Traits::UType>::evaluate_batch_float(columns, count, selected, out);
+            return;
+        }
+
+        sanitise();
 
-    // Returns CF evaluation, 1st derivative and 2nd derivative
-    // Assuming linear terms
+        size_t n = selected.empty() ? count : selected.size();
+        out.resize(n);
+
+        if( evaluator != nullptr ) {
+
+            static thread_local vector<float> c;
+            c.resize(get_frac_terms()*params_per_term);
+            for(size_t t = 0; t < get_frac_terms(); t++)
+                for(size_t j = 0; j < params_per_term; j++)
+                    c[t*params_per_term+j] = terms[t].get_active(j) ? terms[t].get_value(j) : 0;
+
+            evaluator->batch_float(c.data(), columns, count, selected, out.data());
+
+        } else {
+
+            // Active columns are streamed for all samples and gathered for a selection
+            static thread_local CFSparse<float> s;
+            sparse_coefficients(s);
+            if( selected.empty() ) {
+                cf_eval_sparse(s, [&columns](size_t j, size_t i) { return columns[j].data()[i]; }, depth, n, out.data());
+            } else {
+                const size_t* sel = selected.data();
+                cf_eval_sparse(s, [&columns, sel](size_t j, size_t i) { return columns[j].data()[sel[i]]; }, depth, n, out.data());
+            }
+        }
+
+        // Overflow in float, or failures, take the double path
+        static thread_local vector<double> row;
+        for(size_t i = 0; i < n; i++) {
+            if( isfinite(out[i]) )
+                continue;
+            size_t r = selected.empty() ? i : selected[i];
+            row.resize(columns.size());
+            for(size_t j = 0; j < columns.size(); j++)
+                row[j] = columns[j][r];
+            out[i] = evaluate(row);
+        }
+    }
+
+}
+
+template <typename Traits>
+double ContinuedFraction<Traits>::evaluate_grad(vector<double>& values, vector<size_t>& positions, vector<double>& grad) {
 
     sanitise();
-    vector<double> ret = {0.0, 0.0, 0.0};
 
-    //--------------- modified Lentz algorithm
-    try {
-    	double f_old = terms[0].evaluate(values);
-    	if ( fabs(f_old) < 1.0e-30 )
-    	    f_old = 1.0e-30;
-    	double C_old = f_old;
-    	double D_old = 0.0;
-    	double f_new = f_old;
-    	double C_new = C_old;
-    	double D_new = D_old;
-    	double Delta;
-	
-    	double df_old = 0;
-    	if(terms[0].get_active(0))
-    	    df_old = terms[0].get_value(0);
-    	double dC_old = df_old;
-    	double dD_old = 0;
-    	double df_new = df_old;
-    	double dC_new = dC_old;
-    	double dD_new = dD_old;
-    	double dbj;
-    	double daj;
-
-    	double d2f_old = 0;
-    	double d2C_old = d2f_old;
-    	double d2D_old = 0;
-    	double d2f_new = d2f_old;
-    	double d2C_new = d2C_old;
-    	double d2D_new = d2D_old;
-
-    	for(int i=1; i<=get_depth(); i++){
-	    
-    	    // function evaluation
-    	    D_new = terms[2*i].evaluate(values) + terms[2*i-1].evaluate(values)*D_old;
-
-    	    if ( fabs(D_new) < 1.0e-30 )
-    		    D_new = 1.0e-30;
-
-    	    D_new = 1.0/D_new;
-    	    C_new = terms[2*i].evaluate(values) + terms[2*i-1].evaluate(values)/C_old;
-
-    	    if ( fabs(C_new) < 1.0e-30 )
-    		    C_new = 1.0e-30;
-
-    	    Delta = D_new*C_new;
-    	    f_new = f_old*Delta;
-
-    	    // 1st derivative evaluation
-    	    if ( terms[2*i].get_active(0) )
-    		    dbj = terms[2*i].get_value(0);
-    	    else
-    		    dbj = 0;
-
-    	    if ( terms[2*i-1].get_active(0) )
-    		    daj = terms[2*i-1].get_value(0);
-    	    else
-    		    daj = 0;
-
-    	    dC_new = dbj + (daj*C_old - terms[2*i-1].evaluate(values)*dC_old)/(C_old*C_old);
-
-	        if ( fabs(dC_new) < 1.0e-30 )
-    		    dC_new = 1.0e-30;
-    	    
-            dD_new = -D_new*D_new*(dbj + daj*D_old + terms[2*i-1].evaluate(values)*dD_old);
-	        
-            if ( fabs(dD_new) < 1.0e-30 )
-    		    dD_new = 1.0e-30;
-    	    
-            df_new = df_old*Delta + f_old*dC_new*D_new + f_old*C_new*dD_new;
-
-    	    // 2nd derivative evaluation
-    	    d2C_new = (-terms[2*i-1].evaluate(values)*d2C_old)/(C_old*C_old) - (2*daj*dC_old)/(C_old*C_old) + (2*terms[2*i-1].evaluate(values)*dC_old*dC_old)/(C_old*C_old*C_old);
-	        
-            if ( fabs(d2C_new) < 1.0e-30 )
-                d2C_new = 1.0e-30;
-
-	        d2D_new = -D_new*D_new*(2.0*daj*dD_old+terms[2*i-1].evaluate(values)*d2D_old) + D_new*D_new*D_new*2.0*(dbj+daj*D_old+terms[2*i-1].evaluate(values)*dD_old)*(dbj+daj*D_old+terms[2*i-1].evaluate(values)*dD_old);
-	        
-            if ( fabs(d2D_new) < 1.0e-30 )
-    		    d2D_new = 1.0e-30;
-	    
-            d2f_new = d2f_old*D_new*C_new + 2.0*df_old*dD_new*C_new + 2.0*df_old*D_new*dC_new + f_old*d2D_new*C_new + f_old*D_new*d2C_new + 2.0*f_old*dD_new*dC_new;
-
-    	    D_old = D_new;
-    	    C_old = C_new;
-    	    f_old = f_new;
-    	    dD_old = dD_new;
-    	    dC_old = dC_new;
-    	    df_old = df_new;
-	        d2D_old = d2D_new;
-    	    d2C_old = d2C_new;
-    	    d2f_old = d2f_new;
-    	}
-    	ret[0] = f_new;
-    	ret[1] = df_new;
-	    ret[2] = d2f_new;
+    // Scratch space reused between samples
+    static thread_local vector<double> t;
+    static thread_local vector<double> tail;
+    static thread_local vector<double> adj;
+
+    size_t d = get_depth();
+    t.resize(get_frac_terms());
+    tail.resize(d+1);
+    adj.resize(get_frac_terms());
+
+    // Evaluate each term once
+    for(size_t k = 0; k < get_frac_terms(); k++)
+        t[k] = terms[k].evaluate(values);
+
+    // Tails T_d = g_d and T_i = g_i + h_i/T_i+1, with the same tiny value safeguard as Lentz
+    tail[d] = t[2*d];
+    if ( fabs(tail[d]) < 1.0e-30 )  tail[d] = 1.0e-30;
+    for(size_t i = d; i-- > 0; ) {
+        tail[i] = t[2*i] + t[2*i+1]/tail[i+1];
+        if ( i > 0 && fabs(tail[i]) < 1.0e-30 )  tail[i] = 1.0e-30;
     }
-    catch (exception& e) {
-    	// cout << "[cont_frac.tpp] numerical exception in evaluate_der2()" << endl;
-    	// print();
-    	ret[0] = numeric_limits<double>::max();
-    	ret[1] = numeric_limits<double>::max();
-	    ret[2] = numeric_limits<double>::max();
-    	return ret;
+
+    // Adjoints, df/dg_0 = 1, df/dh_i = dT_i/T_i+1 and dT_i+1 = -dT_i*h_i/T_i+1^2
+    double adj_tail = 1;
+    adj[0] = 1;
+    for(size_t i = 1; i <= d; i++) {
+        adj[2*i-1] = adj_tail/tail[i];
+        adj_tail = -adj_tail*t[2*i-1]/(tail[i]*tail[i]);
+        adj[2*i] = adj_tail;
     }
-    return ret;
 
+    // Chain rule through each term
+    grad.resize(positions.size());
+    for(size_t j = 0; j < positions.size(); j++) {
+        size_t term = term_from_pos(positions[j]);
+        grad[j] = adj[term]*terms[term].get_partial(values, param_from_pos(positions[j]));
+    }
+
+    if( !isfinite(tail[0]) )
+        throw invalid_argument("Non-finite fraction in evaluate_grad()");
+
+    return tail[0];
 }
 
 template <typename Traits>
-vector<double> ContinuedFraction<Traits>::evaluate_der3(vector<double>& values) {
+template <size_t N>
+Jet<N> ContinuedFraction<Traits>::evaluate_jet(vector<double>& values, size_t iv) {
 
-    // Returns CF evaluation, 1st derivative, 2nd derivative and 3rd derivative
-    // Assuming linear terms
+    // Initial guess is evaluation of the first term
+    Jet<N> f = terms[0].template evaluate_jet<N>(values, iv);
+    if ( fabs(f.value()) < 1.0e-30 ) f.set_value(1.0e-30);
 
-    sanitise();
-    vector<double> ret = {0.0, 0.0, 0.0, 0.0};
+    Jet<N> C = f;           // C_1 = f_1
+    Jet<N> D;               // D_1 = 0
+    Jet<N> a;
+    Jet<N> b;
 
-    //--------------- modified Lentz algorithm
-    try{
-    	double f_old = terms[0].evaluate(values);
-    	if ( fabs(f_old) < 1.0e-30 )
-    	    f_old = 1.0e-30;
-    	double C_old = f_old;
-    	double D_old = 0.0;
-    	double f_new = f_old;
-    	double C_new = C_old;
-    	double D_new = D_old;
-    	double Delta;
-	
-    	double df_old = 0;
-    	if(terms[0].get_active(0))
-    	    df_old = terms[0].get_value(0);
-    	double dC_old = df_old;
-    	double dD_old = 0;
-    	double df_new = df_old;
-    	double dC_new = dC_old;
-    	double dD_new = dD_old;
-    	double dbj;
-    	double daj;
-
-    	double d2f_old = 0;
-    	double d2C_old = d2f_old;
-    	double d2D_old = 0;
-    	double d2f_new = d2f_old;
-    	double d2C_new = d2C_old;
-    	double d2D_new = d2D_old;
-
-    	double d3f_old = 0;
-    	double d3C_old = d3f_old;
-    	double d3D_old = 0;
-    	double d3f_new = d3f_old;
-    	double d3C_new = d3C_old;
-    	double d3D_new = d3D_old;
-	
-    	for(int i=1; i<=get_depth(); i++) {
-	    
-    	    // function evaluation
-    	    D_new = terms[2*i].evaluate(values) + terms[2*i-1].evaluate(values)*D_old;
-    	    
-            if ( fabs(D_new) < 1.0e-30 )    
-                D_new = 1.0e-30;
-
-    	    D_new = 1.0/D_new;
-    	    C_new = terms[2*i].evaluate(values) + terms[2*i-1].evaluate(values)/C_old;
-    	    
-            if ( fabs(C_new) < 1.0e-30 )
-    		    C_new = 1.0e-30;
-
-    	    Delta = D_new*C_new;
-    	    f_new = f_old*Delta;
-
-    	    // 1st derivative evaluation
-    	    if ( terms[2*i].get_active(0) )
-    		    dbj = terms[2*i].get_value(0);
-    	    else
-    		    dbj = 0;
-
-    	    if ( terms[2*i-1].get_active(0) )
-    		    daj = terms[2*i-1].get_value(0);
-    	    else
-    		    daj = 0;
-
-    	    dC_new = dbj + (daj*C_old - terms[2*i-1].evaluate(values)*dC_old)/(C_old*C_old);
-
-	        if ( fabs(dC_new) < 1.0e-30 )
-    		    dC_new = 1.0e-30;
-    	    
-            dD_new = -D_new*D_new*(dbj + daj*D_old + terms[2*i-1].evaluate(values)*dD_old);
-
-	        if ( fabs(dD_new) < 1.0e-30 )
-    		    dD_new = 1.0e-30;
-
-    	    df_new = df_old*Delta + f_old*dC_new*D_new + f_old*C_new*dD_new;
-
-    	    // 2nd derivative evaluation
-    	    d2C_new = (-terms[2*i-1].evaluate(values)*d2C_old)/(C_old*C_old) - (2*daj*dC_old)/(C_old*C_old) + (2*terms[2*i-1].evaluate(values)*dC_old*dC_old)/(C_old*C_old*C_old);
-
-	        if ( fabs(d2C_new) < 1.0e-30 )
-    		    d2C_new = 1.0e-30;
-
-	        d2D_new = -D_new*D_new*(2.0*daj*dD_old+terms[2*i-1].evaluate(values)*d2D_old) + D_new*D_new*D_new*2.0*(dbj+daj*D_old+terms[2*i-1].evaluate(values)*dD_old)*(dbj+daj*D_old+terms[2*i-1].evaluate(values)*dD_old);
-	        
-            if ( fabs(d2D_new) < 1.0e-30 )
-    		    d2D_new = 1.0e-30;
-
-	        d2f_new = d2f_old*D_new*C_new + 2.0*df_old*dD_new*C_new + 2.0*df_old*D_new*dC_new + f_old*d2D_new*C_new + f_old*D_new*d2C_new + 2.0*f_old*dD_new*dC_new;
-
-	        // 3rd derivative evaluation
-	        d3C_new = (-3*daj*d2C_old-terms[2*i-1].evaluate(values)*d3C_old)/(C_old*C_old) + (6*terms[2*i-1].evaluate(values)*dC_old*d2C_old+6*daj*dC_old*dC_old)/(C_old*C_old*C_old) + (-6*terms[2*i-1].evaluate(values)*dC_old*dC_old*dC_old)/(C_old*C_old*C_old*C_old);
-
-	        if ( fabs(d3C_new) < 1.0e-30 )
-    		    d3C_new = 1.0e-30;
-
-	        d3D_new = pow(D_new,2)*(-3*daj*d2D_old-terms[2*i-1].evaluate(values)*d3D_old) - 6*pow(D_new,4)*pow(dbj+daj*D_old+terms[2*i-1].evaluate(values)*dD_old,3) + pow(D_new,3)*(6*dbj*terms[2*i-1].evaluate(values)*d2D_old+12*dbj*daj*dD_old+12*pow(daj,2)*D_old*dD_old+12*terms[2*i-1].evaluate(values)*daj*pow(dD_old,2)+6*terms[2*i-1].evaluate(values)*daj*D_old*d2D_old+6*pow(terms[2*i-1].evaluate(values),2)*dD_old*d2D_old);
-	        
-            if ( fabs(d3D_new) < 1.0e-30 )
-    		    d3D_new = 1.0e-30;
-	            
-            d3f_new = d3f_old*D_new*C_new + d2f_old*(3*dD_new*C_new+3*D_new*dC_new) + df_old*(3*d2D_new*C_new+6*dD_new*dC_new+3*D_new*d2C_new) + f_old*(d3D_new*C_new+D_new*d3C_new+3*d2D_new*dC_new+3*dD_new*d2C_new);
-	    
-    	    D_old = D_new;
-    	    C_old = C_new;
-    	    f_old = f_new;
-    	    dD_old = dD_new;
-    	    dC_old = dC_new;
-    	    df_old = df_new;
-	        d2D_old = d2D_new;
-    	    d2C_old = d2C_new;
-    	    d2f_old = d2f_new;
-	        d3D_old = d3D_new;
-    	    d3C_old = d3C_new;
-    	    d3f_old = d3f_new;
-    	}
-    	ret[0] = f_new;
-    	ret[1] = df_new;
-        ret[2] = d2f_new;
-        ret[3] = d3f_new;
+    for(size_t i = 1; i <= get_depth(); i++) {
+
+        // Each term is evaluated once and reused for C_j and D_j
+        b = terms[2*i].template evaluate_jet<N>(values, iv);
+        a = terms[2*i-1].template evaluate_jet<N>(values, iv);
+
+        // D_j = b_j + a_j * d_j-1, Dj = near zero if ~0
+        D = b + a*D;
+        if ( fabs(D.value()) < 1.0e-30 )    D.set_value(1.0e-30);
+
+        // C_j = b_i + a_i/(c_j-1), Cj = near zero if ~0
+        C = b + a/C;
+        if ( fabs(C.value()) < 1.0e-30 )    C.set_value(1.0e-30);
+
+        // f_j = f_j-1 * C_j / D_j
+        D = Jet<N>(1.0)/D;
+        f = f*(C*D);
     }
-    catch (exception& e) {
-    	// cout << "[cont_frac.tpp] numerical exception in evaluate_der2()" << endl;
-    	// print();
-    	ret[0] = numeric_limits<double>::max();
-    	ret[1] = numeric_limits<double>::max();
-	    ret[2] = numeric_limits<double>::max();
-	    ret[3] = numeric_limits<double>::max();
-    	return ret;
+
+    return f;
+}
+
+template <typename Traits>
+vector<double> ContinuedFraction<Traits>::evaluate_ders(vector<double>& values, size_t order, size_t iv) {
+
+    if( order > JET_MAX_ORDER )
+        throw invalid_argument("Derivative order "+to_string(order)+" exceeds JET_MAX_ORDER");
+
+    sanitise();
+    vector<double> ret;
+
+    try {
+
+        jet_dispatch(order, [&](auto n) {
+            evaluate_jet<decltype(n)::value>(values, iv).derivatives(ret);
+        });
+
+    } catch (exception& e) {
+        return vector<double>(order+1, numeric_limits<double>::max());
     }
+
     return ret;
+}
+
+template <typename Traits>
+void ContinuedFraction<Traits>::get_prefix(prefix_t& prefix) {
+
+    Node add, div;
+    add.node_type = NodeType::BFUNC;
+    add.function = Function::ADD;
+    div.node_type = NodeType::BFUNC;
+    div.function = Function::DIV;
+
+    for(size_t i = 0; i < depth; i++) {
+        prefix.push_back(add);
+        terms[2*i].get_prefix(prefix);
+        prefix.push_back(div);
+        terms[2*i+1].get_prefix(prefix);
+    }
+    terms[2*depth].get_prefix(prefix);
+
+}
+
+template <typename Traits>
+void ContinuedFraction<Traits>::get_fused_prefix(prefix_t& prefix) {
+
+    sanitise();
+
+    Node step;
+    step.node_type = NodeType::NFUNC;
+    step.function = Function::CFSTEP;
+    step.constant = 0;
+
+    // Outermost step first, its operands h_{j-1} and g_j followed by the remaining steps
+    for(size_t j = depth; j > 0; j--) {
+        step.variable = j;
+        prefix.push_back(step);
+        terms[2*j-1].get_fused_prefix(prefix);
+        terms[2*j].get_fused_prefix(prefix);
+    }
+    step.variable = 0;
+    prefix.push_back(step);
+    terms[0].get_fused_prefix(prefix);
 
 }
 
@@ -585,6 +531,8 @@ void ContinuedFraction<Traits>::get_node(TreeNode * parent) {
 template <typename Traits>
 void ContinuedFraction<Traits>::recombine(MemeticModel<typename Traits::UType>* model1, MemeticModel<typename Traits::UType>* model2, int method_override) {
 
+    PROFILE_SCOPE("recombine");
+
     int method = RandInt::RANDINT->rand(0,2);
 
     ContinuedFraction<Traits>* m1 = static_cast<ContinuedFraction<Traits>*>(model1);
@@ -611,22 +559,13 @@ template <typename Traits>
 vector<size_t>  ContinuedFraction<Traits>::get_active_positions() {
 
     vector<size_t> ret;
+    ret.reserve(get_count_active());
     
-    for( size_t i = 0; i < get_frac_terms(); i++ ) {
-
-        // Get positions relative to the term
-        vector<size_t> term_poss = terms[i].get_active_positions();
-
-        // Offset to the point in the fraction, 
-        // for term 0 = Offset 0, for term 1 = Offset params_per_term
-        // for term 2 = Offtset 2*params_per_term, etc.
-        transform(term_poss.begin(), term_poss.end(), term_poss.begin(), 
-                    [&](auto& value){ return value+params_per_term*i; });
-
-        // Append term positions to return vector
-        ret.insert( ret.end(), term_poss.begin(), term_poss.end());
-
-    }
+    // Positions relative to the term are offset to the point in the fraction, 
+    // for term 0 = Offset 0, for term 1 = Offset params_per_term
+    // for term 2 = Offtset 2*params_per_term, etc.
+    for( size_t i = 0; i < get_frac_terms(); i++ )
+        for_active(i, [&](size_t j) { ret.push_back(j+params_per_term*i); });
 
     return ret;
 }
@@ -667,29 +606,80 @@ void ContinuedFraction<Traits>::set_depth(size_t new_depth) {
 
     size_t  new_frac_terms = 2*new_depth+1;
 
-    // If we are reducing terms, simply remove the number of terms from the vector
+    // Work from the terms as evaluate() sees them
+    if( new_frac_terms != get_frac_terms() )
+        sanitise();
+
+    // If we are reducing terms, fold the tail into the new last term before removing it
     if( new_frac_terms < get_frac_terms()) {
 
-        size_t excess_terms = get_frac_terms()-new_frac_terms;
-        for(size_t i = 0; i < excess_terms; i++)
+        size_t last = new_frac_terms-1;
+        size_t ivs = MemeticModel<typename Traits::UType>::IVS.size();
+        vector<double> x(ivs, 0);
+        vector<typename Traits::UType> coeffs(ivs+1, 0);
+
+        // Linear approximation of the tail about the origin by central differences, the origin being the only
+        // point known without data. A tail that is not finite there, such as a pole, is truncated instead
+        double h = 1e-4;
+        bool fold = true;
+        try {
+            coeffs[ivs] = tail(x, last);
+            for(size_t j = 0; j < ivs; j++) {
+                x[j] = h;
+                double up = tail(x, last);
+                x[j] = -h;
+                double down = tail(x, last);
+                x[j] = 0;
+                coeffs[j] = (up-down)/(2*h);
+            }
+        } catch(exception& e) {
+            fold = false;
+        }
+        for(size_t j = 0; j <= ivs; j++)
+            if( !isfinite(coeffs[j]) || fabs(coeffs[j]) > 1e8 )
+                fold = false;
+
+        while( terms.size() > new_frac_terms )
             terms.pop_back();
 
-    // If we are adding terms, we need to increase terms
+        if( fold )
+            terms[last].add_linear(coeffs);
+
+    // If we are adding terms, each level is a zero numerator over a denominator of 1, so the value is unchanged
     } else {
 
-        size_t new_terms = new_frac_terms-get_frac_terms();
-        for(size_t i = 0; i < new_terms; i++) {
-            typename Traits::TType new_term  = typename Traits::TType(params_per_term);
-            new_term.randomise();
+        while( terms.size() < new_frac_terms ) {
+            typename Traits::TType new_term = terms.back();
+            new_term.set_constant( terms.size()%2 == 1 ? 0 : 1 );
             terms.push_back(new_term);
         }
 
     }
 
     depth = new_depth;
+    select_evaluator();
+
+}
+
+template <typename Traits>
+void ContinuedFraction<Traits>::set_constant(typename Traits::UType c) {
+
+    // c+0/(1+0/(1+...)), every denominator is non-zero so sanitise() leaves it unchanged
+    for(size_t i = 0; i < get_frac_terms(); i++)
+        terms[i].set_constant( i == 0 ? c : (i%2 == 0 ? 1 : 0) );
 
 }
 
+template <typename Traits>
+double ContinuedFraction<Traits>::tail(vector<double>& values, size_t last) {
+
+    double ret = 0;
+    for(size_t term = terms.size()-1; term > last; term -= 2)
+        ret = terms[term-1].evaluate(values) / (terms[term].evaluate(values) + ret);
+
+    return ret;
+}
+
 template <typename Traits2>
 ostream& operator<<(std::ostream& os, ContinuedFraction<Traits2>& c) {
 
@@ -68,6 +68,10 @@ class ContinuedFractionDynamicDepth :  public ContinuedFraction<Traits> {
             // If random depth
             } else if (meme::DYNAMIC_DEPTH_TYPE == meme::DynamicRandom)
                 rand = meme::RANDINT(0, meme::DEPTH);
+
+            // Depth stratified populations only construct models within their stratum
+            if( size_t(rand) < meme::DEPTH_LOW || size_t(rand) > meme::DEPTH_HIGH )
+                rand = meme::RANDINT(meme::DEPTH_LOW, meme::DEPTH_HIGH);
             
             //cout << "New fraction of depth: " << rand << endl;
 
@@ -0,0 +1,289 @@
+
+/** @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Fixed depth and variable count evaluators of a continued fraction with linear terms
+ */
+
+#ifndef MEMETICO_MODELS_CONT_FRAC_EVAL_H_
+#define MEMETICO_MODELS_CONT_FRAC_EVAL_H_
+
+// Std
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+/** @brief Largest fraction depth with a compile time CFEval, deeper fractions use cf_eval_sparse() */
+#define CF_EVAL_MAX_DEPTH 6
+
+/** @brief Largest number of independent variables with a compile time evaluator */
+#define CF_EVAL_MAX_IVS 8
+
+/**
+ * @brief Batch evaluator of a fraction given its flattened coefficients
+ * @param c coefficients, term t at c[t*(NIV+1)], variable coefficients then the constant, zero when inactive
+ * @param samples sample values
+ * @param selected indices of samples to evaluate, all samples when empty
+ * @param out values in the order of selected
+ */
+typedef void (*cf_eval_fn)(const double* c, vector<vector<double>>& samples, vector<size_t>& selected, double* out);
+
+/**
+ * @brief Single precision batch evaluator of a fraction over column-major samples
+ * @param c coefficients as per cf_eval_fn
+ * @param columns columns[j][i] is variable j of sample i
+ * @param count number of samples, used when selected is empty
+ * @param selected indices of samples to evaluate, all samples when empty
+ * @param out values in the order of selected
+ */
+typedef void (*cf_eval_float_fn)(const float* c, vector<vector<float>>& columns, size_t count, vector<size_t>& selected, float* out);
+
+/**
+ * @brief Evaluate the linear term \f$\sum c_j x_j + c_0\f$ in the same order as Regression::evaluate()
+ * @param x accessor returning the value of variable j
+ */
+template <size_t NIV, typename T, typename X>
+inline T cf_term(const T* c, X&& x) {
+    T ret = 0;
+    for(size_t j = 0; j < NIV; j++)
+        ret += c[j]*x(j);
+    return ret + c[NIV];
+}
+
+/** @brief One modified Lentz step with the tiny value safeguards of ContinuedFraction::evaluate() */
+template <typename T>
+inline void cf_lentz(T a, T b, T& f, T& C, T& D) {
+
+    D = b + a*D;
+    D = fabs(D) < (T) 1.0e-30 ? (T) 1.0e-30 : D;
+
+    C = b + a/C;
+    C = fabs(C) < (T) 1.0e-30 ? (T) 1.0e-30 : C;
+
+    D = 1/D;
+    f = f*(D*C);
+}
+
+/**
+ * @brief Evaluate a fraction by the modified Lentz algorithm for a compile time depth and variable count
+ * - The recurrence and dot products fully unroll so values stay in registers
+ * - Batches are evaluated row-wise in double, or column-wise in float where the sample loop vectorises
+ */
+template <size_t Depth, size_t NIV>
+struct CFEval {
+
+    /** @brief Evaluate at one sample given the variable accessor x */
+    template <typename T, typename X>
+    static inline T at(const T* c, X&& x) {
+
+        constexpr size_t W = NIV+1;
+
+        T f = cf_term<NIV>(c, x);
+        f = fabs(f) < (T) 1.0e-30 ? (T) 1.0e-30 : f;
+        T C = f;
+        T D = 0;
+
+        for(size_t i = 1; i <= Depth; i++)
+            cf_lentz(cf_term<NIV>(c+(2*i-1)*W, x), cf_term<NIV>(c+2*i*W, x), f, C, D);
+
+        return f;
+    }
+
+    /** @brief Row-wise double precision batch, see cf_eval_fn */
+    static void batch(const double* c, vector<vector<double>>& samples, vector<size_t>& selected, double* out) {
+
+        size_t n = selected.empty() ? samples.size() : selected.size();
+        for(size_t i = 0; i < n; i++) {
+            const double* x = samples[selected.empty() ? i : selected[i]].data();
+            out[i] = at(c, [x](size_t j) { return x[j]; });
+        }
+    }
+
+    /** @brief Samples per block of batch_float(), sized so a block of every variable stays in L1 */
+    static constexpr size_t BLOCK = 64;
+
+    /** @brief Write the linear term at \a t for the \a n samples of block \a x, in the order of cf_term() */
+    static inline void term_block(const float* t, float (&x)[NIV+1][BLOCK], size_t n, float* out) {
+        for(size_t k = 0; k < n; k++)
+            out[k] = 0;
+        for(size_t j = 0; j < NIV; j++)
+            #pragma omp simd
+            for(size_t k = 0; k < n; k++)
+                out[k] += t[j]*x[j][k];
+        #pragma omp simd
+        for(size_t k = 0; k < n; k++)
+            out[k] += t[NIV];
+    }
+
+    /**
+     * @brief Column-wise single precision batch, see cf_eval_float_fn
+     * - Samples are gathered into blocks and each Lentz step runs across the block, so every inner loop vectorises
+     * - The Lentz loop only vectorises with -fno-trapping-math, as the tiny guards otherwise become branches
+     */
+    static void batch_float(const float* c, vector<vector<float>>& columns, size_t count, vector<size_t>& selected, float* out) {
+
+        constexpr size_t W = NIV+1;
+        float x[NIV+1][BLOCK];
+        float C[BLOCK], D[BLOCK], a[BLOCK], b[BLOCK];
+
+        size_t n = selected.empty() ? count : selected.size();
+        for(size_t s = 0; s < n; s += BLOCK) {
+
+            size_t m = n - s < BLOCK ? n - s : BLOCK;
+            for(size_t j = 0; j < NIV; j++) {
+                const float* col = columns[j].data();
+                if( selected.empty() )
+                    for(size_t k = 0; k < m; k++)   x[j][k] = col[s+k];
+                else
+                    for(size_t k = 0; k < m; k++)   x[j][k] = col[selected[s+k]];
+            }
+
+            float* f = out+s;
+            term_block(c, x, m, f);
+            #pragma omp simd
+            for(size_t k = 0; k < m; k++) {
+                f[k] = fabs(f[k]) < 1.0e-30f ? 1.0e-30f : f[k];
+                C[k] = f[k];
+                D[k] = 0;
+            }
+
+            for(size_t i = 1; i <= Depth; i++) {
+                term_block(c+(2*i-1)*W, x, m, a);
+                term_block(c+2*i*W, x, m, b);
+                #pragma omp simd
+                for(size_t k = 0; k < m; k++)
+                    cf_lentz(a[k], b[k], f[k], C[k], D[k]);
+            }
+        }
+    }
+};
+
+/** @brief Evaluate the fraction for a runtime depth and variable count, numerically identical to CFEval::at() */
+template <typename T, typename X>
+inline T cf_eval_runtime(const T* c, X&& x, size_t depth, size_t niv) {
+
+    size_t w = niv+1;
+    auto term = [&](const T* t) {
+        T ret = 0;
+        for(size_t j = 0; j < niv; j++)
+            ret += t[j]*x(j);
+        return ret + t[niv];
+    };
+
+    T f = term(c);
+    f = fabs(f) < (T) 1.0e-30 ? (T) 1.0e-30 : f;
+    T C = f;
+    T D = 0;
+
+    for(size_t i = 1; i <= depth; i++)
+        cf_lentz(term(c+(2*i-1)*w), term(c+2*i*w), f, C, D);
+
+    return f;
+}
+
+/** @brief Samples evaluated together by cf_eval_sparse() */
+#define CF_EVAL_SPARSE_BLOCK 64
+
+/**
+ * @brief Active coefficients of a fraction in compressed form, built from the active lists of its terms
+ * - Term t has coefficients coef[k] of variables idx[k] for k in [start[t], start[t+1]) and the constant constant[t], zero when inactive
+ */
+template <typename T>
+struct CFSparse {
+    vector<size_t>  start;
+    vector<size_t>  idx;
+    vector<T>       coef;
+    vector<T>       constant;
+};
+
+/**
+ * @brief Evaluate the fraction over only the active variables of each term, identical to cf_eval_runtime() for finite samples
+ * - Terms are computed for a block of samples at a time, one active variable at a time so the sample loop vectorises,
+ *   gathering from rows or streaming from columns, and each sample adds its active variables in ascending order
+ * @param s active coefficients
+ * @param x accessor returning variable j of the i th sample as x(j, i)
+ * @param depth fraction depth
+ * @param n number of samples
+ * @param out n values
+ */
+template <typename T, typename X>
+inline void cf_eval_sparse(const CFSparse<T>& s, X&& x, size_t depth, size_t n, T* out) {
+
+    static thread_local vector<T> t;
+    size_t terms = 2*depth+1;
+    t.resize(terms*CF_EVAL_SPARSE_BLOCK);
+
+    for(size_t i0 = 0; i0 < n; i0 += CF_EVAL_SPARSE_BLOCK) {
+
+        size_t b = min((size_t) CF_EVAL_SPARSE_BLOCK, n-i0);
+        for(size_t k = 0; k < terms; k++) {
+
+            T* v = t.data()+k*CF_EVAL_SPARSE_BLOCK;
+            for(size_t i = 0; i < b; i++)
+                v[i] = 0;
+
+            for(size_t a = s.start[k]; a < s.start[k+1]; a++) {
+                T c = s.coef[a];
+                size_t j = s.idx[a];
+                for(size_t i = 0; i < b; i++)
+                    v[i] += c*x(j, i0+i);
+            }
+
+            T c0 = s.constant[k];
+            for(size_t i = 0; i < b; i++)
+                v[i] += c0;
+        }
+
+        for(size_t i = 0; i < b; i++) {
+
+            T f = t[i];
+            f = fabs(f) < (T) 1.0e-30 ? (T) 1.0e-30 : f;
+            T C = f;
+            T D = 0;
+
+            for(size_t k = 1; k <= depth; k++)
+                cf_lentz(t[(2*k-1)*CF_EVAL_SPARSE_BLOCK+i], t[2*k*CF_EVAL_SPARSE_BLOCK+i], f, C, D);
+
+            out[i0+i] = f;
+        }
+    }
+}
+
+/** @brief Compile time evaluators of one depth and variable count */
+struct CFEvalEntry {
+    cf_eval_fn          batch;
+    cf_eval_float_fn    batch_float;
+};
+
+/** @brief Row of evaluators for depth D indexed by variable count */
+template <size_t D, size_t... N>
+constexpr array<CFEvalEntry, sizeof...(N)> cf_eval_row(index_sequence<N...>) {
+    return {{ CFEvalEntry{ &CFEval<D, N>::batch, &CFEval<D, N>::batch_float }... }};
+}
+
+/** @brief Table of evaluators indexed by [depth][variable count] */
+template <size_t... D>
+constexpr array<array<CFEvalEntry, CF_EVAL_MAX_IVS+1>, sizeof...(D)> cf_eval_table(index_sequence<D...>) {
+    return {{ cf_eval_row<D>(make_index_sequence<CF_EVAL_MAX_IVS+1>())... }};
+}
+
+/**
+ * @brief Return the compile time evaluators for a fraction, or nullptr when depth or niv exceed the table
+ * @param depth fraction depth
+ * @param niv number of independent variables, i.e. parameters per term less the constant
+ */
+inline const CFEvalEntry* cf_eval_select(size_t depth, size_t niv) {
+
+    static constexpr auto table = cf_eval_table(make_index_sequence<CF_EVAL_MAX_DEPTH+1>());
+
+    if( depth > CF_EVAL_MAX_DEPTH || niv > CF_EVAL_MAX_IVS )
+        return nullptr;
+    return &table[depth][niv];
+}
+
+#endif
@@ -0,0 +1,99 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Serialised trained model, read by memetico-serve
+ *
+ * Layout, all values in the native byte order of the writer as written by binary::write()
+ * - uint64 MODEL_FILE_MAGIC, which doubles as the byte order marker, uint64 MODEL_FILE_VERSION
+ * - uint64 number of independent variables followed by each name
+ * - The model as written by its write()
+ *
+ */
+
+#ifndef MEMETICO_MODELS_MODEL_FILE_H_
+#define MEMETICO_MODELS_MODEL_FILE_H_
+
+// Local
+#include <memetico/helpers/binary.h>
+
+// Std
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+
+/** @brief Identifies a model file, "MEMOMODL" */
+#define MODEL_FILE_MAGIC 0x4C444F4D4F4D454DULL
+
+/** @brief MODEL_FILE_MAGIC as read from a file written on a machine of the other byte order */
+#define MODEL_FILE_MAGIC_SWAPPED 0x4D454D4F4D4F444CULL
+
+/** @brief Version of the model file layout */
+#define MODEL_FILE_VERSION 1
+
+namespace model_file {
+
+    /**
+     * @brief Write \a model and the names of its independent variables to \a filename
+     * - Written to a temporary file and renamed, so a reader never sees a partial model
+     * - Throws runtime_error when the file cannot be written
+     */
+    template <class U>
+    void save(string filename, U& model, const vector<string>& ivs) {
+
+        string tmp = filename+".tmp";
+        ofstream os(tmp, ios::binary | ios::trunc);
+        if( !os.is_open() )
+            throw runtime_error("Unable to open model file "+tmp);
+
+        binary::write(os, (uint64_t) MODEL_FILE_MAGIC);
+        binary::write(os, (uint64_t) MODEL_FILE_VERSION);
+        binary::write(os, (uint64_t) ivs.size());
+        for(const string& iv : ivs)
+            binary::write(os, iv);
+
+        model.write(os);
+
+        os.close();
+        if( !os || rename(tmp.c_str(), filename.c_str()) != 0 )
+            throw runtime_error("Unable to write model file "+filename);
+    }
+
+    /**
+     * @brief Read a model written by save() into \a model and the variable names into \a ivs
+     * - Throws runtime_error when the file is missing, of another format, of another byte order or truncated
+     */
+    template <class U>
+    void load(string filename, U& model, vector<string>& ivs) {
+
+        ifstream is(filename, ios::binary);
+        if( !is.is_open() )
+            throw runtime_error("Unable to open model file "+filename);
+
+        uint64_t magic, version, n;
+        binary::read(is, magic);
+        binary::read(is, version);
+        if( magic == MODEL_FILE_MAGIC_SWAPPED )
+            throw runtime_error(filename+" was written on a machine of the other byte order");
+        if( magic != MODEL_FILE_MAGIC )
+            throw runtime_error(filename+" is not a memetico model file");
+        if( version != MODEL_FILE_VERSION )
+            throw runtime_error(filename+" has model file version "+to_string(version)+", expected "+to_string(MODEL_FILE_VERSION));
+
+        binary::read(is, n);
+        binary::check_length(is, n, sizeof(uint64_t));
+        ivs.resize(n);
+        for(string& iv : ivs)
+            binary::read(is, iv);
+
+        model.read(is);
+    }
+
+}
+
+#endif
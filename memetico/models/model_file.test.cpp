@@ -0,0 +1,118 @@
+
+#include "doctest.h"
+#include <memetico/models/regression.h>
+#include <memetico/models/cont_frac.h>
+#include <memetico/models/mutation.h>
+#include <memetico/models/model_file.h>
+#include <memetico/models/model_server.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+
+    template<
+        typename T,
+        typename U,
+        template <typename, typename> class MutationPolicy>
+    struct FileTraits {
+        using TType = T;
+        using UType = U;
+        template <typename V, typename W>
+        using MPType = MutationPolicy<V, W>;
+    };
+
+    typedef ContinuedFraction<FileTraits<Regression<double>, double, mutation::MutateHardSoft>> FileModel;
+
+}
+
+TEST_CASE("ModelFile: save, load, serve") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    vector<string> ivs = {"x1", "x2", "x3"};
+    FileModel::IVS = ivs;
+
+    FileModel m(2);
+    string filename = "/tmp/memetico_model_file_test.bin";
+
+    // 1. Loaded model evaluates identically and keeps the variable names
+    model_file::save(filename, m, ivs);
+    FileModel loaded(0);
+    vector<string> names;
+    model_file::load(filename, loaded, names);
+    CHECK( names == ivs );
+    CHECK( loaded.get_depth() == 2 );
+
+    vector<vector<double>> samples;
+    for(size_t i = 0; i < 20; i++)
+        samples.push_back({rr.rand()*10-5, rr.rand()*10-5, rr.rand()*10-5});
+    for(vector<double>& s : samples)
+        CHECK( loaded.evaluate(s) == m.evaluate(s) );
+
+    // 2. Corrupt lengths, of the variable names and of the first name, are rejected before allocating
+    for(long offset : {16, 24}) {
+        model_file::save(filename, m, ivs);
+        FILE* f = fopen(filename.c_str(), "r+b");
+        uint64_t huge = (uint64_t) 1 << 60;
+        fseek(f, offset, SEEK_SET);
+        fwrite(&huge, sizeof(huge), 1, f);
+        fclose(f);
+        string msg = "binary::read() length "+to_string(huge)+" exceeds the stream";
+        CHECK_THROWS_WITH( model_file::load(filename, loaded, names), msg.c_str() );
+    }
+
+    // 3. Files of the other byte order and other files are rejected
+    FILE* f = fopen(filename.c_str(), "r+b");
+    uint64_t swapped = MODEL_FILE_MAGIC_SWAPPED;
+    fwrite(&swapped, sizeof(swapped), 1, f);
+    fclose(f);
+    string swapped_msg = filename+" was written on a machine of the other byte order";
+    CHECK_THROWS_WITH( model_file::load(filename, loaded, names), swapped_msg.c_str() );
+    f = fopen(filename.c_str(), "r+b");
+    fputc('X', f);
+    fclose(f);
+    CHECK_THROWS_AS( model_file::load(filename, loaded, names), runtime_error );
+    remove(filename.c_str());
+    CHECK_THROWS_AS( model_file::load(filename, loaded, names), runtime_error );
+
+    // 4. Server answers a batch, then reports a column mismatch without losing the stream
+    int req[2], resp[2];
+    REQUIRE( pipe(req) == 0 );
+    REQUIRE( pipe(resp) == 0 );
+
+    uint32_t header[3] = {0, (uint32_t) samples.size(), 3};
+    write(req[1], header, sizeof(header));
+    for(vector<double>& s : samples)
+        write(req[1], s.data(), 3*sizeof(double));
+    uint32_t bad[3] = {0, 1, 2};
+    double row[2] = {1, 2};
+    write(req[1], bad, sizeof(bad));
+    write(req[1], row, sizeof(row));
+    close(req[1]);
+
+    ModelServer<FileModel> server({m}, {3});
+    CHECK( server.serve(req[0], resp[1]) == 2 );
+    close(req[0]);
+    close(resp[1]);
+
+    uint32_t response[2];
+    REQUIRE( read(resp[0], response, sizeof(response)) == sizeof(response) );
+    CHECK( response[0] == ServeOk );
+    REQUIRE( response[1] == samples.size() );
+    vector<double> predictions(samples.size());
+    REQUIRE( read(resp[0], predictions.data(), predictions.size()*sizeof(double)) == (ssize_t) (predictions.size()*sizeof(double)) );
+    for(size_t i = 0; i < samples.size(); i++)
+        CHECK( predictions[i] == doctest::Approx(m.evaluate(samples[i])).epsilon(1e-12) );
+
+    REQUIRE( read(resp[0], response, sizeof(response)) == sizeof(response) );
+    CHECK( response[0] == ServeError );
+    string msg(response[1], ' ');
+    REQUIRE( read(resp[0], &msg[0], msg.size()) == (ssize_t) msg.size() );
+    CHECK( msg.find("expects 3 columns") != string::npos );
+    close(resp[0]);
+
+}
@@ -0,0 +1,309 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Bulk prediction of a trained model over a streamed CSV or binary dataset
+ *
+ * - Input is read in chunks of rows, each chunk is parsed, scored and formatted by all threads, then written in order
+ * - CSV input has a header, columns are matched to the model variables by name and other columns are ignored
+ * - Binary input is float64 rows of the model variables in order, without a header
+ * - CSV output is a yd column followed by yd_d1..yd_dK for derivatives of order 1..K with respect to the first variable
+ * - Binary output is float64 rows of the same values
+ * - CSV numbers are written as the shortest representation that reads back exactly
+ *
+ */
+
+#ifndef MEMETICO_MODELS_MODEL_PREDICT_H_
+#define MEMETICO_MODELS_MODEL_PREDICT_H_
+
+// Local
+#include <memetico/helpers/task_pool.h>
+
+// Std
+#include <charconv>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+
+/** @brief Rows read, scored and written together */
+#define PREDICT_CHUNK 65536
+
+namespace predict {
+
+    /** @brief Input and output file formats */
+    enum Format {
+        FormatCsv,
+        FormatBinary
+    };
+
+    /** @brief Return FormatBinary for a .bin file, FormatCsv otherwise */
+    inline Format format_of(const string& filename) {
+        return filename.size() >= 4 && filename.compare(filename.size()-4, 4, ".bin") == 0 ? FormatBinary : FormatCsv;
+    }
+
+    /** @brief Append the shortest representation of \a v that reads back exactly */
+    inline void append(string& s, double v) {
+        char buf[32];
+        to_chars_result r = to_chars(buf, buf+sizeof(buf), v);
+        s.append(buf, r.ptr);
+    }
+
+    /** @brief Parse a number from [first, last), throws runtime_error naming \a line when it is not one */
+    inline double parse(const char* first, const char* last, size_t line) {
+
+        while( first < last && *first == ' ' )
+            first++;
+        if( first < last && *first == '+' )
+            first++;
+
+        double v;
+        from_chars_result r = from_chars(first, last, v);
+        if( r.ec != errc() )
+            throw runtime_error("Unable to read \""+string(first, last)+"\" as a number on line "+to_string(line));
+        return v;
+    }
+
+    /**
+     * @brief Scores streamed data with copies of a model, one per thread
+     * - Models are copied as evaluation sanitises and caches into the model
+     * - Threads and the buffers of each slice are reused between chunks
+     */
+    template <class U>
+    class Predictor {
+
+        public:
+
+            /**
+             * @brief Construct a Predictor
+             * @param model trained model
+             * @param ivs names of the model independent variables, in model order
+             * @param ders highest derivative order to write, 0 for predictions only
+             * @param threads number of threads, 0 for all cores
+             * @param chunk rows read, scored and written together
+             */
+            Predictor(U& model, const vector<string>& ivs, size_t ders = 0, size_t threads = 0, size_t chunk = PREDICT_CHUNK) :
+                ivs(ivs), ders(ders), chunk(chunk) {
+
+                if( threads == 0 )
+                    threads = max(1u, thread::hardware_concurrency());
+                models.assign(threads, model);
+                slices.resize(threads);
+                pool = make_unique<tasks::Pool>(threads);
+            };
+
+            /**
+             * @brief Score every row of \a in and write the results to \a out
+             * @return number of rows scored
+             */
+            size_t run(istream& in, Format in_format, ostream& out, Format out_format) {
+
+                size_t cols = ivs.size();
+                vector<int> iv_of_col;
+
+                // Match CSV columns to model variables by name
+                if( in_format == FormatCsv ) {
+
+                    string header;
+                    getline(in, header);
+                    line = 1;
+                    vector<bool> found(cols, false);
+                    stringstream ss(header);
+                    string name;
+                    while( getline(ss, name, ',') ) {
+                        while( !name.empty() && (name.back() == '\r' || name.back() == ' ') )    name.pop_back();
+                        while( !name.empty() && name.front() == ' ' )                               name.erase(0, 1);
+                        int iv = -1;
+                        for(size_t j = 0; j < cols; j++)
+                            if( ivs[j] == name && !found[j] ) {
+                                iv = j;
+                                found[j] = true;
+                                break;
+                            }
+                        iv_of_col.push_back(iv);
+                    }
+                    for(size_t j = 0; j < cols; j++)
+                        if( !found[j] )
+                            throw runtime_error("Input has no column for model variable "+ivs[j]);
+                }
+
+                if( out_format == FormatCsv ) {
+                    string header = "yd";
+                    for(size_t k = 1; k <= ders; k++)
+                        header += ",yd_d"+to_string(k);
+                    out << header << "\n";
+                }
+
+                size_t total = 0;
+                while( true ) {
+
+                    // Read the chunk, leaving parsing to the threads
+                    size_t n = 0;
+                    if( in_format == FormatCsv ) {
+                        lines.resize(chunk);
+                        line_numbers.resize(chunk);
+                        while( n < chunk && getline(in, lines[n]) ) {
+                            line++;
+                            if( !lines[n].empty() && lines[n] != "\r" )
+                                line_numbers[n++] = line;
+                        }
+                    } else {
+                        raw.resize(chunk*cols);
+                        in.read(reinterpret_cast<char*>(raw.data()), raw.size()*sizeof(double));
+                        size_t bytes = in.gcount();
+                        if( bytes % (cols*sizeof(double)) != 0 )
+                            throw runtime_error("Binary input ends part way through a row");
+                        n = bytes/(cols*sizeof(double));
+                    }
+
+                    if( n == 0 )
+                        break;
+
+                    // Each task parses, scores and formats a contiguous slice
+                    size_t t_count = min(models.size(), n);
+                    tasks::Group group;
+                    for(size_t t = 0; t < t_count; t++) {
+                        size_t a = n*t/t_count, b = n*(t+1)/t_count;
+                        pool->submit(group, [this, t, a, b, in_format, out_format, &iv_of_col]() {
+                            work(t, a, b, in_format, out_format, iv_of_col);
+                        });
+                    }
+                    pool->wait(group);
+
+                    // Write in order, rethrowing the first failure
+                    for(size_t t = 0; t < t_count; t++)
+                        if( slices[t].error )
+                            rethrow_exception(slices[t].error);
+                    for(size_t t = 0; t < t_count; t++) {
+                        if( out_format == FormatCsv )
+                            out.write(slices[t].text.data(), slices[t].text.size());
+                        else
+                            out.write(reinterpret_cast<const char*>(slices[t].values.data()), slices[t].values.size()*sizeof(double));
+                    }
+                    if( !out )
+                        throw runtime_error("Unable to write predictions");
+
+                    total += n;
+                }
+
+                return total;
+            }
+
+        private:
+
+            /** @brief Work buffers of a thread */
+            struct Slice {
+                vector<vector<double>>  rows;
+                vector<double>          preds;
+                vector<double>          values;
+                string                  text;
+                exception_ptr           error;
+            };
+
+            vector<U>           models;
+            vector<Slice>       slices;
+
+            /** Threads scoring the slices, kept for every chunk */
+            unique_ptr<tasks::Pool> pool;
+
+            vector<string>      ivs;
+            size_t              ders;
+            size_t              chunk;
+
+            /** CSV lines of the current chunk */
+            vector<string>      lines;
+
+            /** Line in the file of each CSV line of the current chunk, counting the header and blank lines */
+            vector<size_t>      line_numbers;
+
+            /** Lines read from the CSV input so far */
+            size_t              line = 0;
+
+            /** Binary values of the current chunk */
+            vector<double>      raw;
+
+            /** Empty selection, evaluate every row */
+            vector<size_t>      all;
+
+            /** @brief Parse, score and format rows [a, b) of the chunk with thread \a t's model and buffers */
+            void work(size_t t, size_t a, size_t b, Format in_format, Format out_format, const vector<int>& iv_of_col) {
+
+                Slice& s = slices[t];
+                s.error = nullptr;
+
+                try {
+
+                    size_t cols = ivs.size();
+                    s.rows.resize(b-a);
+                    for(size_t i = a; i < b; i++) {
+
+                        vector<double>& row = s.rows[i-a];
+                        row.resize(cols);
+
+                        if( in_format == FormatBinary ) {
+                            copy(raw.begin()+i*cols, raw.begin()+(i+1)*cols, row.begin());
+                            continue;
+                        }
+
+                        // Walk the fields, keeping those that are model variables
+                        const char* p = lines[i].data();
+                        const char* end = p+lines[i].size();
+                        if( end > p && *(end-1) == '\r' )
+                            end--;
+                        size_t parsed = 0;
+                        for(size_t c = 0; c < iv_of_col.size() && p <= end; c++) {
+                            const char* comma = p;
+                            while( comma < end && *comma != ',' )
+                                comma++;
+                            if( iv_of_col[c] >= 0 ) {
+                                row[iv_of_col[c]] = parse(p, comma, line_numbers[i]);
+                                parsed++;
+                            }
+                            p = comma+1;
+                        }
+                        if( parsed != cols )
+                            throw runtime_error("Too few columns on line "+to_string(line_numbers[i]));
+                    }
+
+                    // Score, vectorised across the slice when no derivatives are requested
+                    size_t width = ders+1;
+                    s.values.resize((b-a)*width);
+                    if( ders == 0 ) {
+                        models[t].evaluate_batch(s.rows, all, s.preds);
+                        copy(s.preds.begin(), s.preds.end(), s.values.begin());
+                    } else {
+                        for(size_t i = 0; i < b-a; i++) {
+                            vector<double> d = models[t].evaluate_ders(s.rows[i], ders, 0);
+                            copy(d.begin(), d.begin()+width, s.values.begin()+i*width);
+                        }
+                    }
+
+                    if( out_format == FormatCsv ) {
+                        s.text.clear();
+                        for(size_t i = 0; i < b-a; i++) {
+                            for(size_t k = 0; k < width; k++) {
+                                if( k > 0 )
+                                    s.text += ',';
+                                append(s.text, s.values[i*width+k]);
+                            }
+                            s.text += '\n';
+                        }
+                    }
+
+                } catch(...) {
+                    s.error = current_exception();
+                }
+            }
+
+    };
+
+}
+
+#endif
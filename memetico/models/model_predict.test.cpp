@@ -0,0 +1,128 @@
+
+#include "doctest.h"
+#include <memetico/models/regression.h>
+#include <memetico/models/cont_frac.h>
+#include <memetico/models/mutation.h>
+#include <memetico/models/model_predict.h>
+#include <sstream>
+
+namespace {
+
+    template<
+        typename T,
+        typename U,
+        template <typename, typename> class MutationPolicy>
+    struct PredictTraits {
+        using TType = T;
+        using UType = U;
+        template <typename V, typename W>
+        using MPType = MutationPolicy<V, W>;
+    };
+
+    typedef ContinuedFraction<PredictTraits<Regression<double>, double, mutation::MutateHardSoft>> PredictModel;
+
+    vector<double> read_row(const string& line) {
+        vector<double> row;
+        stringstream ss(line);
+        string v;
+        while( getline(ss, v, ',') )
+            row.push_back(stod(v));
+        return row;
+    }
+
+}
+
+TEST_CASE("Predict: csv, binary, derivatives") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    vector<string> ivs = {"x1", "x2"};
+    PredictModel::IVS = ivs;
+    PredictModel m(2);
+
+    vector<vector<double>> samples;
+    for(size_t i = 0; i < 50; i++)
+        samples.push_back({rr.rand()*4-2, rr.rand()*4-2});
+
+    // Columns out of model order with an extra column
+    stringstream csv;
+    csv << "x2,y,x1\r\n";
+    for(vector<double>& s : samples) {
+        string line;
+        predict::append(line, s[1]);
+        line += ",7,";
+        predict::append(line, s[0]);
+        csv << line << "\n";
+    }
+
+    // 1. CSV over several chunks and threads matches evaluate() exactly
+    predict::Predictor<PredictModel> p(m, ivs, 0, 3, 7);
+    stringstream out;
+    CHECK( p.run(csv, predict::FormatCsv, out, predict::FormatCsv) == samples.size() );
+    string line;
+    getline(out, line);
+    CHECK( line == "yd" );
+    for(vector<double>& s : samples) {
+        REQUIRE( getline(out, line) );
+        CHECK( stod(line) == m.evaluate(s) );
+    }
+    CHECK( !getline(out, line) );
+
+    // 2. Binary input and output with derivatives
+    stringstream bin_in, bin_out;
+    for(vector<double>& s : samples)
+        bin_in.write(reinterpret_cast<const char*>(s.data()), 2*sizeof(double));
+    predict::Predictor<PredictModel> pd(m, ivs, 2, 2, 16);
+    CHECK( pd.run(bin_in, predict::FormatBinary, bin_out, predict::FormatBinary) == samples.size() );
+    for(vector<double>& s : samples) {
+        double v[3];
+        REQUIRE( bin_out.read(reinterpret_cast<char*>(v), sizeof(v)) );
+        vector<double> d = m.evaluate_ders(s, 2, 0);
+        CHECK( v[0] == d[0] );
+        CHECK( v[1] == d[1] );
+        CHECK( v[2] == d[2] );
+    }
+
+    // 3. CSV derivative header and values
+    stringstream small("x1,x2\n0.5,-1\n"), small_out;
+    predict::Predictor<PredictModel> pc(m, ivs, 1, 1);
+    pc.run(small, predict::FormatCsv, small_out, predict::FormatCsv);
+    getline(small_out, line);
+    CHECK( line == "yd,yd_d1" );
+    getline(small_out, line);
+    vector<double> x = {0.5, -1};
+    vector<double> d = m.evaluate_ders(x, 1, 0);
+    CHECK( read_row(line) == vector<double>{d[0], d[1]} );
+
+    // 4. Missing variables and bad numbers are reported
+    stringstream missing("x1,y\n1,2\n"), bad("x1,x2\n1,abc\n"), sink;
+    CHECK_THROWS_AS( p.run(missing, predict::FormatCsv, sink, predict::FormatCsv), runtime_error );
+    string msg;
+    try {
+        p.run(bad, predict::FormatCsv, sink, predict::FormatCsv);
+    } catch(runtime_error& e) {
+        msg = e.what();
+    }
+    CHECK( msg.find("line 2") != string::npos );
+
+    // 5. Errors name the line in the file, counting blank lines, across chunks of 7 rows
+    stringstream gaps;
+    gaps << "x1,x2\n\n";
+    for(size_t i = 0; i < 9; i++)
+        gaps << "1,2\n" << (i % 3 == 0 ? "\r\n" : "");
+    gaps << "1,abc\n";
+    msg = "";
+    try {
+        p.run(gaps, predict::FormatCsv, sink, predict::FormatCsv);
+    } catch(runtime_error& e) {
+        msg = e.what();
+    }
+    CHECK( msg == "Unable to read \"abc\" as a number on line 15" );
+
+    CHECK( predict::format_of("a.bin") == predict::FormatBinary );
+    CHECK( predict::format_of("a.csv") == predict::FormatCsv );
+
+}
@@ -0,0 +1,164 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Batched prediction over a framed binary protocol, used by memetico-serve
+ *
+ * Requests and responses are native endian and are read and written whole
+ * - Request: uint32 model, uint32 rows, uint32 cols, then rows*cols float64 samples in row major order
+ * - Response: uint32 status, uint32 count, then
+ *  - ServeOk: count float64 predictions, one per row
+ *  - ServeError: count bytes of error message
+ * - cols must equal the number of independent variables of the model
+ * - The connection closes after the response to a request that exceeds SERVE_MAX_VALUES
+ *
+ */
+
+#ifndef MEMETICO_MODELS_MODEL_SERVER_H_
+#define MEMETICO_MODELS_MODEL_SERVER_H_
+
+// Std
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/** @brief Largest number of sample values accepted in one request */
+#define SERVE_MAX_VALUES (1 << 26)
+
+/** @brief Response status */
+enum ServeStatus : uint32_t {
+    ServeOk = 0,
+    ServeError = 1
+};
+
+/**
+ * @brief Answers prediction requests for a set of models
+ * - Models are copied, evaluation sanitises and caches into the model so each connection needs its own server
+ * - Buffers are kept between requests so a steady request size does not allocate
+ */
+template <class U>
+class ModelServer {
+
+    public:
+
+        /**
+         * @brief Construct a server for \a models
+         * @param models models indexed by the request model field
+         * @param ivs number of independent variables of each model
+         */
+        ModelServer(const vector<U>& models, const vector<size_t>& ivs) : models(models), ivs(ivs) {};
+
+        /**
+         * @brief Answer requests read from \a in on \a out until the end of \a in
+         * @return number of requests answered
+         */
+        size_t serve(int in, int out) {
+
+            size_t served = 0;
+            uint32_t header[3];
+
+            while( read_full(in, header, sizeof(header)) ) {
+
+                uint32_t m = header[0], rows = header[1], cols = header[2];
+                size_t values = (size_t) rows*cols;
+
+                if( values > SERVE_MAX_VALUES ) {
+                    error(out, "Request of "+to_string(values)+" values exceeds the limit of "+to_string(SERVE_MAX_VALUES));
+                    break;
+                }
+
+                wire.resize(values);
+                if( !read_full(in, wire.data(), values*sizeof(double)) )
+                    break;
+
+                if( m >= models.size() ) {
+                    if( !error(out, "Unknown model "+to_string(m)) )
+                        break;
+                    served++;
+                    continue;
+                }
+
+                if( cols != ivs[m] ) {
+                    if( !error(out, "Model "+to_string(m)+" expects "+to_string(ivs[m])+" columns, received "+to_string(cols)) )
+                        break;
+                    served++;
+                    continue;
+                }
+
+                // Unpack rows, reusing their storage between requests
+                batch.resize(rows);
+                for(size_t i = 0; i < rows; i++)
+                    batch[i].assign(wire.begin()+i*cols, wire.begin()+(i+1)*cols);
+
+                models[m].evaluate_batch(batch, all, predictions);
+
+                uint32_t response[2] = {ServeOk, rows};
+                if( !write_full(out, response, sizeof(response)) || !write_full(out, predictions.data(), rows*sizeof(double)) )
+                    break;
+
+                served++;
+            }
+
+            return served;
+        }
+
+    private:
+
+        vector<U>               models;
+        vector<size_t>          ivs;
+
+        /** Request samples as received */
+        vector<double>          wire;
+
+        /** Rows of the current request */
+        vector<vector<double>>  batch;
+
+        vector<double>          predictions;
+
+        /** Empty selection, evaluate every row */
+        vector<size_t>          all;
+
+        /** @brief Write an error response, returning false when the output is closed */
+        bool error(int out, string msg) {
+            uint32_t response[2] = {ServeError, (uint32_t) msg.size()};
+            return write_full(out, response, sizeof(response)) && write_full(out, msg.data(), msg.size());
+        }
+
+        /** @brief Read exactly \a n bytes, returning false at the end of input */
+        static bool read_full(int fd, void* buf, size_t n) {
+            char* p = static_cast<char*>(buf);
+            while( n > 0 ) {
+                ssize_t r = ::read(fd, p, n);
+                if( r < 0 && errno == EINTR )
+                    continue;
+                if( r <= 0 )
+                    return false;
+                p += r;
+                n -= r;
+            }
+            return true;
+        }
+
+        /** @brief Write exactly \a n bytes, returning false when the output is closed */
+        static bool write_full(int fd, const void* buf, size_t n) {
+            const char* p = static_cast<const char*>(buf);
+            while( n > 0 ) {
+                ssize_t w = ::write(fd, p, n);
+                if( w < 0 && errno == EINTR )
+                    continue;
+                if( w <= 0 )
+                    return false;
+                p += w;
+                n -= w;
+            }
+            return true;
+        }
+
+};
+
+#endif
@@ -5,6 +5,9 @@
 #include <vector>
 #include <unordered_map>
 
+#include <memetico/helpers/mask.h>
+#include <memetico/helpers/binary.h>
+
 #include <memetico/models/cont_frac_dd.h>   
 #include <memetico/model_base/model_meme.h>  
 #include <memetico/models/regression.h> 
@@ -117,6 +120,24 @@ namespace mutation {
         /** @brief Return number of pararmters globally turned on */
         bool    get_global_active(size_t iv) const  { return global_active[iv]; };
 
+        /** @brief Write the per model policy state for a checkpoint */
+        void    write_policy(ostream& os) const     { binary::write(os, global_active); };
+
+        /** @brief Restore the per model policy state written by write_policy() */
+        void    read_policy(istream& is)            { binary::read(is, global_active); };
+
+        /** @brief No state is shared between models */
+        static void write_history(ostream&)         {};
+
+        /** @brief No state is shared between models */
+        static void read_history(istream&)          {};
+
+        /** @brief No state is shared between models */
+        struct History {};
+
+        /** @brief No state is shared between models */
+        static void swap_history(History&)          {};
+
         vector<bool>   global_active;
 
     };
@@ -125,8 +146,6 @@ namespace mutation {
     struct MutateUniqueMask {
 
         MutateUniqueMask (size_t frac_depth = 4)  {
-
-            hashes_by_size = unordered_map<size_t, unordered_set<size_t>>();        
             size = 0;    
         };
 
@@ -147,52 +166,70 @@ namespace mutation {
             // Re-determine size in case the fraction has been modified since initialise()
             size = model.get_params_per_term()*model.get_frac_terms();
 
-            vector<bool> set = unique_vector();
+            Mask set = unique_mask();
 
             for(size_t i = 0; i < set.size(); i++)
-                model.set_active(i, set[i]);
+                model.set_active(i, set.get(i));
             
             return;
         };
 
         /** @brief return an unseen set of masks or repeat a mask after going through all possible combinations */
-        vector<bool> unique_vector() {
-            
-            auto& model = static_cast<Derived&>(*this);
-            
-            // Determine the maximum number of combinations, and if we have seen them all, clear and re-process all possibilities again
-            size_t max = pow(2, size);
-            if (hashes_by_size[size].size() == max) {
-                cout << "All possible vectors of size " << size << " have been generated, resetting hashes" << endl;
-                hashes_by_size[size].clear();
-            }
+        Mask unique_mask() {
 
-            // Try 50 times to find a unique vector for the fractions depth
-            // We implicitly identify depth as the total number of parameters in the fraction
-            // i.e. size
-            vector<bool> set;
-            for(size_t j = 0; j < 50; j++) {
-                // Replace with your unique_bools function. Here's a placeholder.
-                set = RandInt::RANDINT->unique_bools(size);
-
-                if (hashes_by_size[size].find(hash_bools(set)) == hashes_by_size[size].end()) {
-                    hashes_by_size[size].insert(hash_bools(set));
-                    //cout << "Found on iteration: " << j << " hash: " << hash_bools(set) << " count:" << hashes_by_size[size].size() << endl;
-                    return set;
-                }
+            // We implicitly identify depth as the total number of parameters in the fraction i.e. size
+            auto it = history_by_size.find(size);
+            if( it == history_by_size.end() )
+                it = history_by_size.emplace(size, MaskHistory(size)).first;
+
+            return it->second.next(*RandInt::RANDINT);
+        };
+
+        /** @brief Write the per model policy state for a checkpoint */
+        void    write_policy(ostream& os) const     { binary::write(os, (uint64_t) size); };
+
+        /** @brief Restore the per model policy state written by write_policy() */
+        void    read_policy(istream& is) {
+            uint64_t s;
+            binary::read(is, s);
+            size = s;
+        };
+
+        /** @brief Write the mask history of every parameter count for a checkpoint */
+        static void write_history(ostream& os) {
+            binary::write(os, (uint64_t) history_by_size.size());
+            for(auto& h : history_by_size) {
+                binary::write(os, (uint64_t) h.first);
+                h.second.write(os);
             }
+        };
 
-            cout << "Failed to find unique vector of size " << size << endl;
-            return set;
+        /** @brief Replace the mask histories with those written by write_history() */
+        static void read_history(istream& is) {
+            uint64_t n;
+            binary::read(is, n);
+            history_by_size.clear();
+            for(size_t i = 0; i < n; i++) {
+                uint64_t size;
+                binary::read(is, size);
+                history_by_size[size].read(is);
+            }
         };
 
-        static unordered_map<size_t, unordered_set<size_t>> hashes_by_size;
+        /** @brief Mask histories by parameter count, as held by history_by_size */
+        typedef unordered_map<size_t, MaskHistory> History;
+
+        /** @brief Exchange the mask histories of this thread with \a h, e.g. to run a task with its own history */
+        static void swap_history(History& h)        { history_by_size.swap(h); };
+
+        /** History of masks shared by all models of the same parameter count, per run on this thread */
+        static thread_local History history_by_size;
         size_t size;
     
     };
 
     template <typename U, typename Derived>
-    unordered_map<size_t, unordered_set<size_t>> MutateUniqueMask<U,Derived>::hashes_by_size;
+    thread_local typename MutateUniqueMask<U,Derived>::History MutateUniqueMask<U,Derived>::history_by_size;
 
 };
 
@@ -15,12 +15,14 @@ using namespace std;
 #include <memetico/helpers/excel.h>
 #include <memetico/helpers/rng.h>
 #include <memetico/helpers/safe_ops.h>
+#include <memetico/helpers/jet.h>
 #include <memetico/model_base/element.h>
 #include <memetico/model_base/model_meme.h>
 
 // Std Lib
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <limits>
 #include <stdexcept>
 #include <iomanip>
@@ -53,6 +55,7 @@ class Regression : public MemeticModel<T> {
 
             for(size_t i = 0; i < actives.size(); i++)
                 elems.push_back( Element<T>(actives[i], vals[i]) );
+            index_active();
         };
 
         /** @brief Construct Regression with a Term of param_count size */
@@ -61,11 +64,19 @@ class Regression : public MemeticModel<T> {
             // Copy element between Additive Terms
             for(size_t i = 0; i < o.elems.size(); i++)
                 elems.push_back( o.elems[i] );
+            active = o.active;
 
         };        
 
-        /** @brief Set the active flag for the \a pos th element of the regression term to \a val */
-        void    set_active(size_t pos, bool val)    {  elems[pos].set_active(val); };
+        /** @brief Set the active flag for the \a pos th element of the regression term to \a val, keeping the active list sorted */
+        void    set_active(size_t pos, bool val) {
+            if( elems[pos].get_active() != val ) {
+                auto it = lower_bound(active.begin(), active.end(), pos);
+                if( val )   active.insert(it, pos);
+                else        active.erase(it);
+            }
+            elems[pos].set_active(val);
+        };
         
         /** @brief Set value for the \a pos th element with value \a val */
         void    set_value(size_t pos, T val)        {  
@@ -84,22 +95,37 @@ class Regression : public MemeticModel<T> {
         /** @brief Return count of elements */
         size_t  get_count()                         { return elems.size(); };
         
+        /** @brief get the positions of the active parameters */
+        vector<size_t> get_active_positions()       { return active; };
+
+        /** @brief Return the ascending positions of the active parameters without copying, valid until the next set_active() */
+        const vector<size_t>& get_active_list() const { return active; };
+
         /** @brief get the number of active parameters */
-        vector<size_t> get_active_positions() { 
-            vector<size_t> ret;
-            for(size_t i = 0; i < get_count(); i++) {
-                if( elems[i].get_active() ) {
-                    ret.push_back(i);
-                }
-            }
-            return ret;
+        size_t  get_count_active()                  { return active.size(); };
+
+        /** @brief Set every value to 0 keeping the active flags, then the constant active with value \a c, so the term is \a c everywhere */
+        void    set_constant(T c) {
+            for(size_t i = 0; i < get_count(); i++)
+                set_value(i, 0);
+            set_active(get_count()-1, true);
+            set_value(get_count()-1, c);
         };
 
-        /** @brief get the number of active parameters */
-        size_t  get_count_active()                  { return get_active_positions().size(); };
+        /**
+         * @brief Add the linear function \a coeffs to the term, one coefficient per variable followed by the constant
+         * - Variables with a coefficient of magnitude 1e-8 or more are turned on, as set_value() zeroes smaller values
+         */
+        void    add_linear(vector<T>& coeffs);
 
         /** @brief Return TreeNode for GPU processing */
         virtual void get_node(TreeNode * n);
+
+        /** @brief Append prefix encoding, identical to flattening get_node() without building the tree */
+        void    get_prefix(prefix_t& prefix) override;
+
+        /** @brief Append a single LINTERM with a COEF per active coefficient, matching evaluate() */
+        void    get_fused_prefix(prefix_t& prefix) override;
         
         /** @brief Comparison operator for Regression<T> */
         bool operator== (Regression<T>& o) {
@@ -165,6 +191,30 @@ class Regression : public MemeticModel<T> {
          * @return result of the Regressors evaluation at \a values
          */
         double  evaluate(vector<double> & values);  
+
+        /** @brief Partial derivative of the Regressor with respect to the parameter at \a pos, i.e. its variable or 1 for the constant */
+        double  get_partial(vector<double> & values, size_t pos) { return pos == get_count()-1 ? 1 : values[pos]; };
+
+        /** @brief Evaluate the Regressor and its exact gradient with respect to the parameters at \a positions */
+        double  evaluate_grad(vector<double>& values, vector<size_t>& positions, vector<double>& grad) override {
+            grad.resize(positions.size());
+            for(size_t j = 0; j < positions.size(); j++)
+                grad[j] = get_partial(values, positions[j]);
+            return evaluate(values);
+        };
+
+        /** 
+         * @brief Evaluate a Regressor and its derivatives with respect to independent variable \a iv given sample \a values
+         * - The value is that of evaluate(), the 1st derivative is the coefficient of \a iv and higher orders are zero
+         *
+         * @param values an array of sample values that are \f$N\f$ in length
+         * @param iv index of the independent variable to differentiate against
+         * @return Jet of the Regressor at \a values
+         */
+        template <size_t N>
+        Jet<N>  evaluate_jet(vector<double> & values, size_t iv) {
+            return Jet<N>(evaluate(values), get_active(iv) ? double(get_value(iv)) : 0);
+        };
         
         /** 
          * @brief Randomise all parameter values between +[min, max] or -[max, min] or a specific parameter when \a pos is positive
@@ -177,6 +227,32 @@ class Regression : public MemeticModel<T> {
          */
         void    randomise(int min = 1, int max = 30, int pos = -1);
 
+        /** @brief Write the fitness and elements for a checkpoint */
+        void    write(ostream& os) override {
+            Model::write(os);
+            binary::write(os, (uint64_t) elems.size());
+            for(Element<T>& e : elems) {
+                binary::write(os, e.get_active());
+                binary::write(os, e.get_value());
+            }
+        };
+
+        /** @brief Restore the fitness and elements written by write() */
+        void    read(istream& is) override {
+            Model::read(is);
+            uint64_t n;
+            binary::read(is, n);
+            elems.resize(n);
+            for(Element<T>& e : elems) {
+                bool on;
+                T value;
+                binary::read(is, on);
+                binary::read(is, value);
+                e = Element<T>(on, value);
+            }
+            index_active();
+        };
+
         /** @brief Print the solution to stdout */
         void print() override { 
             cout << *this << endl; 
@@ -197,6 +273,17 @@ class Regression : public MemeticModel<T> {
     
         /** @brief the Regression term */
         vector<Element<T>> elems;
+
+        /** @brief Ascending positions of the active elements, maintained by set_active() */
+        vector<size_t>     active;
+
+        /** @brief Rebuild the active positions after the elements are replaced */
+        void    index_active() {
+            active.clear();
+            for(size_t i = 0; i < elems.size(); i++)
+                if( elems[i].get_active() )
+                    active.push_back(i);
+        };
         
 };
 
@@ -20,6 +20,77 @@ void Regression<T>::coeff_node(TreeNode * tree_node, float constant, int var_num
 
 }
 
+template <class T>
+void Regression<T>::get_fused_prefix(prefix_t& prefix) {
+
+    Node lin, coef;
+    lin.node_type = NodeType::NFUNC;
+    lin.function = Function::LINTERM;
+    lin.variable = 0;
+    coef.node_type = NodeType::COEF;
+
+    // Constant is the LINTERM intercept, zero when inactive as in evaluate()
+    size_t constant = get_count()-1;
+    lin.constant = get_active(constant) ? get_value(constant) : 0;
+    prefix.push_back(lin);
+
+    for(size_t j = 0; j < constant; j++) {
+        if( !get_active(j) )
+            continue;
+        coef.constant = get_value(j);
+        coef.variable = j;
+        prefix.push_back(coef);
+    }
+
+}
+
+template <class T>
+void Regression<T>::get_prefix(prefix_t& prefix) {
+
+    Node add, mul, var, con;
+    add.node_type = NodeType::BFUNC;
+    add.function = Function::ADD;
+    mul.node_type = NodeType::BFUNC;
+    mul.function = Function::MUL;
+    var.node_type = NodeType::VAR;
+    con.node_type = NodeType::CONST;
+
+    // Each active coefficient but the last is ADD(MUL(c, x), rest)
+    size_t constant = get_count()-1;
+    int last = -1;
+    for(size_t j = 0; j < get_count(); j++) {
+
+        if( !get_active(j) )
+            continue;
+
+        if( last > -1 ) {
+            prefix.push_back(add);
+            prefix.push_back(mul);
+            con.constant = get_value(last);
+            prefix.push_back(con);
+            var.variable = last;
+            prefix.push_back(var);
+        }
+        last = j;
+    }
+
+    // Last active parameter, or the constant 1 when there are none
+    if( last == -1 ) {
+        con.constant = 1;
+        prefix.push_back(con);
+    } else if( (size_t) last == constant ) {
+        con.constant = get_value(last);
+        prefix.push_back(con);
+    } else {
+        prefix.push_back(mul);
+        con.constant = get_value(last);
+        prefix.push_back(con);
+        var.variable = last;
+        prefix.push_back(var);
+    }
+
+}
+
 template <class T>
 void Regression<T>::get_node(TreeNode * n) {
     
@@ -134,6 +205,21 @@ void Regression<T>::recombine(MemeticModel<T> * m1, MemeticModel<T> * m2, int me
     }   
 }
 
+template <class T>
+void Regression<T>::add_linear(vector<T>& coeffs) {
+
+    for(size_t i = 0; i < get_count() && i < coeffs.size(); i++) {
+
+        if( abs(coeffs[i]) < 1e-8 )
+            continue;
+
+        // Inactive values do not contribute, so they are replaced rather than added to
+        T base = get_active(i) ? get_value(i) : 0;
+        set_active(i, true);
+        set_value(i, base+coeffs[i]);
+    }
+}
+
 template <class T>
 void Regression<T>::randomise(int min, int max, int pos) {
 
@@ -169,16 +255,16 @@ void Regression<T>::randomise(int min, int max, int pos) {
 template <class T>
 double Regression<T>::evaluate(vector<double> & values) {
     
-    // Add each parameter
+    // Add each active parameter in ascending order, the constant is last when active
+    size_t constant = get_count()-1;
     double ret = 0;
-    for(size_t param = 0; param < get_count()-1; param++ ) {
-        if( get_active(param) )
-            ret = add(ret, multiply( get_value(param), values[param]));
+    for(size_t param : active) {
+        if( param == constant )
+            ret = add(ret, elems[param].get_value());
+        else
+            ret = add(ret, multiply( elems[param].get_value(), values[param]));
     }
     
-    // Add constant
-    if( get_active(get_count()-1) ) ret = add(ret, get_value(get_count()-1));
-    
     return ret;
 }
 
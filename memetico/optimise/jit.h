@@ -0,0 +1,429 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Compile model programs to native code with the system compiler, cached by structure, for long local searches
+ */
+
+#ifndef MEMETICO_OPTIMISE_JIT_H
+#define MEMETICO_OPTIMISE_JIT_H
+
+// Std
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Local
+#include <memetico/globals.h>
+#include <memetico/gpu/interpreter.h>
+#include <memetico/helpers/telemetry.h>
+
+using namespace std;
+
+extern char** environ;
+
+/** @brief Compiled objects kept open by jit::compile() before the least recently used are closed, see jit::max_cached */
+#define JIT_CACHE_SIZE 256
+
+namespace jit {
+
+    using namespace cusr;
+
+    /** @brief Compiled program, c[i] is the constant of node i of the prefix and x the sample values */
+    typedef double (*jit_fn)(const double* c, const double* x);
+
+    /** @brief Return true if node \a n carries a constant that is passed in the coefficient array rather than compiled in */
+    inline bool has_constant(const Node& n) {
+        return n.node_type == NodeType::CONST || n.node_type == NodeType::COEF ||
+              (n.node_type == NodeType::NFUNC && n.function == Function::LINTERM);
+    }
+
+    /** @brief Return the structure of \a prefix, i.e. node types, functions and variables but not constants */
+    inline string structure(const prefix_t& prefix) {
+        string key;
+        key.reserve(prefix.size()*4);
+        for(const Node& n : prefix) {
+            key += (char) ('a' + n.node_type);
+            if( n.node_type == NodeType::UFUNC || n.node_type == NodeType::BFUNC || n.node_type == NodeType::NFUNC )
+                key += (char) ('a' + n.function);
+            if( n.node_type == NodeType::VAR || n.node_type == NodeType::COEF ||
+               (n.node_type == NodeType::NFUNC && n.function == Function::CFSTEP) )
+                key += to_string(n.variable);
+            key += ';';
+        }
+        return key;
+    }
+
+    /** @brief Write the coefficient array of \a prefix, as passed to the compiled program */
+    inline void coefficients(const prefix_t& prefix, vector<double>& c) {
+        c.resize(prefix.size());
+        for(size_t i = 0; i < prefix.size(); i++)
+            c[i] = has_constant(prefix[i]) ? prefix[i].constant : 0;
+    }
+
+    /**
+     * @brief Return C++ source evaluating \a prefix with identical numerics to interpret<double>()
+     * - Nodes are visited right to left, each stack value becoming a local, so the compiler sees straight-line code
+     * - Constants are read from c[i] so the source depends only on the structure
+     *
+     * @param prefix program, plain or fused
+     * @param key structure of the program, returned by memetico_jit_key() to verify cached objects
+     * @return source defining extern "C" memetico_jit_eval() and memetico_jit_key()
+     */
+    inline string source(const prefix_t& prefix, const string& key) {
+
+        stringstream os;
+        os.precision(17);
+        os << "#include <cmath>\nusing namespace std;\n";
+        os << "extern \"C\" const char* memetico_jit_key() { return \"" << key << "\"; }\n";
+        os << "extern \"C\" double memetico_jit_eval(const double* c, const double* x) {\n";
+        os << "    double C = 0, D = 0;\n";
+
+        const string tiny = "1.0e-30";
+        const string delta = "(double) 0.01f";
+        vector<string> stack;
+        string lin;
+        size_t t = 0;
+
+        auto pop = [&stack]() { string s = stack.back(); stack.pop_back(); return s; };
+
+        for(int i = (int) prefix.size() - 1; i >= 0; i--) {
+
+            const Node& n = prefix[i];
+            string c = "c[" + to_string(i) + "]";
+            string v = "t" + to_string(t);
+
+            if( n.node_type == NodeType::CONST ) {
+                stack.push_back(c);
+                continue;
+            }
+            if( n.node_type == NodeType::VAR ) {
+                stack.push_back("x[" + to_string(n.variable) + "]");
+                continue;
+            }
+            if( n.node_type == NodeType::COEF ) {
+                lin += " + " + c + "*x[" + to_string(n.variable) + "]";
+                continue;
+            }
+
+            t++;
+            if( n.node_type == NodeType::NFUNC && n.function == Function::LINTERM ) {
+                os << "    double " << v << " = 0" << lin << " + " << c << ";\n";
+                lin.clear();
+            } else if( n.node_type == NodeType::NFUNC && n.function == Function::CFSTEP ) {
+                if( n.variable == 0 ) {
+                    os << "    double " << v << " = " << pop() << ";\n";
+                    os << "    if( fabs(" << v << ") < " << tiny << " ) " << v << " = " << tiny << ";\n";
+                    os << "    C = " << v << "; D = 0;\n";
+                } else {
+                    string a = pop();
+                    string b = pop();
+                    string f = pop();
+                    os << "    D = " << b << " + " << a << "*D; if( fabs(D) < " << tiny << " ) D = " << tiny << ";\n";
+                    os << "    C = " << b << " + " << a << "/C; if( fabs(C) < " << tiny << " ) C = " << tiny << ";\n";
+                    os << "    D = 1/D;\n";
+                    os << "    double " << v << " = " << f << "*(D*C);\n";
+                }
+            } else if( n.node_type == NodeType::UFUNC ) {
+                string a = pop();
+                os << "    double " << v << " = ";
+                if( n.function == Function::SIN )           os << "sin(" << a << ");\n";
+                else if( n.function == Function::COS )      os << "cos(" << a << ");\n";
+                else if( n.function == Function::TAN )      os << "tan(" << a << ");\n";
+                else if( n.function == Function::LOG )      os << a << " <= 0 ? -1 : log(" << a << ");\n";
+                else                                        os << "1 / (" << a << " == 0 ? " << delta << " : " << a << ");\n";
+            } else {
+                string a = pop();
+                string b = pop();
+                os << "    double " << v << " = ";
+                if( n.function == Function::ADD )           os << a << " + " << b << ";\n";
+                else if( n.function == Function::SUB )      os << a << " - " << b << ";\n";
+                else if( n.function == Function::MUL )      os << a << " * " << b << ";\n";
+                else if( n.function == Function::DIV )      os << a << " / (" << b << " == 0 ? " << delta << " : " << b << ");\n";
+                else if( n.function == Function::MAX )      os << "(" << a << " >= " << b << " ? " << a << " : " << b << ");\n";
+                else                                        os << "(" << a << " <= " << b << " ? " << a << " : " << b << ");\n";
+            }
+            stack.push_back(v);
+        }
+
+        if( stack.size() != 1 )
+            throw runtime_error("jit::source() prefix did not reduce to a single value");
+
+        os << "    return " << stack.back() << ";\n}\n";
+        return os.str();
+    }
+
+    /** @brief Cache entry, the structure is kept to guard against hash collisions */
+    struct Entry {
+        string  key;
+        jit_fn  fn;
+
+        /** Object the function lives in, nullptr when the build failed */
+        void*   handle = nullptr;
+
+        /** Threads whose last program this is, an entry in use is never closed */
+        size_t  users = 0;
+
+        /** Tick of the last compile() returning this entry, the smallest is closed first */
+        size_t  used = 0;
+    };
+
+    /** @brief Open objects above which compile() closes the least recently used, JIT_CACHE_SIZE unless changed */
+    inline size_t max_cached = JIT_CACHE_SIZE;
+
+    /** @brief Process wide cache of compile(), guarded by its lock */
+    struct Cache {
+        mutex                                   lock;
+        unordered_map<size_t, unique_ptr<Entry>> entries;
+        size_t                                  tick = 0;
+    };
+
+    /** @brief Return the cache, never destroyed as threads may release their entries during exit */
+    inline Cache& cache() {
+        static Cache* c = new Cache();
+        return *c;
+    }
+
+    /** @brief Last entry returned to a thread, released when the thread moves on or exits */
+    struct Last {
+        Entry*  entry = nullptr;
+
+        ~Last() {
+            if( entry == nullptr )
+                return;
+            lock_guard<mutex> guard(cache().lock);
+            entry->users--;
+        }
+    };
+
+    /** @brief Return the number of entries in the cache */
+    inline size_t cached() {
+        lock_guard<mutex> guard(cache().lock);
+        return cache().entries.size();
+    }
+
+    /** @brief Close and remove least recently used entries no thread is using until the cache is within max_cached, with the cache locked */
+    inline void evict(Cache& c) {
+
+        while( c.entries.size() > max_cached ) {
+
+            auto oldest = c.entries.end();
+            for(auto it = c.entries.begin(); it != c.entries.end(); it++)
+                if( it->second->users == 0 && (oldest == c.entries.end() || it->second->used < oldest->second->used) )
+                    oldest = it;
+            if( oldest == c.entries.end() )
+                return;
+
+            if( oldest->second->handle != nullptr )
+                dlclose(oldest->second->handle);
+            c.entries.erase(oldest);
+        }
+    }
+
+    /** @brief Return the per user directory of compiled objects, used when meme::JIT_DIR is empty */
+    inline string default_dir() {
+        const char* xdg = getenv("XDG_CACHE_HOME");
+        if( xdg != nullptr && xdg[0] == '/' )
+            return string(xdg) + "/memetico_jit/";
+        const char* home = getenv("HOME");
+        if( home != nullptr && home[0] == '/' )
+            return string(home) + "/.cache/memetico_jit/";
+        return "/tmp/memetico_jit_" + to_string(geteuid()) + "/";
+    }
+
+    /** @brief Return \a path without trailing slashes, so lstat() sees a symbolic link rather than its target */
+    inline string strip(string path) {
+        while( path.size() > 1 && path.back() == '/' )
+            path.pop_back();
+        return path;
+    }
+
+    /**
+     * @brief Create \a dir private to the effective user, returning false when it cannot be trusted
+     * - Missing directories are created with filesystem::create_directories() and \a dir is restricted to 0700
+     * - A symbolic link, or a directory of another user, is refused so nothing in it is ever loaded
+     */
+    inline bool private_dir(const string& dir) {
+
+        error_code ec;
+        filesystem::create_directories(dir, ec);
+
+        struct stat st;
+        string d = strip(dir);
+        if( lstat(d.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid() )
+            return false;
+        return (st.st_mode & 077) == 0 || chmod(d.c_str(), 0700) == 0;
+    }
+
+    /** @brief Return true when \a path is a regular file of the effective user that no other user can write */
+    inline bool trusted(const string& path) {
+        struct stat st;
+        return lstat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_uid == geteuid() &&
+               (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+    }
+
+    /** @brief Run \a args without a shell, discarding its output, and return true when it exits with status 0 */
+    inline bool run(const vector<string>& args) {
+
+        vector<char*> argv;
+        for(const string& a : args)
+            argv.push_back(const_cast<char*>(a.c_str()));
+        argv.push_back(nullptr);
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+        pid_t pid;
+        int err = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if( err != 0 )
+            return false;
+
+        int status;
+        while( waitpid(pid, &status, 0) < 0 )
+            if( errno != EINTR )
+                return false;
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    /**
+     * @brief Open a compiled object and return its entry point if it was built for \a key, else nullptr
+     * - The object stays open, its handle is written to \a handle when given so the caller can close it
+     */
+    inline jit_fn load(const string& so, const string& key, void** handle_out = nullptr) {
+
+        // Ownership is checked before dlopen() as the constructors of a library run when it is opened
+        if( !trusted(so) )
+            return nullptr;
+
+        void* handle = dlopen(so.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if( handle == nullptr )
+            return nullptr;
+
+        auto key_fn = (const char* (*)()) dlsym(handle, "memetico_jit_key");
+        auto fn = (jit_fn) dlsym(handle, "memetico_jit_eval");
+        if( key_fn == nullptr || fn == nullptr || key != key_fn() ) {
+            dlclose(handle);
+            return nullptr;
+        }
+
+        if( handle_out != nullptr )
+            *handle_out = handle;
+        return fn;
+    }
+
+    /**
+     * @brief Return the compiled program for the structure of \a prefix, or nullptr if it cannot be compiled
+     * - The last structure used on each thread is returned without locking, as a local search keeps its structure fixed
+     * - Otherwise the process wide cache is checked, then meme::JIT_DIR for an object built by an earlier run
+     * - Misses write the source and build it with $CXX (default c++), failures are cached so they are not retried
+     * - A miss blocks the calling thread for the build, each structure is built once per directory and later runs load it
+     * - Objects are only built and loaded in a directory private to the user, see private_dir() and trusted()
+     * - At most max_cached objects are kept open, the least recently used that no thread holds are closed first and
+     *   are loaded again from the directory when needed. Each thread holds one, so the count exceeds max_cached by at
+     *   most the number of threads. The directory itself is not pruned
+     * - The returned function is valid until the calling thread calls compile() again, or exits
+     *
+     * @param prefix program whose constants are passed at call time, see coefficients()
+     * @return compiled function, or nullptr to fall back to the interpreted model
+     */
+    inline jit_fn compile(const prefix_t& prefix) {
+
+        static thread_local Last last;
+
+        string key = structure(prefix);
+        if( last.entry != nullptr && last.entry->fn != nullptr && key == last.entry->key ) {
+            telemetry::count(telemetry::CacheHits);
+            return last.entry->fn;
+        }
+
+        Cache& c = cache();
+        size_t h = hash<string>()(key);
+
+        lock_guard<mutex> guard(c.lock);
+
+        auto it = c.entries.find(h);
+        if( it != c.entries.end() && it->second->key == key )
+            telemetry::count(telemetry::CacheHits);
+        else if( it != c.entries.end() )
+            // Another structure with the same hash, and the same object name, is interpreted instead
+            return nullptr;
+        else {
+
+            string dir = meme::JIT_DIR != "" ? meme::JIT_DIR : default_dir();
+            if( dir.back() != '/' )
+                dir += '/';
+
+            jit_fn fn = nullptr;
+            void* handle = nullptr;
+            if( private_dir(dir) ) {
+
+                string base = dir + "memetico_jit_" + to_string(h);
+                fn = load(base + ".so", key, &handle);
+
+                if( fn == nullptr ) {
+
+                    // Build under unique names and rename, so concurrent processes never load a partial object
+                    string tmp = base + "." + to_string(getpid());
+                    ofstream src(tmp + ".cpp");
+                    src << source(prefix, key);
+                    src.close();
+
+                    // $CXX may hold a launcher and flags, e.g. "ccache g++", its words are passed as arguments
+                    vector<string> cmd;
+                    const char* cxx = getenv("CXX");
+                    istringstream words(cxx != nullptr ? cxx : "c++");
+                    for(string w; words >> w; )
+                        cmd.push_back(w);
+                    if( cmd.empty() )
+                        cmd.push_back("c++");
+                    cmd.insert(cmd.end(), {"-O2", "-shared", "-fPIC", "-o", tmp + ".so", tmp + ".cpp"});
+
+                    if( src && run(cmd) && chmod((tmp + ".so").c_str(), 0700) == 0 &&
+                        rename((tmp + ".so").c_str(), (base + ".so").c_str()) == 0 )
+                        fn = load(base + ".so", key, &handle);
+                    remove((tmp + ".cpp").c_str());
+                    remove((tmp + ".so").c_str());
+                }
+            }
+
+            unique_ptr<Entry> e = make_unique<Entry>();
+            e->key = key;
+            e->fn = fn;
+            e->handle = handle;
+            it = c.entries.emplace(h, move(e)).first;
+        }
+
+        // Hold the new entry before releasing the previous one, then close what no thread holds
+        Entry* entry = it->second.get();
+        entry->used = ++c.tick;
+        entry->users++;
+        if( last.entry != nullptr )
+            last.entry->users--;
+        last.entry = entry;
+        evict(c);
+
+        return entry->fn;
+    }
+
+}
+
+#endif
@@ -12,7 +12,10 @@
 
 #include <memetico/population/agent.h>
 #include <memetico/globals.h>
+#include <memetico/optimise/objective.h>
 #include <limits>
+#include <deque>
+#include <Eigen/Dense>
 
 using namespace meme;
 
@@ -30,8 +33,22 @@ double custom_nelder_mead_redo(U* model, DataSet* data, vector<size_t>&);
 template <class U>
 double custom_nelder_mead_alg4(U* model, DataSet* data, vector<size_t>&);
 
-//size_t nm_iters;
-//unsigned int nm_duration;
+template <class U>
+double gradient_evaluate(vector<double>& params, vector<size_t>& positions, U* model, DataSet* data, vector<size_t>&, vector<double>& grad, vector<double>* jtj = nullptr);
+
+template <class U>
+double lbfgs(U* model, DataSet* data, vector<size_t>&);
+
+template <class U>
+double levenberg_marquardt(U* model, DataSet* data, vector<size_t>&);
+
+/** @brief Iteration limit of a search, NELDER_MEAD_MOVES scaled by NELDER_MEAD_SCALE */
+inline size_t max_moves() {
+    return meme::NELDER_MEAD_SCALE < 1 ? max((size_t) 1, (size_t) (meme::NELDER_MEAD_MOVES*meme::NELDER_MEAD_SCALE)) : meme::NELDER_MEAD_MOVES;
+}
+
+/** @brief Number of curvature pairs retained by lbfgs() */
+const size_t LBFGS_MEMORY = 8;
 
 template <typename Operator>
 vector<double> vo(vector<double> a, vector<double> b, Operator);
@@ -1,176 +1,346 @@
-
-#include "doctest.h"
-#include <memetico/data/data_set.h>
-#include <memetico/models/regression.h>
-#include <memetico/models/cont_frac.h>
-#include <memetico/optimise/objective.h>
-#include <memetico/optimise/local_search.h>
-#include <string>
-#include <ostream>
-#include <memetico/models/mutation.h>
-
-// Define the template strucutre of a model
-template<
-    typename T,         
-    typename U, 
-    template <typename, typename> class MutationPolicy>
-struct Traits {
-    using TType = T;                        // Term type, e.g. Regression<double>
-    using UType = U;                        // Data type, e.g. double, should match T::TType
-    template <typename V, typename W>
-    using MPType = MutationPolicy<V, W>;    // Mutation Policy general class, e.g. MutateHardSoft<TermType, DataType>
-};
-
-typedef double DataType;
-typedef Regression<DataType> TermType;
-typedef ContinuedFraction<Traits<TermType, DataType, mutation::MutateHardSoft>> ModelType;
-
-
-inline void init(string filename) {
-
-    // Create sample data
-    string fn(filename);
-    ofstream f;
-    f.open(fn);
-    if (!f.is_open())
-        throw runtime_error("Unable to open file "+ fn);
-
-    f << "y,x" << endl;
-    // Argon dataset, code generated in excel with =CONCAT("f << ",CHAR(34),A2, ",", B2, CHAR(34), " << endl;")
-    f << "363.94,3.1" << endl;
-    f << "58.41,3.3" << endl;
-    f << "-14.92,3.4" << endl;
-    f << "-58.41,3.5" << endl;
-    f << "-81.69,3.6" << endl;
-    f << "-88.36,3.65" << endl;
-    f << "-92.56,3.7" << endl;
-    f << "-94.73,3.75" << endl;
-    f << "-95.39,3.8" << endl;
-    f << "-94.75,3.85" << endl;
-    f << "-93.16,3.9" << endl;
-    f << "-90.89,3.95" << endl;
-    f << "-88.01,4" << endl;
-    f << "-81.19,4.1" << endl;
-    f << "-73.63,4.2" << endl;
-    f << "-65.98,4.3" << endl;
-    f << "-58.6,4.4" << endl;
-    f << "-51.78,4.5" << endl;
-    f << "-45.6,4.6" << endl;
-    f << "-40.13,4.7" << endl;
-    f << "-35.34,4.8" << endl;
-    f << "-31.17,4.9" << endl;
-    f << "-27.57,5" << endl;
-    f << "-24.46,5.1" << endl;
-    f << "-19.37,5.3" << endl;
-    f << "-15.47,5.5" << endl;
-    f << "-12.43,5.7" << endl;
-    f << "-10,5.9" << endl;
-    f << "-8.13,6.1" << endl;
-    f << "-6.63,6.3" << endl;
-    f << "-5.44,6.5" << endl;
-    f << "-4.49,6.7" << endl;
-
-    f.close();
-
-}
-
-inline ModelType small_frac() {
-
-    // f(x) = x1 - 20 
-    size_t params = 2;
-    size_t depth = 0;
-    ModelType o  = ModelType(depth);
-    Regression<double> m1 = Regression<double>(params);
-    o.set_global_active(0, true);
-    o.set_global_active(1, true);
-    double d0 = 1;
-    double d1 = -20;
-    m1.set_active(0, true);
-    m1.set_active(1, true);
-    m1.set_value(0, d0);
-    m1.set_value(1, d1);
-    o.set_terms(0,m1);
-    
-    return o;
-}
-
-inline Regression<double> small_regress_frac() {
-
-    // f(x) = x1 - 20 
-    size_t params = 2;
-    size_t depth = 0;
-    Regression<double> m1 = Regression<double>(params);
-    double d0 = 1;
-    double d1 = -20;
-    m1.set_active(0, true);
-    m1.set_active(1, true);
-    m1.set_value(0, d0);
-    m1.set_value(1, d1);
-    
-    return m1;
-}
-
-TEST_CASE("Localsearch: on Regression<double>") {
-
-    RandInt ri = RandInt(42);
-    RandReal rr = RandReal(42);
-    RandInt::RANDINT = &ri;
-    RandReal::RANDREAL = &rr;
-
-    DataSet::IVS.clear();
-
-    string fn = "test_data.csv";
-    init(fn);
-    DataSet ds = DataSet(fn);
-    ds.load();
-
-    TermType f1 = small_regress_frac();
-    TermType f1_copy = TermType(f1);
-
-    MemeticModel<double>* model = static_cast<MemeticModel<double>*>(&f1);
-
-    MemeticModel<double>::IVS.clear();
-    for(size_t i = 0; i < DataSet::IVS.size(); i++)
-        MemeticModel<double>::IVS.push_back(DataSet::IVS[i]);
-
-    vector<size_t> all;
-
-    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
-    MemeticModel<DataType>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
-    MemeticModel<DataType>::LOCAL_SEARCH(model, &ds, all);
-
-    REQUIRE( f1.get_fitness() < f1_copy.get_fitness() );
-}
-
-TEST_CASE("Localsearch: on ContinuedFraction<double>") {
-
-    RandInt ri = RandInt(42);
-    RandReal rr = RandReal(42);
-    RandInt::RANDINT = &ri;
-    RandReal::RANDREAL = &rr;
-
-    DataSet::IVS.clear();
-
-    string fn = "test_data.csv";
-    init(fn);
-    DataSet ds = DataSet(fn);
-    ds.load();
-
-    ModelType f1 = small_frac();
-    ModelType f1_copy = ModelType(f1);
-
-    //MemeticModel<double>* model = static_cast<MemeticModel<double>*>(&f1);
-    MemeticModel<double>* model = static_cast<MemeticModel<double>*>(&f1);
-
-    MemeticModel<double>::IVS.clear();
-    for(size_t i = 0; i < DataSet::IVS.size(); i++)
-        MemeticModel<double>::IVS.push_back(DataSet::IVS[i]);
-
-    vector<size_t> all;
-
-    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
-    MemeticModel<DataType>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<DataType>>;
-    MemeticModel<DataType>::LOCAL_SEARCH(model, &ds, all);
-
-    REQUIRE( f1.get_fitness() < f1_copy.get_fitness() );
-}
+
+#include "doctest.h"
+#include <memetico/data/data_set.h>
+#include <memetico/models/regression.h>
+#include <memetico/models/cont_frac.h>
+#include <memetico/optimise/objective.h>
+#include <memetico/optimise/local_search.h>
+#include <string>
+#include <ostream>
+#include <memetico/models/mutation.h>
+
+// Define the template strucutre of a model
+template<
+    typename T,         
+    typename U, 
+    template <typename, typename> class MutationPolicy>
+struct Traits {
+    using TType = T;                        // Term type, e.g. Regression<double>
+    using UType = U;                        // Data type, e.g. double, should match T::TType
+    template <typename V, typename W>
+    using MPType = MutationPolicy<V, W>;    // Mutation Policy general class, e.g. MutateHardSoft<TermType, DataType>
+};
+
+typedef double DataType;
+typedef Regression<DataType> TermType;
+typedef ContinuedFraction<Traits<TermType, DataType, mutation::MutateHardSoft>> ModelType;
+
+
+inline void init(string filename) {
+
+    // Create sample data
+    string fn(filename);
+    ofstream f;
+    f.open(fn);
+    if (!f.is_open())
+        throw runtime_error("Unable to open file "+ fn);
+
+    f << "y,x" << endl;
+    // Argon dataset, code generated in excel with =CONCAT("f << ",CHAR(34),A2, ",", B2, CHAR(34), " << endl;")
+    f << "363.94,3.1" << endl;
+    f << "58.41,3.3" << endl;
+    f << "-14.92,3.4" << endl;
+    f << "-58.41,3.5" << endl;
+    f << "-81.69,3.6" << endl;
+    f << "-88.36,3.65" << endl;
+    f << "-92.56,3.7" << endl;
+    f << "-94.73,3.75" << endl;
+    f << "-95.39,3.8" << endl;
+    f << "-94.75,3.85" << endl;
+    f << "-93.16,3.9" << endl;
+    f << "-90.89,3.95" << endl;
+    f << "-88.01,4" << endl;
+    f << "-81.19,4.1" << endl;
+    f << "-73.63,4.2" << endl;
+    f << "-65.98,4.3" << endl;
+    f << "-58.6,4.4" << endl;
+    f << "-51.78,4.5" << endl;
+    f << "-45.6,4.6" << endl;
+    f << "-40.13,4.7" << endl;
+    f << "-35.34,4.8" << endl;
+    f << "-31.17,4.9" << endl;
+    f << "-27.57,5" << endl;
+    f << "-24.46,5.1" << endl;
+    f << "-19.37,5.3" << endl;
+    f << "-15.47,5.5" << endl;
+    f << "-12.43,5.7" << endl;
+    f << "-10,5.9" << endl;
+    f << "-8.13,6.1" << endl;
+    f << "-6.63,6.3" << endl;
+    f << "-5.44,6.5" << endl;
+    f << "-4.49,6.7" << endl;
+
+    f.close();
+
+}
+
+inline ModelType small_frac() {
+
+    // f(x) = x1 - 20 
+    size_t params = 2;
+    size_t depth = 0;
+    ModelType o  = ModelType(depth);
+    Regression<double> m1 = Regression<double>(params);
+    o.set_global_active(0, true);
+    o.set_global_active(1, true);
+    double d0 = 1;
+    double d1 = -20;
+    m1.set_active(0, true);
+    m1.set_active(1, true);
+    m1.set_value(0, d0);
+    m1.set_value(1, d1);
+    o.set_terms(0,m1);
+    
+    return o;
+}
+
+inline Regression<double> small_regress_frac() {
+
+    // f(x) = x1 - 20 
+    size_t params = 2;
+    Regression<double> m1 = Regression<double>(params);
+    double d0 = 1;
+    double d1 = -20;
+    m1.set_active(0, true);
+    m1.set_active(1, true);
+    m1.set_value(0, d0);
+    m1.set_value(1, d1);
+    
+    return m1;
+}
+
+TEST_CASE("Localsearch: on Regression<double>") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    DataSet::IVS.clear();
+
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet ds = DataSet(fn);
+    ds.load();
+
+    TermType f1 = small_regress_frac();
+    TermType f1_copy = TermType(f1);
+
+    MemeticModel<double>* model = static_cast<MemeticModel<double>*>(&f1);
+
+    MemeticModel<double>::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        MemeticModel<double>::IVS.push_back(DataSet::IVS[i]);
+
+    vector<size_t> all;
+
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<DataType>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
+    MemeticModel<DataType>::LOCAL_SEARCH(model, &ds, all);
+
+    REQUIRE( f1.get_fitness() < f1_copy.get_fitness() );
+}
+
+TEST_CASE("Localsearch: on ContinuedFraction<double>") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    DataSet::IVS.clear();
+
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet ds = DataSet(fn);
+    ds.load();
+
+    ModelType f1 = small_frac();
+    ModelType f1_copy = ModelType(f1);
+
+    //MemeticModel<double>* model = static_cast<MemeticModel<double>*>(&f1);
+    MemeticModel<double>* model = static_cast<MemeticModel<double>*>(&f1);
+
+    MemeticModel<double>::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        MemeticModel<double>::IVS.push_back(DataSet::IVS[i]);
+
+    vector<size_t> all;
+
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<DataType>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<DataType>>;
+    MemeticModel<DataType>::LOCAL_SEARCH(model, &ds, all);
+
+    REQUIRE( f1.get_fitness() < f1_copy.get_fitness() );
+}
+
+TEST_CASE("Localsearch: gradient methods on ContinuedFraction<double>") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    DataSet::IVS.clear();
+
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet ds = DataSet(fn);
+    ds.load();
+
+    MemeticModel<double>::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        MemeticModel<double>::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    vector<size_t> all;
+
+    // 1. Linear least squares, both methods reach the same minimum
+    ModelType f1 = small_frac();
+    ModelType f2 = small_frac();
+    double start = f1.objective(&ds);
+    f2.objective(&ds);
+
+    local_search::levenberg_marquardt<MemeticModel<DataType>>(&f1, &ds, all);
+    local_search::lbfgs<MemeticModel<DataType>>(&f2, &ds, all);
+    CHECK( f1.get_fitness() < start );
+    CHECK( f2.get_fitness() < start );
+    CHECK( f1.get_fitness() == doctest::Approx(f2.get_fitness()).epsilon(1e-4) );
+
+    // 2. Analytic gradient vanishes at the least squares solution
+    vector<size_t> positions = f1.get_active_positions();
+    vector<double> grad;
+    objective::mse_grad<DataType>(&f1, &ds, all, positions, grad);
+    for(double g : grad)
+        CHECK( g == doctest::Approx(0).epsilon(1e-6) );
+
+    // 3. Depth one fraction, f(x) = x - 20 + 1/(x - 3)
+    ModelType f3 = ModelType(1);
+    for(size_t t = 0; t < 3; t++) {
+        Regression<double> r = Regression<double>(2);
+        r.set_active(0, t != 1);
+        r.set_active(1, true);
+        r.set_value(0, 1);
+        r.set_value(1, t == 0 ? -20 : (t == 1 ? 1 : -3));
+        f3.set_terms(t, r);
+    }
+    start = f3.objective(&ds);
+    local_search::levenberg_marquardt<MemeticModel<DataType>>(&f3, &ds, all);
+    CHECK( f3.get_fitness() < start );
+
+}
+
+TEST_CASE("Localsearch: compiled models") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    DataSet::IVS.clear();
+
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet ds = DataSet(fn);
+    ds.load();
+
+    MemeticModel<double>::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        MemeticModel<double>::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    vector<size_t> all;
+    meme::JIT_DIR = "/tmp/memetico_jit_test/";
+
+    // 1. Compiled program matches evaluate() and mse() on a random depth 3 fraction
+    ModelType f1 = ModelType(3);
+    prefix_t prefix;
+    f1.get_fused_prefix(prefix);
+    jit::jit_fn compiled = jit::compile(prefix);
+    REQUIRE( compiled != nullptr );
+
+    vector<double> c;
+    jit::coefficients(prefix, c);
+    for(size_t i = 0; i < ds.get_count(); i++)
+        CHECK( compiled(c.data(), ds.samples[i].data()) == doctest::Approx(f1.evaluate(ds.samples[i])) );
+
+    double interpreted = objective::mse<DataType>(&f1, &ds, all);
+    CHECK( objective::mse_compiled<DataType>(&f1, compiled, c, &ds, all) == doctest::Approx(interpreted) );
+    vector<size_t> some = {1, 5, 9, 20};
+    interpreted = objective::mse<DataType>(&f1, &ds, some);
+    CHECK( objective::mse_compiled<DataType>(&f1, compiled, c, &ds, some) == doctest::Approx(interpreted) );
+
+    // 2. Coefficient changes reuse the program, structure changes do not
+    f1.set_value(f1.get_active_positions()[0], 123.0);
+    prefix.clear();
+    f1.get_fused_prefix(prefix);
+    CHECK( jit::compile(prefix) == compiled );
+    ModelType f2 = ModelType(2);
+    prefix.clear();
+    f2.get_fused_prefix(prefix);
+    CHECK( jit::compile(prefix) != compiled );
+
+    // 3. Nelder-Mead reaches the same fitness compiled or interpreted
+    ModelType f3 = ModelType(1);
+    ModelType f4 = ModelType(f3);
+    f3.objective(&ds);
+    f4.objective(&ds);
+    local_search::custom_nelder_mead_redo<MemeticModel<DataType>>(&f3, &ds, all);
+    meme::JIT = true;
+    local_search::custom_nelder_mead_redo<MemeticModel<DataType>>(&f4, &ds, all);
+    meme::JIT = false;
+    CHECK( f4.get_fitness() == doctest::Approx(f3.get_fitness()).epsilon(1e-6) );
+
+    // 4. The directory is made private and objects are only loaded when no other user could have written them
+    struct stat st;
+    REQUIRE( lstat("/tmp/memetico_jit_test", &st) == 0 );
+    CHECK( (st.st_mode & 0777) == 0700 );
+    chmod("/tmp/memetico_jit_test", 0777);
+    CHECK( jit::private_dir(meme::JIT_DIR) );
+    REQUIRE( lstat("/tmp/memetico_jit_test", &st) == 0 );
+    CHECK( (st.st_mode & 0777) == 0700 );
+
+    remove("/tmp/memetico_jit_test_link");
+    REQUIRE( symlink("/tmp/memetico_jit_test", "/tmp/memetico_jit_test_link") == 0 );
+    CHECK( !jit::private_dir("/tmp/memetico_jit_test_link/") );
+    remove("/tmp/memetico_jit_test_link");
+
+    string key = jit::structure(prefix);
+    string so = meme::JIT_DIR + "memetico_jit_" + to_string(hash<string>()(key)) + ".so";
+    string copy = meme::JIT_DIR + "copy.so";
+    filesystem::copy_file(so, copy, filesystem::copy_options::overwrite_existing);
+    chmod(copy.c_str(), 0666);
+    CHECK( !jit::trusted(copy) );
+    CHECK( jit::load(copy, key) == nullptr );
+    chmod(copy.c_str(), 0600);
+    CHECK( jit::trusted(copy) );
+    void* handle = nullptr;
+    CHECK( jit::load(copy, key, &handle) != nullptr );
+    REQUIRE( handle != nullptr );
+    dlclose(handle);
+    remove(copy.c_str());
+
+    // 5. The cache closes the least recently used objects beyond max_cached and reloads them when needed again,
+    //    entries still held by the threads of earlier searches are kept so only the count is checked not to grow
+    size_t max_cached = jit::max_cached;
+    jit::max_cached = 2;
+    size_t held = 0;
+    for(size_t depth = 1; depth <= 3; depth++) {
+        ModelType f = ModelType(depth);
+        prefix.clear();
+        f.get_fused_prefix(prefix);
+        jit::compile(prefix);
+        if( depth == 1 )
+            held = max(jit::cached(), (size_t) 2);
+        CHECK( jit::cached() <= held );
+    }
+    prefix.clear();
+    f1.get_fused_prefix(prefix);
+    compiled = jit::compile(prefix);
+    REQUIRE( compiled != nullptr );
+    CHECK( jit::cached() <= held );
+    jit::coefficients(prefix, c);
+    CHECK( objective::mse_compiled<DataType>(&f1, compiled, c, &ds, all) == doctest::Approx(objective::mse<DataType>(&f1, &ds, all)) );
+    jit::max_cached = max_cached;
+
+}
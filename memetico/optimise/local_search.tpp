@@ -14,6 +14,22 @@ double local_search::model_evaluate(vector<double>& params, vector<size_t>& posi
         model->set_value(positions[i], params[i]);
     }
 
+    // Compiled evaluation, the structure is fixed during the search so the program is compiled once and cached
+    if( meme::JIT && !data->get_gpu() && U::OBJECTIVE == static_cast<decltype(U::OBJECTIVE)>(objective::mse) ) {
+
+        static thread_local prefix_t prefix;
+        static thread_local vector<double> c;
+        prefix.clear();
+        model->get_fused_prefix(prefix);
+
+        jit::jit_fn fn = jit::compile(prefix);
+        if( fn != nullptr ) {
+            jit::coefficients(prefix, c);
+            telemetry::count(telemetry::ObjectiveCalls);
+            return objective::mse_compiled(model, fn, c, data, selected);
+        }
+    }
+
     return model->objective(data, selected);
 }
 
@@ -27,6 +43,11 @@ double local_search::model_evaluate(vector<double>& params, vector<size_t>& posi
 template <class U>
 double local_search::custom_nelder_mead(U* model, DataSet* data, vector<size_t>& selected) {
 
+    PROFILE_SCOPE("nelder_mead");
+
+    // Mixed precision re-scores in double only the trial points that could improve on the starting fitness
+    objective::ScreenScope screen(model->get_fitness());
+
     // We consider a three-dimensional problem, there are a series of y(x1,x2) po
     // 
     // - w is the worst y(x1, x2)
@@ -44,11 +65,6 @@ double local_search::custom_nelder_mead(U* model, DataSet* data, vector<size_t>&
     // 
     //                b2
 
-    //local_search::nm_duration = 0;
-    //local_search::nm_iters = 0;
-
-    //auto start_nm = chrono::high_resolution_clock::now();
-
     using coord = vector<double>;
 
     // Determine the number of parameters to optimise
@@ -110,37 +126,42 @@ double local_search::custom_nelder_mead(U* model, DataSet* data, vector<size_t>&
     // Evaluation of the simplex at the current point
     simplex.insert({model->get_fitness(), tmp});
 
-    // Create simplex points by steping forward in each dimension a length of 'step' and appending
-    // to the simplex. After this operation our simplex will be params+1 in length, as we have the original
-    // fitness and values, then 10 modifications where each dimension is stepped
-    for (size_t i = 0; i < params; ++i) {
-        tmp[i] += step;
-        double fitness = local_search::model_evaluate(tmp, positions, model, data, selected);
-        simplex.insert({ fitness, tmp});
-        tmp[i] -= step;
-    }
+    {
+        PROFILE_SCOPE("nelder_mead: simplex");
 
-    // Given our array of simplex points, calculate the centroid point and its fitness
-    for (size_t i = 0; i < params; ++i) {
-        cent[i] = 0;
-        for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
+        // Create simplex points by steping forward in each dimension a length of 'step' and appending
+        // to the simplex. After this operation our simplex will be params+1 in length, as we have the original
+        // fitness and values, then 10 modifications where each dimension is stepped
+        for (size_t i = 0; i < params; ++i) {
+            tmp[i] += step;
+            double fitness = local_search::model_evaluate(tmp, positions, model, data, selected);
+            simplex.insert({ fitness, tmp});
+            tmp[i] -= step;
+        }
+
+        // Given our array of simplex points, calculate the centroid point and its fitness
+        for (size_t i = 0; i < params; ++i) {
+            cent[i] = 0;
+            for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
 
-            // Sum the values from each dimension
-            // Caclulate the average value on the fly to minimise risk of overflow
-            cent[i] += it->second[i] / params;
+                // Sum the values from each dimension
+                // Caclulate the average value on the fly to minimise risk of overflow
+                cent[i] += it->second[i] / params;
         
+        }
+        cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
     }
-    cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
 
     size_t iter = 0;       // either converge, or reach max number of iterations, or stagnate for too long
     size_t stag = 0;       // stagnation is when the new vertex is still the worst
     double vtmp_fit = 0;
     
     while ( simplex.begin()->first - (--simplex.end())->first > numeric_limits<double>::epsilon()  &&   // The range in the simplex points has a difference > some epsilon   
-            iter < meme::NELDER_MEAD_MOVES &&                           // We have not reached the max iterations
+            iter < local_search::max_moves() &&                           // We have not reached the max iterations
             stag < meme::NELDER_MEAD_STALE                              // We have not stagnated
         ) {
-        
+
+        PROFILE_SCOPE("nelder_mead: iteration");
 
         // Get the worst point i.e. highest fitness 
         coord& vw = simplex.begin()->second;
@@ -214,16 +235,21 @@ double local_search::custom_nelder_mead(U* model, DataSet* data, vector<size_t>&
         simplex.insert({vtmp_fit, vtmp});
 
         // recompute the centroid
-        for (size_t i = 0; i < params; ++i) {
-            cent[i] = 0;
-            for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
-                cent[i] += it->second[i] / params;
+        {
+            PROFILE_SCOPE("nelder_mead: centroid");
+            for (size_t i = 0; i < params; ++i) {
+                cent[i] = 0;
+                for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
+                    cent[i] += it->second[i] / params;
+            }
+            cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
         }
-        cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
 
         ++iter;
     }
 
+    telemetry::count(telemetry::NelderMeadIterations, iter);
+
     coord best_found = (--simplex.end())->second;
 
     for(size_t i = 0; i < best_found.size(); i++)
@@ -245,6 +271,11 @@ double local_search::custom_nelder_mead(U* model, DataSet* data, vector<size_t>&
 template <class U>
 double local_search::custom_nelder_mead_alg4(U* model, DataSet* data, vector<size_t>& selected) {
 
+    PROFILE_SCOPE("nelder_mead_alg4");
+
+    // Mixed precision re-scores in double only the trial points that could improve on the starting fitness
+    objective::ScreenScope screen(model->get_fitness());
+
     // "In order to find out whether the parts of the algorithm that are rarely executed matter at all, 
     //  we simplified the genetically bred Algorithm 3 in such a way that we. Nearly half of the code is
     //  hardly ever executed. We simplified the remaining, the result was a much simpler algorithm, shown
@@ -276,34 +307,42 @@ double local_search::custom_nelder_mead_alg4(U* model, DataSet* data, vector<siz
         tmp[i] = model->get_value(positions[i]);
     simplex.insert({model->get_fitness(), tmp});
 
-    // Step in each direction of each dimension to make a new point
-    for (size_t i = 0; i < params; ++i) {
-        tmp[i] += step;
-        double fitness = local_search::model_evaluate(tmp, positions, model, data, selected);
-        simplex.insert({fitness, tmp});
-        tmp[i] -= step;
-    }
-
-    // Determine the centroid of our simplex
     coord cent(params);      
-    for (size_t i = 0; i < params; ++i) {
-        
-        // We skip the worst point as it is excluded from the centroid with ++ simplex.begin()
-        cent[i] = 0;
-        for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
-            // Caclulate the average value on the fly to minimise risk of overflow
-            cent[i] += it->second[i] / params;
+    double cent_fit;
+
+    {
+        PROFILE_SCOPE("nelder_mead_alg4: simplex");
+
+        // Step in each direction of each dimension to make a new point
+        for (size_t i = 0; i < params; ++i) {
+            tmp[i] += step;
+            double fitness = local_search::model_evaluate(tmp, positions, model, data, selected);
+            simplex.insert({fitness, tmp});
+            tmp[i] -= step;
+        }
+
+        // Determine the centroid of our simplex
+        for (size_t i = 0; i < params; ++i) {
+            
+            // We skip the worst point as it is excluded from the centroid with ++ simplex.begin()
+            cent[i] = 0;
+            for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
+                // Caclulate the average value on the fly to minimise risk of overflow
+                cent[i] += it->second[i] / params;
+        }
+        cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
     }
-    double cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
 
     size_t iter = 0;       // either converge, or reach max number of iterations, or stagnate for too long
     size_t stag = 0;       // stagnation is when the new vertex is still the worst
     
     while ( simplex.begin()->first - (--simplex.end())->first > numeric_limits<double>::epsilon()  &&   // The range in the simplex points has a difference > some epsilon   
-            iter < meme::NELDER_MEAD_MOVES &&                           // We have not reached the max iterations
+            iter < local_search::max_moves() &&                           // We have not reached the max iterations
             stag < meme::NELDER_MEAD_STALE                              // We have not stagnated
         ) {
 
+        PROFILE_SCOPE("nelder_mead_alg4: iteration");
+
         coord vn;
         double vn_fit;
 
@@ -347,17 +386,22 @@ double local_search::custom_nelder_mead_alg4(U* model, DataSet* data, vector<siz
         else                                        stag = 0;
         
         // recompute the centroid
-        for (size_t i = 0; i < params; ++i) {
-            cent[i] = 0;
-            for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
-                cent[i] += it->second[i] / params;
-        }
+        {
+            PROFILE_SCOPE("nelder_mead_alg4: centroid");
+            for (size_t i = 0; i < params; ++i) {
+                cent[i] = 0;
+                for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
+                    cent[i] += it->second[i] / params;
+            }
 
-        cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
+            cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
+        }
         ++iter;
 
     }
 
+    telemetry::count(telemetry::NelderMeadIterations, iter);
+
     coord best_found = (--simplex.end())->second;
     selected = vector<size_t>();
     local_search::model_evaluate(best_found, positions, model, data, selected);
@@ -375,6 +419,11 @@ double local_search::custom_nelder_mead_alg4(U* model, DataSet* data, vector<siz
 template <class U>
 double local_search::custom_nelder_mead_redo(U* model, DataSet* data, vector<size_t>& selected) {
 
+    PROFILE_SCOPE("nelder_mead_redo");
+
+    // Mixed precision re-scores in double only the trial points that could improve on the starting fitness
+    objective::ScreenScope screen(model->get_fitness());
+
     using coord = vector<double>;
 
     // Determine the number of parameters to optimise
@@ -399,35 +448,41 @@ double local_search::custom_nelder_mead_redo(U* model, DataSet* data, vector<siz
     simplex.insert({model->get_fitness(), tmp});
 
 
-    // Create simplex points by steping forward in each dimension a length of 'step' and appending
-    // to the simplex. After this operation our simplex will be ndim+1 in length, as we have the original
-    // fitness and values, then 10 modifications where each dimension is stepped
-    for (size_t i = 0; i < ndim; ++i) {
-        tmp[i] += step;
-        simplex.insert({local_search::model_evaluate(tmp, positions, model, data, selected), tmp});
-        tmp[i] -= step;
-    }
+    {
+        PROFILE_SCOPE("nelder_mead_redo: simplex");
 
-    // Given our array of simplex points, calculate the centroid point and its fitness
-    for (size_t i = 0; i < ndim; ++i) {
-        cent[i] = 0;
-        for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
+        // Create simplex points by steping forward in each dimension a length of 'step' and appending
+        // to the simplex. After this operation our simplex will be ndim+1 in length, as we have the original
+        // fitness and values, then 10 modifications where each dimension is stepped
+        for (size_t i = 0; i < ndim; ++i) {
+            tmp[i] += step;
+            simplex.insert({local_search::model_evaluate(tmp, positions, model, data, selected), tmp});
+            tmp[i] -= step;
+        }
 
-            // Sum the values from each dimension
-            // Caclulate the average value on the fly to minimise risk of overflow
-            cent[i] += it->second[i] / ndim;
-        
-    }
+        // Given our array of simplex points, calculate the centroid point and its fitness
+        for (size_t i = 0; i < ndim; ++i) {
+            cent[i] = 0;
+            for (auto it = ++simplex.begin(); it != simplex.end(); ++it)
+
+                // Sum the values from each dimension
+                // Caclulate the average value on the fly to minimise risk of overflow
+                cent[i] += it->second[i] / ndim;
+            
+        }
 
-    cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
+        cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
+    }
 
     size_t iter = 0;       // either converge, or reach max number of iterations, or stagnate for too long
     size_t stag = 0;       // stagnation is when the new vertex is still the worst
 
     while ( simplex.begin()->first - (--simplex.end())->first > numeric_limits<double>::epsilon()  &&   // The range in the simplex points has a difference > some epsilon   
-            iter < meme::NELDER_MEAD_MOVES &&                           // We have not reached the max iterations
+            iter < local_search::max_moves() &&                           // We have not reached the max iterations
             stag < meme::NELDER_MEAD_STALE                              // We have not stagnated
         ) {
+
+        PROFILE_SCOPE("nelder_mead_redo: iteration");
         
         // Get the worst point i.e. highest fitness 
         coord& vw = simplex.begin()->second;
@@ -496,17 +551,22 @@ double local_search::custom_nelder_mead_redo(U* model, DataSet* data, vector<siz
         simplex.insert({vtmp_fit, vtmp});
 
         // recompute the centroid
-        for (size_t i = 0; i < ndim; ++i) {
-            cent[i] = 0;
-            for (auto it = ++simplex.begin(); it != simplex.end(); ++it) {
-                double extra = it->second[i] / ndim;
-                cent[i] += extra;
-            }   
+        {
+            PROFILE_SCOPE("nelder_mead_redo: centroid");
+            for (size_t i = 0; i < ndim; ++i) {
+                cent[i] = 0;
+                for (auto it = ++simplex.begin(); it != simplex.end(); ++it) {
+                    double extra = it->second[i] / ndim;
+                    cent[i] += extra;
+                }   
+            }
+            cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
         }
-        cent_fit = local_search::model_evaluate(cent, positions, model, data, selected);
         ++iter;
     }
 
+    telemetry::count(telemetry::NelderMeadIterations, iter);
+
     // Function on the full dataset if we were using partial in local search
     // otherwise we are using the performance of the limited optimisation
     selected = vector<size_t>();
@@ -516,6 +576,237 @@ double local_search::custom_nelder_mead_redo(U* model, DataSet* data, vector<siz
     return model->get_fitness();
 }
 
+/**
+ * Set parameters and determine the MSE and its gradient
+ * 
+ * Parameters are read back from the model so params reflect any clamping applied in set_value()
+ * 
+ * @param params values for each of the positions
+ * @param positions positions of the parameters in the model
+ * @param model Model to evaluate
+ * @param grad gradient output for positions
+ * @param jtj optional Gauss-Newton matrix output
+ * @return MSE on the selected data
+ * 
+ */
+template <class U>
+double local_search::gradient_evaluate(vector<double>& params, vector<size_t>& positions, U* model, DataSet* data, vector<size_t>& selected, vector<double>& grad, vector<double>* jtj) {
+
+    for(size_t i = 0; i < params.size(); i++) {
+        model->set_value(positions[i], params[i]);
+        params[i] = model->get_value(positions[i]);
+    }
+
+    return objective::mse_grad(model, data, selected, positions, grad, jtj);
+}
+
+/**
+ * Limited memory BFGS on the MSE of the active parameters
+ * 
+ * - Search directions from the two-loop recursion over the last LBFGS_MEMORY curvature pairs
+ * - Backtracking line search with the Armijo condition
+ * - Stops after NELDER_MEAD_MOVES iterations or NELDER_MEAD_STALE iterations without meaningful improvement
+ * 
+ * The search minimises the MSE with analytic gradients, the returned fitness is from the model objective
+ * 
+ * @param model Model to optimise
+ * @return double
+ * 
+ */
+template <class U>
+double local_search::lbfgs(U* model, DataSet* data, vector<size_t>& selected) {
+
+    PROFILE_SCOPE("lbfgs");
+
+    using coord = vector<double>;
+
+    vector<size_t> positions = model->get_active_positions();
+    size_t ndim = positions.size();
+
+    coord x(ndim), g(ndim), x_new(ndim), g_new(ndim), d(ndim);
+    for (size_t i = 0; i < ndim; ++i)
+        x[i] = model->get_value(positions[i]);
+
+    double f = local_search::gradient_evaluate(x, positions, model, data, selected, g);
+
+    auto dot = [](const coord& a, const coord& b) {
+        double r = 0;
+        for(size_t i = 0; i < a.size(); i++) r += a[i]*b[i];
+        return r;
+    };
+
+    // Curvature pairs with the most recent at the back
+    deque<coord> s_hist;
+    deque<coord> y_hist;
+    deque<double> rho_hist;
+    coord alpha(LBFGS_MEMORY);
+
+    size_t iter = 0;
+    size_t stag = 0;
+
+    while ( ndim > 0 && 
+            f != numeric_limits<double>::max() &&
+            iter < local_search::max_moves() &&
+            stag < meme::NELDER_MEAD_STALE
+        ) {
+
+        // Two-loop recursion for d = -H*g
+        d = g;
+        for(size_t k = s_hist.size(); k-- > 0; ) {
+            alpha[k] = rho_hist[k]*dot(s_hist[k], d);
+            for(size_t i = 0; i < ndim; i++) d[i] -= alpha[k]*y_hist[k][i];
+        }
+        double gamma = s_hist.empty() ? 1/max(1.0, sqrt(dot(g, g))) : dot(s_hist.back(), y_hist.back())/dot(y_hist.back(), y_hist.back());
+        for(size_t i = 0; i < ndim; i++) d[i] *= gamma;
+        for(size_t k = 0; k < s_hist.size(); k++) {
+            double beta = rho_hist[k]*dot(y_hist[k], d);
+            for(size_t i = 0; i < ndim; i++) d[i] += s_hist[k][i]*(alpha[k]-beta);
+        }
+        for(size_t i = 0; i < ndim; i++) d[i] = -d[i];
+
+        // Fall back to steepest descent if the curvature history is misleading
+        double slope = dot(g, d);
+        if( !(slope < 0) ) {
+            s_hist.clear(); y_hist.clear(); rho_hist.clear();
+            double norm = max(1.0, sqrt(dot(g, g)));
+            for(size_t i = 0; i < ndim; i++) d[i] = -g[i]/norm;
+            slope = dot(g, d);
+            if( !(slope < 0) ) break;
+        }
+
+        // Backtracking line search
+        double step = 1;
+        double f_new = numeric_limits<double>::max();
+        for(size_t ls = 0; ls < 30; ls++, step *= 0.5) {
+            for(size_t i = 0; i < ndim; i++) x_new[i] = x[i] + step*d[i];
+            f_new = local_search::gradient_evaluate(x_new, positions, model, data, selected, g_new);
+            if( f_new <= f + 1e-4*step*slope ) break;
+        }
+
+        ++iter;
+
+        if( !(f_new < f) ) {
+            ++stag;
+            s_hist.clear(); y_hist.clear(); rho_hist.clear();
+            continue;
+        }
+
+        if( f-f_new < 1e-12*fabs(f) ) ++stag;
+        else stag = 0;
+
+        // Update the curvature history
+        coord sv(ndim), yv(ndim);
+        for(size_t i = 0; i < ndim; i++) {
+            sv[i] = x_new[i]-x[i];
+            yv[i] = g_new[i]-g[i];
+        }
+        double sy = dot(sv, yv);
+        if( sy > 1e-16 ) {
+            s_hist.push_back(sv);
+            y_hist.push_back(yv);
+            rho_hist.push_back(1/sy);
+            if( s_hist.size() > LBFGS_MEMORY ) {
+                s_hist.pop_front(); y_hist.pop_front(); rho_hist.pop_front();
+            }
+        }
+
+        x = x_new;
+        g = g_new;
+        f = f_new;
+    }
+
+    // Function on the full dataset if we were using partial in local search
+    selected = vector<size_t>();
+    local_search::model_evaluate(x, positions, model, data, selected);
+
+    return model->get_fitness();
+}
+
+/**
+ * Levenberg-Marquardt on the MSE of the active parameters
+ * 
+ * - Gauss-Newton matrix and gradient are accumulated in one pass over the data with mse_grad()
+ * - Solve \f$(J^TJ + \lambda\,diag(J^TJ))\delta = -J^Tr\f$, accept improving steps and decrease \f$\lambda\f$, otherwise increase it
+ * - Stops after NELDER_MEAD_MOVES iterations or NELDER_MEAD_STALE iterations without meaningful improvement
+ * 
+ * The search minimises the MSE with analytic gradients, the returned fitness is from the model objective
+ * 
+ * @param model Model to optimise
+ * @return double
+ * 
+ */
+template <class U>
+double local_search::levenberg_marquardt(U* model, DataSet* data, vector<size_t>& selected) {
+
+    PROFILE_SCOPE("levenberg_marquardt");
+
+    using coord = vector<double>;
+
+    vector<size_t> positions = model->get_active_positions();
+    vector<size_t> none;
+    size_t ndim = positions.size();
+
+    coord x(ndim), x_new(ndim), g(ndim), jtj(ndim*ndim), unused;
+    for (size_t i = 0; i < ndim; ++i)
+        x[i] = model->get_value(positions[i]);
+
+    double f = local_search::gradient_evaluate(x, positions, model, data, selected, g, &jtj);
+    double lambda = 1e-3;
+
+    size_t iter = 0;
+    size_t stag = 0;
+
+    while ( ndim > 0 && 
+            f != numeric_limits<double>::max() &&
+            iter < local_search::max_moves() &&
+            stag < meme::NELDER_MEAD_STALE &&
+            lambda < 1e12
+        ) {
+
+        ++iter;
+
+        // Damped normal equations, grad = 2 J^T r / W and jtj = J^T J / W
+        Eigen::Map<Eigen::MatrixXd> JtJ(jtj.data(), ndim, ndim);
+        Eigen::Map<Eigen::VectorXd> grad(g.data(), ndim);
+        Eigen::MatrixXd A = JtJ;
+        for(size_t i = 0; i < ndim; i++)
+            A(i,i) += lambda*max(JtJ(i,i), 1e-12);
+        Eigen::VectorXd delta = A.ldlt().solve(-0.5*grad);
+
+        if( !delta.allFinite() ) {
+            lambda *= 10;
+            ++stag;
+            continue;
+        }
+
+        // Value only for the trial step
+        for(size_t i = 0; i < ndim; i++) {
+            model->set_value(positions[i], x[i] + delta(i));
+            x_new[i] = model->get_value(positions[i]);
+        }
+        double f_new = objective::mse_grad(model, data, selected, none, unused);
+
+        if( !(f_new < f) ) {
+            lambda *= 10;
+            ++stag;
+            continue;
+        }
+
+        if( f-f_new < 1e-12*fabs(f) ) ++stag;
+        else stag = 0;
+
+        x = x_new;
+        lambda = max(lambda/10, 1e-12);
+        f = local_search::gradient_evaluate(x, positions, model, data, selected, g, &jtj);
+    }
+
+    // Function on the full dataset if we were using partial in local search
+    selected = vector<size_t>();
+    local_search::model_evaluate(x, positions, model, data, selected);
+
+    return model->get_fitness();
+}
+
 /**
  * Perform an operation on a vector
  * 
@@ -15,15 +15,43 @@
 #include <memetico/model_base/model_meme.h>
 #include <memetico/gpu/cuda.cuh>
 #include <memetico/globals.h>
+#include <memetico/optimise/jit.h>
 #include "finitediff_templated.hpp"
 
 namespace objective {
 
+/** 
+ * @brief Bound on the relative error of each float prediction as a multiple of the float unit roundoff \f$u=2^{-24}\f$
+ * Covers the rounding of the dot products and Lentz steps of fractions within the CFEval table limits, with headroom
+ * for moderate conditioning. Severely ill-conditioned fractions can exceed it, which only affects which candidates
+ * mixed precision re-scores, never the value of a re-scored fitness.
+ */
+const double MIXED_ERROR_FACTOR = 64;
+
+/** @brief Fitness at or below which mixed precision results are re-scored in double, infinite (i.e. no screening) outside a ScreenScope */
+inline thread_local double screen_threshold = numeric_limits<double>::infinity();
+
+/** @brief Set screen_threshold for the life of the scope, e.g. to the starting fitness of a local search */
+struct ScreenScope {
+    double previous;
+    ScreenScope(double threshold) : previous(screen_threshold) { screen_threshold = threshold; };
+    ~ScreenScope() { screen_threshold = previous; };
+};
+
 // See Implementation for details
 
 template <class U>
 double mse(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected = vector<size_t>());
 
+template <class U>
+double mse_float(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected, double& bound);
+
+template <class U>
+double mse_compiled(MemeticModel<U>* model, jit::jit_fn fn, vector<double>& c, DataSet* train, vector<size_t>& selected);
+
+template <class U>
+double mse_grad(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected, vector<size_t>& positions, vector<double>& grad, vector<double>* jtj = nullptr);
+
 template <class U>
 double mse_der(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected = vector<size_t>());
 
@@ -54,6 +82,9 @@ double s_cor(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected =
 template <class U>
 vector<vector<double>> fornberg(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected = vector<size_t>());
 
+template <class U>
+void fornberg(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected, vector<vector<double>>& Y);
+
 template <class U>
 vector<vector<double>> fornberg2(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected = vector<size_t>());
 
@@ -233,6 +233,123 @@ TEST_CASE("Objective: mse on CPU") {
     double res = objective::mse<DataType>(&f1, &ds, all);
     REQUIRE( abs(res-6845.240365625) < 0.0000001 );
 
+    // Selected samples are averaged over the selection, as a fold of cross validation
+    vector<size_t> some = {1, 5, 9, 20};
+    double sum = 0;
+    for(size_t i : some) {
+        double r = f1.evaluate(ds.samples[i])-ds.y[i];
+        sum += r*r;
+    }
+    objective::mse<DataType>(&f1, &ds, some);
+    CHECK( f1.get_error() == doctest::Approx(sum/some.size()) );
+
+    // Delete the file
+    remove(fn.c_str());
+
+}
+
+TEST_CASE("Objective: nmse on CPU") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    DataSet::IVS.clear();
+
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet ds = DataSet(fn);
+    ds.load();
+
+    ModelType::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    ModelType f1 = small_frac();
+
+    // Selecting every sample matches using all data
+    vector<size_t> all;
+    vector<size_t> every;
+    for(size_t i = 0; i < ds.get_count(); i++)
+        every.push_back(i);
+    objective::nmse<DataType>(&f1, &ds, all);
+    double error = f1.get_error();
+    objective::nmse<DataType>(&f1, &ds, every);
+    CHECK( f1.get_error() == doctest::Approx(error) );
+
+    // Selected samples give the mse over the sample variance of the selection
+    vector<size_t> some = {1, 5, 9, 20};
+    double sum = 0, mean = 0, var = 0;
+    for(size_t i : some) {
+        double r = f1.evaluate(ds.samples[i])-ds.y[i];
+        sum += r*r;
+        mean += ds.y[i]/some.size();
+    }
+    for(size_t i : some)
+        var += (ds.y[i]-mean)*(ds.y[i]-mean)/(some.size()-1);
+    objective::nmse<DataType>(&f1, &ds, some);
+    CHECK( f1.get_error() == doctest::Approx(sum/some.size()/var) );
+
+    // Delete the file
+    remove(fn.c_str());
+
+}
+
+TEST_CASE("Objective: mse in float and mixed precision") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    DataSet::IVS.clear();
+
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet ds = DataSet(fn);
+    ds.load();
+    REQUIRE( !ds.has_float() );
+    ds.setup_float();
+    REQUIRE( ds.has_float() );
+
+    ModelType::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    vector<size_t> all;
+    vector<size_t> some = {1, 5, 9, 20};
+    for(vector<size_t>* sel : {&all, &some}) {
+    for(size_t d = 0; d < 4; d++) {
+
+        ModelType f1 = ModelType(d);
+        double exact = objective::mse<DataType>(&f1, &ds, *sel);
+
+        // Float is within its bound of double
+        double bound;
+        objective::mse_float<DataType>(&f1, &ds, *sel, bound);
+        CHECK( fabs(f1.get_error() - exact) <= bound );
+
+        meme::PRECISION = meme::PrecisionFloat;
+        objective::mse<DataType>(&f1, &ds, *sel);
+        CHECK( fabs(f1.get_error() - exact) <= bound );
+
+        // Mixed is exact outside a screening scope or when the result may beat the threshold
+        meme::PRECISION = meme::PrecisionMixed;
+        CHECK( objective::mse<DataType>(&f1, &ds, *sel) == exact );
+        {
+            objective::ScreenScope screen(exact*2);
+            CHECK( objective::mse<DataType>(&f1, &ds, *sel) == exact );
+        }
+        {
+            objective::ScreenScope screen(exact/2);
+            CHECK( fabs(objective::mse<DataType>(&f1, &ds, *sel) - exact) <= bound );
+        }
+        CHECK( isinf(objective::screen_threshold) );
+        meme::PRECISION = meme::PrecisionDouble;
+    }
+    }
+
     // Delete the file
     remove(fn.c_str());
 
@@ -447,8 +564,8 @@ TEST_CASE("Objective: derivative ") {
 
         // ' weights
         for( size_t j = 0; j < 3; j++) {
-            if( ds.fd_weights[0][i].size() >= j+1 ) {
-                cout << ", " << ds.fd_weights[0][i][j];
+            if( ds.fd_stencils[0].width(i) >= j+1 ) {
+                cout << ", " << ds.fd_stencils[0].row(i)[j];
             } else {
                 cout << ",";
             }
@@ -456,8 +573,8 @@ TEST_CASE("Objective: derivative ") {
 
         // '' weights
         for( size_t j = 0; j < 5; j++) {
-            if( ds.fd_weights[1][i].size() >= j+1 ) {
-                cout << ", " << ds.fd_weights[1][i][j];
+            if( ds.fd_stencils[1].width(i) >= j+1 ) {
+                cout << ", " << ds.fd_stencils[1].row(i)[j];
             } else {
                 cout << ",";
             }
@@ -465,8 +582,8 @@ TEST_CASE("Objective: derivative ") {
 
         // ''' weights
         for( size_t j = 0; j < 7; j++) {
-            if( ds.fd_weights[2][i].size() >= j+1 ) {
-                cout << ", " << ds.fd_weights[2][i][j];
+            if( ds.fd_stencils[2].width(i) >= j+1 ) {
+                cout << ", " << ds.fd_stencils[2].row(i)[j];
             } else {
                 cout << ",";
             }
@@ -603,6 +720,54 @@ TEST_CASE("Objective: derivative ") {
 
 }
 
+TEST_CASE("Objective: fornberg ") {
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    DataSet::IVS.clear();
+
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet ds = DataSet(fn);
+    ds.load();
+    ds.compute_app_der(3);
+
+    ModelType::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    // f(x) = x - 20, so f' = 1 and higher derivatives vanish
+    ModelType f1 = small_frac();
+
+    // 1. 100% of samples
+    vector<size_t> all;
+    vector<vector<double>> res = objective::fornberg(&f1, &ds, all);
+    REQUIRE( res.size() == 4 );
+    for(size_t i = 0; i < ds.get_count(); i++) {
+        CHECK( res[0][i] == doctest::Approx(ds.samples[i][0]-20) );
+        CHECK( res[1][i] == doctest::Approx(1) );
+        CHECK( res[2][i] == doctest::Approx(0).epsilon(1e-6) );
+        CHECK( res[3][i] == doctest::Approx(0).epsilon(1e-6) );
+    }
+
+    // 2. Subsets, including the boundaries, match the corresponding rows
+    vector<size_t> selected = {0, 1, 2, 7, ds.get_count()-2, ds.get_count()-1};
+    vector<vector<double>> sub;
+    objective::fornberg(&f1, &ds, selected, sub);
+    REQUIRE( sub.size() == 4 );
+    for(size_t k = 0; k < sub.size(); k++) {
+        REQUIRE( sub[k].size() == selected.size() );
+        for(size_t j = 0; j < selected.size(); j++)
+            CHECK( sub[k][j] == doctest::Approx(res[k][selected[j]]) );
+    }
+
+    remove(fn.c_str());
+
+}
+
 TEST_CASE("Objective: mse_der ") {
 
     /* 
@@ -780,8 +945,8 @@ TEST_CASE("Objective: mse_der ") {
 
         // ' weights
         for( size_t j = 0; j < 3; j++) {
-            if( ds.fd_weights[0][i].size() >= j+1 ) {
-                cout << ", " << ds.fd_weights[0][i][j];
+            if( ds.fd_stencils[0].width(i) >= j+1 ) {
+                cout << ", " << ds.fd_stencils[0].row(i)[j];
             } else {
                 cout << ",";
             }
@@ -789,8 +954,8 @@ TEST_CASE("Objective: mse_der ") {
 
         // '' weights
         for( size_t j = 0; j < 5; j++) {
-            if( ds.fd_weights[1][i].size() >= j+1 ) {
-                cout << ", " << ds.fd_weights[1][i][j];
+            if( ds.fd_stencils[1].width(i) >= j+1 ) {
+                cout << ", " << ds.fd_stencils[1].row(i)[j];
             } else {
                 cout << ",";
             }
@@ -798,8 +963,8 @@ TEST_CASE("Objective: mse_der ") {
 
         // ''' weights
         for( size_t j = 0; j < 7; j++) {
-            if( ds.fd_weights[2][i].size() >= j+1 ) {
-                cout << ", " << ds.fd_weights[2][i][j];
+            if( ds.fd_stencils[2].width(i) >= j+1 ) {
+                cout << ", " << ds.fd_stencils[2].row(i)[j];
             } else {
                 cout << ",";
             }
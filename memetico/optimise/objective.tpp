@@ -13,23 +13,40 @@ using namespace meme;
  * 
  * @param model Model to evaluate
  * @param train DataSet to determine error on
- * @param selected subset of data to evaluate. Empty subset indicates usage of all data
+ * @param selected subset of data to evaluate. Empty subset indicates usage of all data. The error is averaged over the selection
  * @return double
  * 
  */
 template <class U>
 double objective::mse(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected ) {
 
-    auto start = chrono::system_clock::now();
+    PROFILE_SCOPE("objective: mse");
+
+    // Single precision, or mixed precision screening where only results that could beat the threshold are re-scored
+    if( !train->get_gpu() && meme::PRECISION != meme::PrecisionDouble && train->has_float() ) {
+        bool mixed = meme::PRECISION == meme::PrecisionMixed;
+        if( !mixed || isfinite(screen_threshold) ) {
+            double bound;
+            double fitness = mse_float(model, train, selected, bound);
+            if( !mixed || fitness - bound*model->get_penalty() > screen_threshold )
+                return fitness;
+        }
+    }
 
     if( !train->get_gpu() ) {
         try {
             double weight_sum = 0;
             double error_sum = 0;
             double error;
+
+            // Evaluate all samples at once, letting the model hoist per-model work out of the sample loop
+            static thread_local vector<double> preds;
+            model->evaluate_batch(train->samples, selected, preds);
+            size_t k = 0;
+
             if( selected.size() == 0) {
                 for(size_t i = 0; i < train->get_count(); i++) {
-                    error = model->evaluate(train->samples[i]);
+                    error = preds[i];
 		            //error = (error-train->y_min)/(train->y_max-train->y_min);
  
                     // Determine residual and square
@@ -49,7 +66,7 @@ double objective::mse(MemeticModel<U>* model, DataSet* train, vector<size_t>& se
                 else                model->set_error(error_sum / train->get_count());
             } else {
                 for(size_t i : selected) {
-                    error = model->evaluate(train->samples[i]);
+                    error = preds[k++];
 		            //error = (error-train->y_min)/(train->y_max-train->y_min);
                     
                     // Determine residual and square
@@ -66,7 +83,7 @@ double objective::mse(MemeticModel<U>* model, DataSet* train, vector<size_t>& se
                 }
                 // After the loop, use weight_sum to calculate the average error
                 if(weight_sum > 0)  model->set_error(error_sum / weight_sum);
-                else                model->set_error(error_sum / train->get_count());
+                else                model->set_error(error_sum / selected.size());
             }
             model->set_penalty( 1+model->get_count_active()*meme::PENALTY );
             model->set_fitness( multiply(model->get_error(),model->get_penalty()) );
@@ -80,12 +97,194 @@ double objective::mse(MemeticModel<U>* model, DataSet* train, vector<size_t>& se
         model->set_penalty( 1+model->get_count_active()*meme::PENALTY );
         model->set_fitness( multiply(model->get_error(),model->get_penalty()) );
     }
-    auto end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> ms = end-start;
     
     return model->get_fitness();
 }
 
+/**
+ * Mean Square Error evaluated in single precision
+ * 
+ * Predictions come from MemeticModel::evaluate_batch_float() over DataSet::columns_float, residuals and sums
+ * are formed in double. Each prediction p is taken to be within \f$\delta = ku|p|\f$ of its double value, for
+ * \f$k\f$ = MIXED_ERROR_FACTOR, so the computed MSE is within \f$\sum w(2|r|\delta+\delta^2)/\sum w\f$ of the
+ * double MSE, which is returned in bound. Sets the error, penalty and fitness as per mse().
+ * 
+ * @param model Model to evaluate
+ * @param train DataSet with columns_float, see DataSet::setup_float()
+ * @param selected subset of data to evaluate. Empty subset indicates usage of all data
+ * @param bound absolute bound on the error of the returned MSE
+ * @return fitness
+ * 
+ */
+template <class U>
+double objective::mse_float(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected, double& bound) {
+
+    PROFILE_SCOPE("objective: mse_float");
+
+    static thread_local vector<float> preds;
+    model->evaluate_batch_float(train->columns_float, train->get_count(), selected, preds);
+
+    const double ku = MIXED_ERROR_FACTOR*numeric_limits<float>::epsilon()/2;
+    double weight_sum = 0;
+    double error_sum = 0;
+    double bound_sum = 0;
+    for(size_t j = 0; j < preds.size(); j++) {
+
+        size_t i = selected.size() == 0 ? j : selected[j];
+        double w = train->has_weight() ? train->weight[i] : 1;
+        double r = preds[j] - train->y[i];
+        double delta = ku*fabs(preds[j]);
+
+        error_sum += w*r*r;
+        bound_sum += w*(2*fabs(r)*delta + delta*delta);
+        if(train->has_weight())
+            weight_sum += w;
+    }
+
+    // Divisor as per mse()
+    double divisor = weight_sum > 0 ? weight_sum : preds.size();
+    double mse = error_sum/divisor;
+    bound = bound_sum/divisor;
+
+    if( !isfinite(mse) ) {
+        bound = 0;
+        model->set_error(numeric_limits<double>::max());
+        model->set_penalty(numeric_limits<double>::max());
+        model->set_fitness(numeric_limits<double>::max());
+        return model->get_fitness();
+    }
+
+    model->set_error(mse);
+    model->set_penalty( 1+model->get_count_active()*meme::PENALTY );
+    model->set_fitness( multiply(model->get_error(),model->get_penalty()) );
+    return model->get_fitness();
+}
+
+/**
+ * Mean Square Error of a model compiled by jit::compile()
+ * 
+ * Sets the same error, penalty and fitness as mse() but evaluates each sample with the compiled
+ * program, so there is no virtual dispatch or safe-ops per sample. Non-finite errors give max.
+ * 
+ * @param model Model to set the error, penalty and fitness of
+ * @param fn compiled program for the structure of the model
+ * @param c coefficients of the model program, see jit::coefficients()
+ * @param train DataSet to determine error on
+ * @param selected subset of data to evaluate. Empty subset indicates usage of all data
+ * @return fitness
+ * 
+ */
+template <class U>
+double objective::mse_compiled(MemeticModel<U>* model, jit::jit_fn fn, vector<double>& c, DataSet* train, vector<size_t>& selected) {
+
+    PROFILE_SCOPE("objective: mse_compiled");
+
+    double weight_sum = 0;
+    double error_sum = 0;
+    size_t count = selected.size() == 0 ? train->get_count() : selected.size();
+    for(size_t j = 0; j < count; j++) {
+
+        size_t i = selected.size() == 0 ? j : selected[j];
+        double error = fn(c.data(), train->samples[i].data()) - train->y[i];
+        error = error*error;
+        if(train->has_weight()) {
+            error *= train->weight[i];
+            weight_sum += train->weight[i];
+        }
+        error_sum += error;
+    }
+
+    // Divisor as per mse()
+    double mse = weight_sum > 0 ? error_sum / weight_sum : error_sum / count;
+    if( !isfinite(mse) ) {
+        model->set_error(numeric_limits<double>::max());
+        model->set_penalty(numeric_limits<double>::max());
+        model->set_fitness(numeric_limits<double>::max());
+        return model->get_fitness();
+    }
+
+    model->set_error(mse);
+    model->set_penalty( 1+model->get_count_active()*meme::PENALTY );
+    model->set_fitness( multiply(model->get_error(),model->get_penalty()) );
+    return model->get_fitness();
+}
+
+/**
+ * Mean Square Error and its gradient with respect to the model parameters at positions
+ * 
+ * The gradient of each sample comes from MemeticModel::evaluate_grad() so the whole gradient 
+ * is formed in a single pass over the data. Optionally accumulates the Gauss-Newton matrix 
+ * \f$J^TWJ/\sum w\f$ for Levenberg-Marquardt, stored row-major in jtj. The model error, 
+ * penalty and fitness are not updated.
+ * 
+ * @param model Model to evaluate
+ * @param train DataSet to determine error on
+ * @param selected subset of data to evaluate. Empty subset indicates usage of all data
+ * @param positions parameter positions to differentiate against
+ * @param grad gradient of the MSE, resized to positions.size()
+ * @param jtj optional Gauss-Newton matrix output of positions.size()^2
+ * @return MSE, or max on numerical failure
+ * 
+ */
+template <class U>
+double objective::mse_grad(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected, vector<size_t>& positions, vector<double>& grad, vector<double>* jtj) {
+
+    PROFILE_SCOPE("objective: mse_grad");
+
+    size_t p = positions.size();
+    size_t count = selected.size() == 0 ? train->get_count() : selected.size();
+    vector<double> sample_grad(p);
+
+    grad.assign(p, 0);
+    if( jtj != nullptr )
+        jtj->assign(p*p, 0);
+
+    try {
+
+        double weight_sum = 0;
+        double error_sum = 0;
+
+        for(size_t j = 0; j < count; j++) {
+
+            size_t i = selected.size() == 0 ? j : selected[j];
+            double w = train->has_weight() ? train->weight[i] : 1;
+
+            // Residual and its gradient
+            double r = add(model->evaluate_grad(train->samples[i], positions, sample_grad), -train->y[i]);
+            error_sum = add(error_sum, multiply(w, multiply(r, r)));
+            weight_sum += w;
+
+            for(size_t a = 0; a < p; a++)
+                grad[a] += w*r*sample_grad[a];
+
+            if( jtj != nullptr )
+                for(size_t a = 0; a < p; a++)
+                    for(size_t b = 0; b <= a; b++)
+                        (*jtj)[a*p+b] += w*sample_grad[a]*sample_grad[b];
+        }
+
+        if( !isfinite(error_sum) )
+            throw invalid_argument("Non-finite error in mse_grad()");
+
+        // Scale to the mean and mirror the lower triangle
+        for(size_t a = 0; a < p; a++)
+            grad[a] *= 2/weight_sum;
+
+        if( jtj != nullptr )
+            for(size_t a = 0; a < p; a++)
+                for(size_t b = 0; b <= a; b++) {
+                    (*jtj)[a*p+b] /= weight_sum;
+                    (*jtj)[b*p+a] = (*jtj)[a*p+b];
+                }
+
+        return error_sum / weight_sum;
+
+    } catch (exception& e) {
+        grad.assign(p, 0);
+        return numeric_limits<double>::max();
+    }
+}
+
 /**
  * mse_der
  * 
@@ -93,17 +292,17 @@ double objective::mse(MemeticModel<U>* model, DataSet* train, vector<size_t>& se
 template <class U>
 double objective::mse_der(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected ) {
 
-    auto start = chrono::system_clock::now();
+    PROFILE_SCOPE("objective: mse_der");
     if( !train->get_gpu() ) {
 	
-	vector<vector<double>> Ypreds;
+	static thread_local vector<vector<double>> Ypreds;
 
 	try {
 	    double error_sum = 0;
 	    double error;
 	    int counter = 0;
 
-        if( meme::IN_DER == "app-fd" )  Ypreds = fornberg(model, train, selected);
+        if( meme::IN_DER == "app-fd" )  fornberg(model, train, selected, Ypreds);
         else                            Ypreds = derivative(model, train, selected);
 
 	    if( selected.size() == 0) {
@@ -160,8 +359,6 @@ double objective::mse_der(MemeticModel<U>* model, DataSet* train, vector<size_t>
 	model->set_penalty( 1+model->get_count_active()*meme::PENALTY );
 	model->set_fitness( multiply(model->get_error(),model->get_penalty()) );
     }
-    auto end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> ms = end-start;
     
     return model->get_fitness();
 }
@@ -169,7 +366,7 @@ double objective::mse_der(MemeticModel<U>* model, DataSet* train, vector<size_t>
 template <class U>
 double objective::mae(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected ) {
 
-    auto start = chrono::system_clock::now();
+    PROFILE_SCOPE("objective: mae");
 
     if( !train->get_gpu() ) {
 
@@ -177,12 +374,17 @@ double objective::mae(MemeticModel<U>* model, DataSet* train, vector<size_t>& se
 
             double error_sum = 0;
             double error;
+
+            // Evaluate all samples at once, letting the model hoist per-model work out of the sample loop
+            static thread_local vector<double> preds;
+            model->evaluate_batch(train->samples, selected, preds);
+            size_t k = 0;
         
             if( selected.size() == 0) {
                 
                 for(size_t i = 0; i < train->get_count(); i++) {
 
-                    double frac_val = model->evaluate(train->samples[i]);
+                    double frac_val = preds[i];
 
                     // Determine residual and square
                     error = add(frac_val, -train->y[i]);
@@ -203,7 +405,7 @@ double objective::mae(MemeticModel<U>* model, DataSet* train, vector<size_t>& se
 
                 for(size_t i : selected) {
 
-                    double frac_val = model->evaluate(train->samples[i]);
+                    double frac_val = preds[k++];
 
                     // Determine residual and square
                     error = add(frac_val, -train->y[i]);
@@ -239,9 +441,6 @@ double objective::mae(MemeticModel<U>* model, DataSet* train, vector<size_t>& se
         model->set_fitness( multiply(model->get_error(),model->get_penalty()) );
     }
     
-    auto end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> ms = end-start;
-    
     return model->get_fitness();
 
 }
@@ -249,7 +448,7 @@ double objective::mae(MemeticModel<U>* model, DataSet* train, vector<size_t>& se
 template <class U>
 double objective::mape(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected) {
 
-    auto start = chrono::system_clock::now();
+    PROFILE_SCOPE("objective: mape");
 
     if( !train->get_gpu() ) {
 
@@ -257,12 +456,17 @@ double objective::mape(MemeticModel<U>* model, DataSet* train, vector<size_t>& s
 
             double error_sum = 0;
             double error;
+
+            // Evaluate all samples at once, letting the model hoist per-model work out of the sample loop
+            static thread_local vector<double> preds;
+            model->evaluate_batch(train->samples, selected, preds);
+            size_t k = 0;
         
             if( selected.size() == 0) {
                 
                 for(size_t i = 0; i < train->get_count(); i++) {
 
-                    double pred_val = model->evaluate(train->samples[i]);
+                    double pred_val = preds[i];
 
                     // Calculate absolute percentage error
                     if (train->y[i] != 0) { // Avoid division by zero
@@ -286,7 +490,7 @@ double objective::mape(MemeticModel<U>* model, DataSet* train, vector<size_t>& s
 
                 for(size_t i : selected) {
 
-                    double pred_val = model->evaluate(train->samples[i]);
+                    double pred_val = preds[k++];
 
                     // Calculate absolute percentage error
                     if (train->y[i] != 0) {
@@ -324,9 +528,6 @@ double objective::mape(MemeticModel<U>* model, DataSet* train, vector<size_t>& s
 
     }
     
-    auto end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> ms = end-start;
-    
     return model->get_fitness();
 
 }
@@ -356,16 +557,14 @@ double objective::rmse(MemeticModel<U>* model, DataSet* train, vector<size_t>& s
 template <class U>
 double objective::cuda_error(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected, metric_t metric) {
 
-    // Convert CFR to Program
-    Program p;
-    TreeNode *tn_frac = new TreeNode();
-    model->get_node(tn_frac);
-    get_prefix(p.prefix, tn_frac);
+    // Emit the fused model program into a reused Program, keeping the buffer capacity between calls
+    static thread_local vector<Program> pop(1);
+    Program& p = pop[0];
+    p.prefix.clear();
+    model->get_fused_prefix(p.prefix);
     p.length = p.prefix.size();
 
     // Setup call to GPU Calculate Fitness
-    vector<Program> pop;
-    pop.push_back(p);
     int blockNum;
     
     if(selected.size() == 0) {
@@ -375,16 +574,14 @@ double objective::cuda_error(MemeticModel<U>* model, DataSet* train, vector<size
         blockNum = (selected.size() - 1) / THREAD_PER_BLOCK + 1;
 
 
-    double ret = cusr::calculateFitness(train->device_data, blockNum, pop, metric);
-    delete tn_frac;
-    return ret;
+    return cusr::calculateFitness(train->device_data, blockNum, pop, metric);
 
 }
 
 template <class U>
 double objective::p_cor(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected) {
 
-        auto start = chrono::system_clock::now();
+    PROFILE_SCOPE("objective: p_cor");
 
     try {
         double pearson_correlation;
@@ -488,9 +685,6 @@ double objective::p_cor(MemeticModel<U>* model, DataSet* train, vector<size_t>&
         model->set_fitness(1);
     }
 
-    auto end = chrono::high_resolution_clock::now();
-    chrono::duration<double, std::milli> ms = end - start;
-
     if (std::isnan(model->get_error())) {
         model->set_error(1);
         model->set_penalty(1);
@@ -504,7 +698,7 @@ double objective::p_cor(MemeticModel<U>* model, DataSet* train, vector<size_t>&
 template <class U>
 double objective::s_cor(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected) {
 
-    auto start = chrono::system_clock::now();
+    PROFILE_SCOPE("objective: s_cor");
 
     vector<double> x_values;
     vector<double> y_values;
@@ -565,9 +759,6 @@ double objective::s_cor(MemeticModel<U>* model, DataSet* train, vector<size_t>&
     model->set_penalty(1);
     model->set_fitness(1 - abs(spearman_correlation));
 
-    auto end = chrono::high_resolution_clock::now();
-    chrono::duration<double, milli> ms = end-start;
-
     return model->get_fitness();
 }
 
@@ -598,6 +789,8 @@ inline vector<double> objective::s_rank(vector<double>& data) {
 template <class U>
 double objective::nmse(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected ) {
 
+    PROFILE_SCOPE("objective: nmse");
+
     try {
 
         // Basic vars
@@ -674,15 +867,16 @@ double objective::nmse(MemeticModel<U>* model, DataSet* train, vector<size_t>& s
 
             }
 
-            mse = error_sum/train->get_count();
-            target_avg = target_sum/train->get_count();
+            mse = error_sum/selected.size();
+            target_avg = target_sum/selected.size();
 
             // Determine variance
             for(size_t i : selected) {               
                 variance_sample = add(train->y[i],-target_avg);
+                variance_sample = multiply(variance_sample,variance_sample);
                 variance_sum = add(variance_sum, variance_sample);
             }
-            variance = variance_sum/(train->get_count()-1);
+            variance = variance_sum/(selected.size()-1);
 
             model->set_error(mse/variance);
             model->set_penalty(1+model->get_count_active()*meme::PENALTY);
@@ -738,106 +932,20 @@ double objective::compare(MemeticModel<U>* m1, MemeticModel<U>* m2, DataSet* tra
 template <class U>
 vector<vector<double>> objective::derivative(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected) {
 
-    vector<vector<double>> Y{{}};
-
-    // 0th derviative
-    if(meme::MAX_DER_ORD==0) {
+    // Y[k] holds the k-th order derivative predictions, Y[0] the evaluation
+    vector<vector<double>> Y(meme::MAX_DER_ORD+1);
+    size_t count = selected.size() == 0 ? train->samples.size() : selected.size();
+    for(vector<double>& Yk : Y)
+        Yk.reserve(count);
 
-        vector<double> der_0_1;
-        Y.push_back({});
-        if( selected.size() == 0) {
+    // Single pass per sample computes all orders at once
+    vector<double> ders;
+    for(size_t j = 0; j < count; j++) {
 
-            for(size_t i = 0; i < train->samples.size(); i++) {
-                der_0_1 = model->evaluate_der(train->samples[i]);
-                Y[0].push_back(der_0_1[0]);
-                der_0_1.clear();
-            }
-        } else {
-
-            for(size_t i : selected) {
-                der_0_1 = model->evaluate_der(train->samples[i]);
-                Y[0].push_back(der_0_1[0]);
-                der_0_1.clear();		
-            }
-        }
-    }
-
-    // Exact derivative
-    // 0th and 1st order derivative
-    if(meme::MAX_DER_ORD==1) {
-
-        vector<double> der_0_1;
-        Y.push_back({});
-        if( selected.size() == 0) {
-
-            for(size_t i = 0; i < train->samples.size(); i++) {
-                der_0_1 = model->evaluate_der(train->samples[i]);
-                Y[0].push_back(der_0_1[0]);
-                Y[1].push_back(der_0_1[1]);
-                der_0_1.clear();
-            }
-        } else {
-
-            for(size_t i : selected) {
-                der_0_1 = model->evaluate_der(train->samples[i]);
-                Y[0].push_back(der_0_1[0]);
-                Y[1].push_back(der_0_1[1]);
-                der_0_1.clear();		
-            }
-        }
-    }
-
-    // 0th, 1st and 2nd order derivative
-    if(meme::MAX_DER_ORD==2) {
-
-        vector<double> ders;
-        Y.push_back({});
-        Y.push_back({});
-        if( selected.size() == 0) {
-            for(size_t i = 0; i < train->samples.size(); i++) {
-                ders = model->evaluate_der2(train->samples[i]);
-                Y[0].push_back(ders[0]);
-                Y[1].push_back(ders[1]);
-                Y[2].push_back(ders[2]);
-                ders.clear();
-            }
-        } else {
-            for(size_t i : selected) {
-                ders = model->evaluate_der2(train->samples[i]);
-                Y[0].push_back(ders[0]);
-                Y[1].push_back(ders[1]);
-                Y[2].push_back(ders[2]);
-                ders.clear();		
-            }
-        }
-    }
-
-    // 0th, 1st, 2nd and 3rd order derivative
-    if(meme::MAX_DER_ORD==3) {
-
-        vector<double> ders;
-        Y.push_back({});
-        Y.push_back({});
-        Y.push_back({});
-        if( selected.size() == 0) {
-            for(size_t i = 0; i < train->samples.size(); i++) {
-                ders = model->evaluate_der3(train->samples[i]);
-                Y[0].push_back(ders[0]);
-                Y[1].push_back(ders[1]);
-                Y[2].push_back(ders[2]);
-                Y[3].push_back(ders[3]);
-                ders.clear();
-            }
-        } else {
-            for(size_t i : selected) {
-                ders = model->evaluate_der3(train->samples[i]);
-                Y[0].push_back(ders[0]);
-                Y[1].push_back(ders[1]);
-                Y[2].push_back(ders[2]);
-                Y[3].push_back(ders[3]);
-                ders.clear();		
-            }
-        }
+        size_t i = selected.size() == 0 ? j : selected[j];
+        ders = model->evaluate_ders(train->samples[i], meme::MAX_DER_ORD);
+        for(size_t k = 0; k <= meme::MAX_DER_ORD; k++)
+            Y[k].push_back(ders[k]);
     }
 
     return Y;
@@ -846,287 +954,56 @@ vector<vector<double>> objective::derivative(MemeticModel<U>* model, DataSet* tr
 template <class U>
 vector<vector<double>> objective::fornberg(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected) {
     
-    vector<vector<double>> Y{{}};
-
-    // 100% training samples
-    if( selected.size() == 0) {
-        
-        // Store in first return the target value
-        for(size_t i = 0; i < train->samples.size(); i++)
-            Y[0].push_back(model->evaluate(train->samples[i]));
-
-        // Calculate the 1st order derivative given the predicted values from model
-        if(meme::MAX_DER_ORD>=1) {
-
-            Y.push_back({});
-            
-            // first interval samples[0], samples[1]
-            Y[1].push_back( train->fd_weights[0][0][0]*Y[0][0] + train->fd_weights[0][0][1]*Y[0][1] );
-            
-            // intermediate intervals samples[i-1], samples[i], samples[i+1]
-            for(size_t i = 1; i < Y[0].size()-1; i++)
-                Y[1].push_back( train->fd_weights[0][i][0]*Y[0][i-1] + train->fd_weights[0][i][1]*Y[0][i] + train->fd_weights[0][i][2]*Y[0][i+1] );
-            
-            // last interval samples[-2], samples[-1]
-            Y[1].push_back( train->fd_weights[0][Y[0].size()-1][0]*Y[0][Y[0].size()-2] + train->fd_weights[0][Y[0].size()-1][1]*Y[0][Y[0].size()-1] );
+    vector<vector<double>> Y;
+    fornberg(model, train, selected, Y);
+    return Y;
+}
 
-        }
-        
-        // Calculate the 2nd order derivative given the predicted values from model
-        if(meme::MAX_DER_ORD>=2) {
+template <class U>
+void objective::fornberg(MemeticModel<U>* model, DataSet* train, vector<size_t>& selected, vector<vector<double>>& Y) {
 
-            Y.push_back({});
+    size_t n = train->get_count();
+    size_t count = selected.size() == 0 ? n : selected.size();
+    size_t orders = min(meme::MAX_DER_ORD, train->fd_stencils.size());
 
-            // first interval samples[0], samples[1], samples[2]
-            Y[2].push_back( train->fd_weights[1][0][0]*Y[0][0] + train->fd_weights[1][0][1]*Y[0][1] + train->fd_weights[1][0][2]*Y[0][2] );
-            
-            // second interval samples[0], samples[1], samples[2], samples[3]
-            Y[2].push_back( train->fd_weights[1][1][0]*Y[0][0] + train->fd_weights[1][1][1]*Y[0][1] + train->fd_weights[1][1][2]*Y[0][2] + train->fd_weights[1][1][3]*Y[0][3] );
-            
-            // intermediate intervals samples[i-2], samples[i-1], samples[i], samples[i+1], samples[i+2]
-            for(size_t i = 2; i < Y[0].size()-2; i++)
-                Y[2].push_back( train->fd_weights[1][i][0]*Y[0][i-2] + train->fd_weights[1][i][1]*Y[0][i-1] + train->fd_weights[1][i][2]*Y[0][i] + train->fd_weights[1][i][3]*Y[0][i+1] + train->fd_weights[1][i][4]*Y[0][i+2] );
-            
-            // one before last interval samples[-4], samples[-3], samples[-2], samples[-1]
-            Y[2].push_back( train->fd_weights[1][Y[0].size()-2][0]*Y[0][Y[0].size()-4] + train->fd_weights[1][Y[0].size()-2][1]*Y[0][Y[0].size()-3] + train->fd_weights[1][Y[0].size()-2][2]*Y[0][Y[0].size()-2] + train->fd_weights[1][Y[0].size()-2][3]*Y[0][Y[0].size()-1] );
-            
-            // last interval samples[-3], samples[-2], samples[-1]
-            Y[2].push_back( train->fd_weights[1][Y[0].size()-1][0]*Y[0][Y[0].size()-3] + train->fd_weights[1][Y[0].size()-1][1]*Y[0][Y[0].size()-2] + train->fd_weights[1][Y[0].size()-1][2]*Y[0][Y[0].size()-1] );
-        }
+    // Model prediction for each sample, reused between calls
+    static thread_local vector<double> pred;
+    static thread_local vector<char> needed;
+    pred.resize(n);
 
-        // 3rd order derivative
-        if(meme::MAX_DER_ORD>=3) {
-
-            Y.push_back({});
-
-            // first interval samples[0], samples[1], samples[2], samples[3]
-            Y[3].push_back(
-                train->fd_weights[2][0][0]*Y[0][0]
-                + train->fd_weights[2][0][1]*Y[0][1]
-                + train->fd_weights[2][0][2]*Y[0][2]
-                + train->fd_weights[2][0][3]*Y[0][3] 
-            );
-
-            // second interval samples[0], samples[1], samples[2], samples[3], samples[4]
-            Y[3].push_back(
-                train->fd_weights[2][1][0]*Y[0][0]
-                + train->fd_weights[2][1][1]*Y[0][1]
-                + train->fd_weights[2][1][2]*Y[0][2]
-                + train->fd_weights[2][1][3]*Y[0][3]
-                + train->fd_weights[2][1][4]*Y[0][4] 
-            );
-
-            // third interval samples[0], samples[1], samples[2], samples[3], samples[4], samples[5]
-            Y[3].push_back(
-                train->fd_weights[2][2][0]*Y[0][0]
-                + train->fd_weights[2][2][1]*Y[0][1]
-                + train->fd_weights[2][2][2]*Y[0][2]
-                + train->fd_weights[2][2][3]*Y[0][3]
-                + train->fd_weights[2][2][4]*Y[0][4]
-                + train->fd_weights[2][2][5]*Y[0][5] 
-            );
-
-            // intermediate intervals samples[i-3], samples[i-2], samples[i-1], samples[i], samples[i+1], samples[i+2], samples[i+3]
-            for(size_t i = 3; i < Y[0].size()-3; i++) {
-                Y[3].push_back(
-                    train->fd_weights[2][i][0]*Y[0][i-3]
-                    + train->fd_weights[2][i][1]*Y[0][i-2]
-                    + train->fd_weights[2][i][2]*Y[0][i-1]
-                    + train->fd_weights[2][i][3]*Y[0][i]
-                    + train->fd_weights[2][i][4]*Y[0][i+1]
-                    + train->fd_weights[2][i][5]*Y[0][i+2]
-                    + train->fd_weights[2][i][6]*Y[0][i+3] 
-                );
-            }
+    if( selected.size() == 0 ) {
 
-            // two before last interval samples[-6], samples[-5], samples[-4], samples[-3], samples[-2], samples[-1]
-            Y[3].push_back(
-                train->fd_weights[2][Y[0].size()-3][0]*Y[0][Y[0].size()-6]
-                + train->fd_weights[2][Y[0].size()-3][1]*Y[0][Y[0].size()-5]
-                + train->fd_weights[2][Y[0].size()-3][2]*Y[0][Y[0].size()-4]
-                + train->fd_weights[2][Y[0].size()-3][3]*Y[0][Y[0].size()-3]
-                + train->fd_weights[2][Y[0].size()-3][4]*Y[0][Y[0].size()-2]
-                + train->fd_weights[2][Y[0].size()-3][5]*Y[0][Y[0].size()-1] 
-            );
-
-            // one before last interval samples[-5], samples[-4], samples[-3], samples[-2], samples[-1]
-            Y[3].push_back(
-                train->fd_weights[2][Y[0].size()-2][0]*Y[0][Y[0].size()-5]
-                + train->fd_weights[2][Y[0].size()-2][1]*Y[0][Y[0].size()-4]
-                + train->fd_weights[2][Y[0].size()-2][2]*Y[0][Y[0].size()-3]
-                + train->fd_weights[2][Y[0].size()-2][3]*Y[0][Y[0].size()-2]
-                + train->fd_weights[2][Y[0].size()-2][4]*Y[0][Y[0].size()-1] 
-            );
-
-            // last interval samples[-4], samples[-3], samples[-2], samples[-1]
-            Y[3].push_back(
-                train->fd_weights[2][Y[0].size()-1][0]*Y[0][Y[0].size()-4]
-                + train->fd_weights[2][Y[0].size()-1][1]*Y[0][Y[0].size()-3]
-                + train->fd_weights[2][Y[0].size()-1][2]*Y[0][Y[0].size()-2]
-                + train->fd_weights[2][Y[0].size()-1][3]*Y[0][Y[0].size()-1] 
-            );
-        }
+        for(size_t i = 0; i < n; i++)
+            pred[i] = model->evaluate(train->samples[i]);
 
-    } else { 
-        
-        // 20% training samples
-        
-        if(meme::MAX_DER_ORD>=1)    Y.push_back({});
-        if(meme::MAX_DER_ORD>=2)    Y.push_back({});
-        if(meme::MAX_DER_ORD>=3)    cout << "";
+    } else {
 
-        double ypred_after;
-        double ypred_before;
+        // Evaluate each sample within the band of a selected row exactly once
+        needed.assign(n, 0);
         for(size_t i : selected) {
-
-            // 0th order derivative
-            Y[0].push_back(model->evaluate(train->samples[i]));
-        
-            // 1st order derivative
-            if(meme::MAX_DER_ORD>=1) {
-                
-                // first interval samples[0], samples[1]
-                if(i==0) {
-                    ypred_after = model->evaluate(train->samples[1]);
-                    Y[1].push_back( train->fd_weights[0][0][0]*Y[0][Y[0].size()-1] + train->fd_weights[0][0][1]*ypred_after );
-                }
-
-                // last interval samples[-2], samples[-1]
-                if(i==train->samples.size()-1) {
-                    ypred_before = model->evaluate(train->samples[train->samples.size()-2]);
-                    Y[1].push_back( train->fd_weights[0][train->samples.size()-1][0]*ypred_before + train->fd_weights[0][train->samples.size()-1][1]*Y[0][Y[0].size()-1] );
-                }
-                
-                // intermediate intervals samples[i-1], samples[i], samples[i+1]
-                if(i>0 && i<train->samples.size()-1) {
-                    ypred_before = model->evaluate(train->samples[i-1]);
-                    ypred_after = model->evaluate(train->samples[i+1]);
-                    Y[1].push_back( train->fd_weights[0][i][0]*ypred_before + train->fd_weights[0][i][1]*Y[0][Y[0].size()-1] + train->fd_weights[0][i][2]*ypred_after );
-                }
+            needed[i] = 1;
+            for(size_t k = 0; k < orders; k++) {
+                const FDStencil& stencil = train->fd_stencils[k];
+                fill(needed.begin()+stencil.start[i], needed.begin()+stencil.start[i]+stencil.width(i), 1);
             }
-        
-            // 2nd order derivative
-            if(meme::MAX_DER_ORD>=2) {
-
-                double ypred_after_2;
-                double ypred_before_2;
-
-                // first interval samples[0], samples[1], samples[2]
-                if(i==0) {
-                    ypred_after = model->evaluate(train->samples[1]);
-                    ypred_after_2 = model->evaluate(train->samples[2]);
-                    Y[2].push_back( train->fd_weights[1][0][0]*Y[0][Y[0].size()-1] + train->fd_weights[1][0][1]*ypred_after + train->fd_weights[1][0][2]*ypred_after_2 );
-                }
-
-                // second interval samples[0], samples[1], samples[2], samples[3]
-                if(i==1) {
-                    ypred_before = model->evaluate(train->samples[0]);
-                    ypred_after = model->evaluate(train->samples[2]);
-                    ypred_after_2 = model->evaluate(train->samples[3]);
-                    Y[2].push_back( train->fd_weights[1][1][0]*ypred_before + train->fd_weights[1][1][1]*Y[0][Y[0].size()-1] + train->fd_weights[1][1][2]*ypred_after  + train->fd_weights[1][1][3]*ypred_after_2);
-                }
-                
-                // one before last interval samples[-4], samples[-3], samples[-2], samples[-1]
-                if(i==train->samples.size()-2) {
-                    ypred_before_2 = model->evaluate(train->samples[train->samples.size()-4]);
-                    ypred_before = model->evaluate(train->samples[train->samples.size()-3]);
-                    ypred_after = model->evaluate(train->samples[train->samples.size()-1]);
-                    Y[2].push_back( train->fd_weights[1][train->samples.size()-2][0]*ypred_before_2 + train->fd_weights[1][train->samples.size()-2][1]*ypred_before + train->fd_weights[1][train->samples.size()-2][2]*Y[0][Y[0].size()-1] + train->fd_weights[1][train->samples.size()-2][3]*ypred_after );
-                }
-
-                // last interval samples[-3], samples[-2], samples[-1]
-                if(i==train->samples.size()-1) {
-                    ypred_before_2 = model->evaluate(train->samples[train->samples.size()-3]);
-                    ypred_before = model->evaluate(train->samples[train->samples.size()-2]);
-                    Y[2].push_back( train->fd_weights[1][train->samples.size()-1][0]*ypred_before_2 + train->fd_weights[1][train->samples.size()-1][1]*ypred_before + train->fd_weights[1][train->samples.size()-1][2]*Y[0][Y[0].size()-1] );
-                }
-
-                // intermediate intervals
-                if(i>1 && i<train->samples.size()-2) {
-                    ypred_before_2 = model->evaluate(train->samples[i-2]);
-                    ypred_before = model->evaluate(train->samples[i-1]);
-                    ypred_after = model->evaluate(train->samples[i+1]);
-                    ypred_after_2 = model->evaluate(train->samples[i+2]);
-                    Y[2].push_back( train->fd_weights[1][i][0]*ypred_before_2 + train->fd_weights[1][i][1]*ypred_before + train->fd_weights[1][i][2]*Y[0][Y[0].size()-1] + train->fd_weights[1][i][3]*ypred_after + train->fd_weights[1][i][4]*ypred_after_2 );
-                }
-            }
-
-            // 3rd order derivative
-            if(meme::MAX_DER_ORD>=3) {
-                
-                double ypred_after_2;
-                double ypred_before_2;
-                double ypred_after_3;
-                double ypred_before_3;
-
-                // first interval samples[0], samples[1], samples[2], samples[3]
-                if(i==0) {
-                    ypred_after = model->evaluate(train->samples[1]);
-                    ypred_after_2 = model->evaluate(train->samples[2]);
-                    ypred_after_3 = model->evaluate(train->samples[3]);
-                    Y[3].push_back( train->fd_weights[2][0][0]*Y[0][Y[0].size()-1] + train->fd_weights[2][0][1]*ypred_after + train->fd_weights[2][0][2]*ypred_after_2 + train->fd_weights[2][0][3]*ypred_after_3 );
-                }
-
-                // second interval samples[0], samples[1], samples[2], samples[3], samples[4]
-                if(i==1) {
-                    ypred_before = model->evaluate(train->samples[0]);
-                    ypred_after = model->evaluate(train->samples[2]);
-                    ypred_after_2 = model->evaluate(train->samples[3]);
-                    ypred_after_3 = model->evaluate(train->samples[4]);
-                    Y[3].push_back( train->fd_weights[2][1][0]*ypred_before + train->fd_weights[2][1][1]*Y[0][Y[0].size()-1] + train->fd_weights[2][1][2]*ypred_after  + train->fd_weights[2][1][3]*ypred_after_2  + train->fd_weights[2][1][4]*ypred_after_3 );
-                }
-
-                // third interval  samples[0], samples[1], samples[2], samples[3], samples[4], samples[5]
-                if(i==2) {			
-                    ypred_before_2 = model->evaluate(train->samples[0]);
-                    ypred_before = model->evaluate(train->samples[1]);
-                    ypred_after = model->evaluate(train->samples[3]);
-                    ypred_after_2 = model->evaluate(train->samples[4]);
-                    ypred_after_3 = model->evaluate(train->samples[5]);
-                    Y[3].push_back( train->fd_weights[2][2][0]*ypred_before_2 + train->fd_weights[2][2][1]*ypred_before + train->fd_weights[2][2][2]*Y[0][Y[0].size()-1] + train->fd_weights[2][2][3]*ypred_after + train->fd_weights[2][2][4]*ypred_after_2 + train->fd_weights[2][2][5]*ypred_after_3 );
-                }
-                // two before last interval samples[-6], samples[-5], samples[-4], samples[-3], samples[-2], samples[-1]
-                    if(i==train->samples.size()-3) {
-                    ypred_before_3 = model->evaluate(train->samples[train->samples.size()-6]);
-                    ypred_before_2 = model->evaluate(train->samples[train->samples.size()-5]);
-                    ypred_before = model->evaluate(train->samples[train->samples.size()-4]);
-                    ypred_after = model->evaluate(train->samples[train->samples.size()-2]);
-                    ypred_after_2 = model->evaluate(train->samples[train->samples.size()-1]);
-                    Y[3].push_back( train->fd_weights[2][train->samples.size()-3][0]*ypred_before_3 + train->fd_weights[2][train->samples.size()-3][1]*ypred_before_2 + train->fd_weights[2][train->samples.size()-3][2]*ypred_before + train->fd_weights[2][train->samples.size()-3][3]*Y[0][Y[0].size()-1] + train->fd_weights[2][train->samples.size()-3][4]*ypred_after + train->fd_weights[2][train->samples.size()-3][5]*ypred_after_2 );
-                }
+        }
 
-                // one before last interval samples[-5], samples[-4], samples[-3], samples[-2], samples[-1]
-                if(i==train->samples.size()-2) {
-                    ypred_before_3 = model->evaluate(train->samples[train->samples.size()-5]);
-                    ypred_before_2 = model->evaluate(train->samples[train->samples.size()-4]);
-                    ypred_before = model->evaluate(train->samples[train->samples.size()-3]);
-                    ypred_after = model->evaluate(train->samples[train->samples.size()-1]);
-                    Y[3].push_back( train->fd_weights[2][train->samples.size()-2][0]*ypred_before_3 + train->fd_weights[2][train->samples.size()-2][1]*ypred_before_2 + train->fd_weights[2][train->samples.size()-2][2]*ypred_before + train->fd_weights[2][train->samples.size()-2][3]*Y[0][Y[0].size()-1] + train->fd_weights[2][train->samples.size()-2][4]*ypred_after );
-                }
+        for(size_t i = 0; i < n; i++)
+            if( needed[i] )
+                pred[i] = model->evaluate(train->samples[i]);
+    }
 
-                // last interval samples[-4], samples[-3], samples[-2], samples[-1]
-                if(i==train->samples.size()-1) {
-                    ypred_before_3 = model->evaluate(train->samples[train->samples.size()-4]);
-                    ypred_before_2 = model->evaluate(train->samples[train->samples.size()-3]);
-                    ypred_before = model->evaluate(train->samples[train->samples.size()-2]);
-                    Y[3].push_back( train->fd_weights[2][train->samples.size()-1][0]*ypred_before_3 + train->fd_weights[2][train->samples.size()-1][1]*ypred_before_2 + train->fd_weights[2][train->samples.size()-1][2]*ypred_before + train->fd_weights[2][train->samples.size()-1][3]*Y[0][Y[0].size()-1] );
-                }
+    // Row 0 is the prediction, row k the banded stencil of order k applied to the predictions
+    Y.resize(orders+1);
+    for(size_t k = 0; k <= orders; k++)
+        Y[k].resize(count);
 
-                // intermediate intervals
-                if(i>2 && i<train->samples.size()-3) {
-                    ypred_before_3 = model->evaluate(train->samples[i-3]);
-                    ypred_before_2 = model->evaluate(train->samples[i-2]);
-                    ypred_before = model->evaluate(train->samples[i-1]);
-                    ypred_after = model->evaluate(train->samples[i+1]);
-                    ypred_after_2 = model->evaluate(train->samples[i+2]);
-                    ypred_after_3 = model->evaluate(train->samples[i+3]);
-                    Y[3].push_back( train->fd_weights[2][i][0]*ypred_before_3 + train->fd_weights[2][i][1]*ypred_before_2 + train->fd_weights[2][i][2]*ypred_before + train->fd_weights[2][i][3]*Y[0][Y[0].size()-1] + train->fd_weights[2][i][4]*ypred_after + train->fd_weights[2][i][5]*ypred_after_2 + train->fd_weights[2][i][6]*ypred_after_3 );
-                }
-            }
-        }
+    for(size_t j = 0; j < count; j++) {
+        size_t i = selected.size() == 0 ? j : selected[j];
+        Y[0][j] = pred[i];
+        for(size_t k = 0; k < orders; k++)
+            Y[k+1][j] = train->fd_stencils[k].apply_row(i, pred.data());
     }
-	    
-    return Y;
 }
 
 template <class U>
@@ -0,0 +1,151 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Time budget aware allocation of local search effort, enabled with -sc
+ *
+ * - The cost of the evolve and stale phases and of a full effort local search phase are measured each generation
+ * - effort() is the fraction of full local search that lets the remaining generations finish within the budget
+ * - Effort is split evenly over the levers, local search runs, Nelder-Mead moves and the data sub-sample when one is used
+ * - Runs of a phase go to agents by their recent relative improvement per run, stagnant agents keep a single run
+ * - fits() is false when the next generation is predicted to overrun the budget, so the run stops between generations
+ *
+ */
+
+#ifndef MEMETICO_OPTIMISE_SCHEDULE_H_
+#define MEMETICO_OPTIMISE_SCHEDULE_H_
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+/** @brief Smallest fraction of full local search effort */
+#define SCHEDULE_MIN_EFFORT 0.05
+
+/** @brief Weight of the latest measurement in the moving averages */
+#define SCHEDULE_ALPHA 0.3
+
+/** @brief Share of the mean gain every agent is weighted with, so stagnant agents are still revisited */
+#define SCHEDULE_FLOOR 0.1
+
+namespace schedule {
+
+    class Scheduler {
+
+        public:
+
+            /**
+             * @brief Construct a Scheduler
+             * @param budget seconds available to the run
+             * @param agents number of agents, numbered as Agent::get_number()
+             * @param generations generations of the run
+             * @param interval local search runs on generations that are a multiple of interval
+             * @param runs local search runs per agent at full effort
+             */
+            Scheduler(double budget, size_t agents, size_t generations, size_t interval, size_t runs) :
+                budget(budget), generations(generations), interval(max(interval, (size_t) 1)), base_runs(runs),
+                gain(agents, 1), planned(agents, runs) {};
+
+            /** @brief Record \a seconds spent outside local search in a generation */
+            void fixed_cost(double seconds) {
+                fixed = fixed < 0 ? seconds : (1-SCHEDULE_ALPHA)*fixed + SCHEDULE_ALPHA*seconds;
+            }
+
+            /** @brief Record \a seconds spent in a local search phase that ran at \a at_effort */
+            void search_cost(double seconds, double at_effort) {
+                double full = seconds/max(at_effort, SCHEDULE_MIN_EFFORT);
+                search = search < 0 ? full : (1-SCHEDULE_ALPHA)*search + SCHEDULE_ALPHA*full;
+            }
+
+            /** @brief Return the fraction of full local search effort that fits the budget from generation \a gen at \a elapsed seconds */
+            double effort(size_t gen, double elapsed) {
+
+                if( fixed < 0 || search <= 0 || gen >= generations )
+                    return 1;
+
+                size_t gens_left = generations-gen;
+                size_t searches_left = (generations+interval-1)/interval - (gen+interval-1)/interval;
+                double allow = budget - elapsed - gens_left*fixed;
+                if( searches_left == 0 )
+                    return 1;
+
+                return min(1.0, max(SCHEDULE_MIN_EFFORT, allow/(searches_left*search)));
+            }
+
+            /** @brief Return true while generation \a gen, started at \a elapsed seconds, is predicted to finish within the budget */
+            bool fits(size_t gen, double elapsed) {
+
+                if( fixed < 0 )
+                    return true;
+
+                double cost = fixed;
+                if( gen % interval == 0 && search > 0 )
+                    cost += search*effort(gen, elapsed);
+
+                return elapsed + cost <= budget;
+            }
+
+            /**
+             * @brief Plan the runs of each agent for a local search phase at effort \a f
+             * @param levers number of effort levers in use, the share of each is f^(1/levers)
+             * @return share of effort for each lever
+             */
+            double plan(double f, size_t levers) {
+
+                double share = pow(f, 1.0/max(levers, (size_t) 1));
+                double total = max(1.0, base_runs*share)*gain.size();
+
+                double mean = 0;
+                for(double g : gain)
+                    mean += g/gain.size();
+
+                vector<double> w(gain.size());
+                double sum = 0;
+                for(size_t i = 0; i < gain.size(); i++) {
+                    w[i] = gain[i] + SCHEDULE_FLOOR*mean + 1e-12;
+                    sum += w[i];
+                }
+
+                for(size_t i = 0; i < gain.size(); i++)
+                    planned[i] = min(2*max(base_runs, (size_t) 1), max((size_t) 1, (size_t) llround(total*w[i]/sum)));
+
+                return share;
+            }
+
+            /** @brief Return the runs planned for agent \a number */
+            size_t runs(size_t number) { return planned[number]; }
+
+            /** @brief Record that agent \a number went from fitness \a before to \a after over \a n runs */
+            void record(size_t number, double before, double after, size_t n) {
+                double per_run = before > 0 && after < before && n > 0 ? (before-after)/before/n : 0;
+                gain[number] = (1-SCHEDULE_ALPHA)*gain[number] + SCHEDULE_ALPHA*per_run;
+            }
+
+        private:
+
+            double          budget;
+            size_t          generations;
+            size_t          interval;
+            size_t          base_runs;
+
+            /** Seconds per generation outside local search, negative until measured */
+            double          fixed = -1;
+
+            /** Seconds of a full effort local search phase, negative until measured */
+            double          search = -1;
+
+            /** Moving average of the relative improvement per run of each agent, optimistic until searched */
+            vector<double>  gain;
+
+            /** Runs of each agent in the current phase */
+            vector<size_t>  planned;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+
+#include "doctest.h"
+#include <memetico/optimise/schedule.h>
+
+TEST_CASE("Scheduler: effort, fits, plan") {
+
+    // 100 s for 10 generations of 4 agents, local search every generation with 4 runs
+    schedule::Scheduler s(100, 4, 10, 1, 4);
+
+    // 1. Full effort and default runs until costs are measured
+    CHECK( s.effort(0, 0) == 1 );
+    CHECK( s.fits(0, 99) );
+    CHECK( s.plan(1, 2) == 1 );
+    for(size_t i = 0; i < 4; i++)
+        CHECK( s.runs(i) == 4 );
+
+    // 2. Effort is the share of the remaining time after the fixed cost, 80 s for 9 searches of 10 s
+    s.fixed_cost(1);
+    s.search_cost(10, 1);
+    CHECK( s.effort(1, 11) == doctest::Approx(80.0/90) );
+    CHECK( s.effort(1, 0) == 1 );
+    CHECK( s.effort(9, 99.5) == SCHEDULE_MIN_EFFORT );
+
+    // 3. The last generation fits only when its reduced search does
+    CHECK( s.fits(9, 95) );
+    CHECK( !s.fits(9, 99.5) );
+
+    // 4. Runs move to the agent that improves, stagnant agents keep one
+    for(size_t k = 0; k < 10; k++) {
+        s.record(0, 1, 0.5, 4);
+        for(size_t i = 1; i < 4; i++)
+            s.record(i, 1, 1, 4);
+    }
+    s.plan(1, 2);
+    CHECK( s.runs(0) == 8 );
+    for(size_t i = 1; i < 4; i++) {
+        CHECK( s.runs(i) >= 1 );
+        CHECK( s.runs(i) < 4 );
+    }
+
+    // 5. Effort is shared between levers
+    CHECK( s.plan(0.25, 2) == doctest::Approx(0.5) );
+    CHECK( s.plan(0.125, 3) == doctest::Approx(0.5) );
+
+}
@@ -11,6 +11,7 @@
 // Local
 #include <memetico/data/data_set.h>
 #include <memetico/helpers/safe_ops.h>
+#include <memetico/helpers/profile.h>
 
 // Std lib
 #include <stdlib.h>
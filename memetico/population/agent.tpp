@@ -89,6 +89,8 @@ Agent<U>::~Agent() {
 template <class U>
 void Agent<U>::bubble() {
 
+    PROFILE_SCOPE("bubble");
+
     // Keep track of best
     double best_fitness = numeric_limits<double>::max();
     size_t best_child = 0;
@@ -123,6 +125,8 @@ void Agent<U>::bubble() {
 template <class U>
 void Agent<U>::exchange() {
 
+    PROFILE_SCOPE("exchange");
+
     U pocket = get_pocket();
     set_pocket(get_current());
     set_current(pocket);
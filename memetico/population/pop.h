@@ -12,8 +12,32 @@
 #include <memetico/globals.h>
 #include <memetico/optimise/objective.h>
 #include <memetico/optimise/local_search.h>
+#include <memetico/optimise/schedule.h>
 #include <memetico/population/agent.h>
+#include <memetico/population/shared_best.h>
+#include <memetico/helpers/binary.h>
+#include <memetico/helpers/telemetry.h>
+#include <memetico/helpers/profile.h>
+#include <memetico/helpers/task_pool.h>
 #include <chrono>
+#include <memory>
+#include <fstream>
+#include <cstdio>
+
+/** @brief Leading bytes of a Population checkpoint */
+#define CHECKPOINT_MAGIC 0x54504B434F4D454DULL
+
+/** @brief Checkpoint format version, incremented when the layout changes */
+#define CHECKPOINT_VERSION 2
+
+/** @brief Training samples a solution is evaluated on for its fingerprint in distinct() */
+#define FINGERPRINT_PROBES 64
+
+/** @brief Default zero-based depth of the Agent tree of a Population */
+#define POP_DEPTH 2
+
+/** @brief Default degree of the Agent tree of a Population */
+#define POP_DEGREE 3
 
 /**
  * @brief Types of Diversity Method
@@ -25,6 +49,58 @@ enum DiversityType {
     DiversityStaleExtended
 };
 
+/**
+ * @brief Thread local state of one run on the calling thread, from construction until destruction
+ * - Open before constructing the Population of a seed or fold, so a thread running several runs carries nothing between them
+ * - The mask history is swapped for an empty one, and POCKET_DEPTH, the depth range, GEN, RUN_TIME and NELDER_MEAD_SCALE
+ *   start from their defaults, MAX_DER_ORD from \a max_der_ord
+ * - The previous values are restored on destruction
+ */
+template <class U>
+class RunScope {
+
+    public:
+
+        RunScope(size_t max_der_ord) {
+            U::swap_history(history);
+            swap(meme::POCKET_DEPTH, pocket_depth);
+            swap(meme::DEPTH_LOW, depth_low);
+            swap(meme::DEPTH_HIGH, depth_high);
+            swap(meme::GEN, gen);
+            swap(meme::RUN_TIME, run_time);
+            swap(meme::NELDER_MEAD_SCALE, nelder_mead_scale);
+            previous_max_der_ord = meme::MAX_DER_ORD;
+            meme::MAX_DER_ORD = max_der_ord;
+        };
+
+        ~RunScope() {
+            U::swap_history(history);
+            swap(meme::POCKET_DEPTH, pocket_depth);
+            swap(meme::DEPTH_LOW, depth_low);
+            swap(meme::DEPTH_HIGH, depth_high);
+            swap(meme::GEN, gen);
+            swap(meme::RUN_TIME, run_time);
+            swap(meme::NELDER_MEAD_SCALE, nelder_mead_scale);
+            meme::MAX_DER_ORD = previous_max_der_ord;
+        };
+
+        RunScope(const RunScope&) = delete;
+        RunScope& operator=(const RunScope&) = delete;
+
+    private:
+
+        /** Defaults while the scope is open, the values of the calling thread before it afterwards */
+        typename U::History     history;
+        size_t                  pocket_depth = 1;
+        size_t                  depth_low = 0;
+        size_t                  depth_high = numeric_limits<size_t>::max();
+        size_t                  gen = 0;
+        long int                run_time = 0;
+        double                  nelder_mead_scale = 1;
+        size_t                  previous_max_der_ord;
+
+};
+
 /**
  * @brief The Population class manages a series of Agents through a linked-list-like structure
  * 
@@ -58,9 +134,18 @@ class Population {
         /** Dataset used for evolution */
         DataSet*        data;
 
-        /** Best known solution */
+        /** Best known solution, the copy of shared_best taken by sync_best() */
         U               best_soln;
 
+        /** Best known solution as read and improved by concurrently optimised agents */
+        SharedBest<U>   shared_best;
+
+        /** Lowest validation fitness of the solutions that have been best_soln, see set_validation() */
+        double          best_valid_fitness = numeric_limits<double>::max();
+
+        /** Generation best_valid_fitness was reached */
+        size_t          best_valid_gen = 0;
+
         /**
          * @brief Construct Population with a tree of meme::POP_DEPTH and degree meme::POP_DEGREE
          * - Create a tree of \f$ \frac{o^{d+1}-1}{o-1} \f$ Agents where o is the n-ary order, POP_DEGREE and d is the zero-based depth of the tree, POP_DEPTH
@@ -69,8 +154,9 @@ class Population {
          * - Print initial population
          * 
          * @param train_data dataset to evaluate the population
+         * @param train_view rows of \a train_data the population trains on, empty for all rows, e.g. the training rows of a fold
          */
-        Population(DataSet* train_data, size_t depth = 2, size_t degree = 3);
+        Population(DataSet* train_data, size_t depth = POP_DEPTH, size_t degree = POP_DEGREE, vector<size_t> train_view = vector<size_t>());
 
         ~Population() {
             delete root_agent;
@@ -88,6 +174,47 @@ class Population {
          */
         void run();
 
+        /** @brief Reset the stale counters and take the root pocket as the best solution, before the first generation */
+        void start();
+
+        /**
+         * @brief Run generation meme::GEN, evolve, local search after meme::LOCAL_SEARCH_INTERVAL and stale checks
+         * @param elapsed seconds of the run before the generation, used by the scheduler
+         */
+        void generation(double elapsed = 0);
+
+        /**
+         * @brief Offer \a soln from outside the population, e.g. promoted from a shallower depth stratum
+         * - \a soln is scored on the training view and local searched from its coefficients
+         * - It replaces the least fit current solution when it is fitter, then is exchanged and bubbled
+         * 
+         * @return true when \a soln entered the population
+         */
+        bool immigrate(U& soln);
+
+        /**
+         * @brief Write the full state of the run after generation meme::GEN to \a filename
+         * - Written to a temporary file and renamed over \a filename so a pre-empted job never leaves a partial checkpoint
+         * - Holds the generation, stale counters, best solution, every Agent pocket and current, the mutation policy
+         *   history and the state of all random number generators, so a restored run continues bit-exactly
+         *
+         * @param filename checkpoint path, see checkpoint_path()
+         * @param elapsed milliseconds the run has taken so far, counted against meme::MAX_TIME after restore
+         */
+        void checkpoint(string filename, long int elapsed);
+
+        /**
+         * @brief Restore the state written by checkpoint()
+         * - Throws runtime_error when the file is not a checkpoint or was written for different data or population shape
+         * 
+         * @param filename checkpoint path
+         * @return milliseconds the run had taken when the checkpoint was written
+         */
+        long int restore(string filename);
+
+        /** @brief Return the checkpoint path of the run, meme::LOG_DIR/<seed>.Checkpoint.bin */
+        static string checkpoint_path() { return meme::LOG_DIR+to_string(meme::SEED)+".Checkpoint.bin"; };
+
         /**
          * @brief Run local search on the population
          * - Detect what part of the Population to evolve from
@@ -127,6 +254,8 @@ class Population {
          *   - Set the Agents first child to the recombination of the Agents first childs pocket and the next childs current  
          *   - Continue the last recombination for the degree of the node (excluding the last child as it is was previously set)
          *   - Note that the parent was already recombined
+         * - With meme::EVOLVE_THREADS, the subtrees below the root are evolved as tasks of a work stealing pool before
+         *   the root, see evolve_subtrees()
          * 
          * @param agent the Agent to evolve recursively down the Population
          */
@@ -154,6 +283,9 @@ class Population {
         /** Return a list of 13 pockets, then 13 currents in a vector*/
         vector<U> to_soln_list();
 
+        /** @brief Return pointers to all pockets, then all currents, each in breadth first order as to_soln_list() */
+        vector<U*> to_soln_ptrs();
+
         /** 
          * Check and perform actions when the best solution has not changed for meme::STALE generations
          * @return indication that soln was stale
@@ -163,29 +295,72 @@ class Population {
 
         /**
          * Update the count number of most similar solutions
-         * - determine distance between all pocket and current solutions via objective::compare()
-         * - sort based on similarity
+         * - determine distance between all pocket and current solutions from their fingerprints
+         * - sort based on similarity, resolving equal distances near the cut off with objective::compare()
          * - for count number of solitions
          * -- replace the solution with the largest depth
          * -- if equal depth, replace the solution with the largest number of active params
          * -- if equal depth and equal params, replace uniform at random
          * 
          * @param count 
-         * @bug hard-coded for a ternary population of depth 3
          * @return 
          */
         void distinct(size_t count = 5);
 
+        /**
+         * @brief Return the squared residuals of \a soln on the probe samples, empty when evaluation fails
+         * - Cached on the solution and recomputed only when its coefficient_hash() changes
+         */
+        vector<double>& fingerprint(U& soln);
+
+        /** @brief Approximate objective::compare() from two fingerprints, scaled to the full data */
+        double fingerprint_distance(vector<double>& a, vector<double>& b);
+
         /** Agent node at the root of the population */
         Agent<U>*       root_agent = nullptr;
 
         static DiversityType DIVERSITY_TYPE;
 
+        /** @brief Make \a soln the best solution regardless of its fitness, from the thread running the population only */
         void set_best_soln(U& soln)     {
-            best_soln = U(soln);
-            POCKET_DEPTH = best_soln.get_depth();
+            if( soln.get_fitness() < shared_best.fitness() )
+                telemetry::count(telemetry::Improvements);
+            shared_best.reset(soln);
+            sync_best();
+        };
+
+        /** @brief Make \a soln the best solution when it is fitter, from any thread, returning true when it was */
+        bool publish_best(U& soln)      {
+            if( !shared_best.publish(soln) )
+                return false;
+            telemetry::count(telemetry::Improvements);
+            return true;
+        };
+
+        /**
+         * @brief Bring best_soln and POCKET_DEPTH up to date with shared_best, from the thread running the population only
+         * - Validates the new best solution when a validation set is tracked
+         */
+        void sync_best();
+
+        /**
+         * @brief Track the best solution on validation data, evaluated each time best_soln changes
+         * - run() stops once the validation fitness has not improved for meme::PATIENCE generations
+         * 
+         * @param valid_data validation dataset
+         * @param valid_rows rows of \a valid_data to validate on, empty for all rows
+         */
+        void set_validation(DataSet* valid_data, vector<size_t> valid_rows = vector<size_t>()) {
+            valid = valid_data;
+            valid_view = valid_rows;
         };
 
+        /** @brief Return if a validation set is tracked */
+        bool has_validation()           { return valid != nullptr; };
+
+        /** @brief Return the model of the run, the best on validation when it is tracked and best_soln otherwise */
+        U& result()                     { return best_valid ? *best_valid : best_soln; };
+
     private:
 
         /** Number of generations currently stale between 0 and meme::STALE */
@@ -194,6 +369,140 @@ class Population {
         /** Number of consecutive times stale_count has reached meme::STALE */
         size_t          stale_times;
 
+        /** Training samples evaluated for fingerprints, evenly spaced over the data */
+        vector<size_t>  probes;
+
+        /** Rows of data the population trains on, empty for all rows */
+        vector<size_t>  view;
+
+        /** Validation dataset, nullptr when not tracked */
+        DataSet*        valid = nullptr;
+
+        /** Rows of valid to validate on, empty for all rows */
+        vector<size_t>  valid_view;
+
+        /** Best solution on validation, created on the first validation so construction draws no random numbers */
+        unique_ptr<U>   best_valid;
+
+        /** SharedBest::version() of best_soln */
+        uint64_t        synced_version = 0;
+
+        /** coefficient_hash() of the last solution validated */
+        size_t          valid_key = 0;
+
+        /** @brief Evaluate best_soln on the validation data unless it was the last solution evaluated */
+        void            validate();
+
+        /** Telemetry counters of this population's run, counted into only while a telemetry log is written */
+        telemetry::Counters counters;
+
+        /** Local search effort allocation of a run with meme::SCHEDULE, nullptr otherwise */
+        unique_ptr<schedule::Scheduler> sched;
+
+        /** Share of full effort given to each local search lever in the current phase */
+        double          search_share = 1;
+
+        /**
+         * @brief A subtree below the root evolved as a task, with the thread locals its evolution reads and writes
+         * - Random streams are split from those of the population thread by the agent number of the subtree root
+         * - The mask history is the subtree's own, carried between generations
+         * - The best solution found by local search is kept here and published after the join, in subtree order
+         */
+        struct Subtree {
+            Agent<U>*               root;
+            RandInt                 ri;
+            RandReal                rr;
+            RandInt                 meme_ri;
+            RandReal                meme_rr;
+            typename U::History     history;
+
+            /** Values given to the thread running the task, exchanged by swap_globals() */
+            RandInt*                ri_ptr = nullptr;
+            RandReal*               rr_ptr = nullptr;
+            telemetry::Counters*    counters = nullptr;
+            size_t                  gen = 0;
+            size_t                  pocket_depth = 0;
+            size_t                  max_der_ord = 0;
+            size_t                  depth_low = 0;
+            size_t                  depth_high = 0;
+            double                  nelder_mead_scale = 1;
+            uint_fast32_t           seed = 0;
+
+            /** Fittest solution of the task's searches on the whole view when it beat the best solution at the fork */
+            unique_ptr<U>           best;
+            bool                    improved = false;
+
+            Subtree(Agent<U>* root, RandInt ri, RandReal rr, RandInt meme_ri, RandReal meme_rr)
+                : root(root), ri(move(ri)), rr(move(rr)), meme_ri(move(meme_ri)), meme_rr(move(meme_rr)) {};
+
+            /** @brief Exchange the thread locals of the calling thread with those held here, before and after the task */
+            void swap_globals() {
+                swap(RandInt::RANDINT, ri_ptr);
+                swap(RandReal::RANDREAL, rr_ptr);
+                swap(telemetry::current, counters);
+                swap(meme::RANDINT, meme_ri);
+                swap(meme::RANDREAL, meme_rr);
+                U::swap_history(history);
+                swap(meme::GEN, gen);
+                swap(meme::POCKET_DEPTH, pocket_depth);
+                swap(meme::MAX_DER_ORD, max_der_ord);
+                swap(meme::DEPTH_LOW, depth_low);
+                swap(meme::DEPTH_HIGH, depth_high);
+                swap(meme::NELDER_MEAD_SCALE, nelder_mead_scale);
+                swap(meme::SEED, seed);
+            };
+        };
+
+        /** Subtrees below the root when meme::EVOLVE_THREADS is set */
+        vector<Subtree>             subtrees;
+
+        /** Threads evolving the subtrees, nullptr to evolve on the population thread only */
+        unique_ptr<tasks::Pool>     pool;
+
+        /**
+         * @brief Evolve each subtree below the root as a task
+         * - Within a subtree the order of operations is that of evolve(), with bubbles limited to the subtree
+         * - A subtree only reads and writes its own agents and thread locals, so the result is the same for any
+         *   number of threads
+         */
+        void evolve_subtrees();
+
+        /** @brief Evolve \a agent and its descendants, children first, within \a task or on the population thread when nullptr */
+        void evolve_tree(Agent<U>* agent, Subtree* task);
+
+        /** @brief Mutate \a agent and recombine it with its children, the step of evolve() at one agent */
+        void evolve_agent(Agent<U>* agent, Subtree* task);
+
+        /** @brief Bubble fitter pockets up the subtree of \a agent, children before their parent as bubble() */
+        void bubble_subtree(Agent<U>* agent);
+
+        /** @brief local_search_single() within \a task, keeping an improved best solution in the task rather than publishing it */
+        void local_search_single(Agent<U> * agent, bool is_current, vector<size_t>& idx, Subtree* task);
+
+        /** @brief Return the agent under \a agent, inclusive, with the least fit current solution */
+        Agent<U>*       worst_current(Agent<U>* agent);
+
+        /** @brief Return the number of agents in the tree from \a agent */
+        size_t          agent_count(Agent<U>* agent);
+
+        /** @brief Return the number of rows the population trains on */
+        size_t          view_count()    { return view.empty() ? data->get_count() : view.size(); };
+
+        /** @brief Local search \a soln on rows \a idx, leaving its fitness on the training view */
+        void            search(U& soln, vector<size_t> idx);
+
+        /** @brief Return \a pct of the training view uniformly at random, as DataSet::subset() */
+        vector<size_t>  subset(double pct);
+
+        /** @brief Write the pocket and current of \a agent and its descendants in pre-order */
+        void write_agents(ostream& os, Agent<U>* agent);
+
+        /** @brief Read the members of \a agent and its descendants written by write_agents() */
+        void read_agents(istream& is, Agent<U>* agent);
+
+        /** @brief Add the depths of the pocket and current of \a agent and its descendants to \a bins */
+        void depth_histogram(Agent<U>* agent, uint32_t* bins);
+
 };
 
 template <class U>
@@ -6,9 +6,12 @@
 #include <memetico/optimise/objective.h>
 #include <memetico/optimise/local_search.h>
 #include <memetico/models/cont_frac.h>
+#include <memetico/models/cont_frac_dd.h>
+#include <memetico/population/strata.h>
 #include <memetico/models/regression.h>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <memetico/models/mutation.h>
 
 // Define the template strucutre of a model
@@ -222,10 +225,11 @@ TEST_CASE("Population: local_search, local_search_agents") {
         REQUIRE( p.root_agent->get_children()[2]->get_pocket().get_fitness() < p.root_agent->get_children()[2]->get_children()[2]->get_pocket().get_fitness() );
     }
 
-    // 2. 
+    // 2. Searching every agent can improve a child past its parent, so pockets are bubbled before the checks as in evolve()
     for(size_t i = 0; i < 20; i++) {
         double fitness = p.root_agent->get_pocket().get_fitness();
         p.local_search(p.root_agent);
+        p.bubble();
         REQUIRE(p.root_agent->get_pocket().get_fitness() <= fitness);
 
         // Ensure that local search results in  
@@ -339,6 +343,507 @@ TEST_CASE("Population: evolve") {
 
 }
 
+TEST_CASE("Population: checkpoint, restore") {
+
+    // Setup data
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet data = DataSet(fn);
+    data.load();
+    
+    ModelType::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE_NAME = "mse";
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<double>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
+
+    size_t generations = meme::GENERATIONS;
+    string log_dir = meme::LOG_DIR;
+    meme::LOG_DIR = "";
+
+    auto seed = [](uint64_t s, RandInt& ri, RandReal& rr) {
+        ri = RandInt(s);
+        rr = RandReal(s);
+        RandInt::RANDINT = &ri;
+        RandReal::RANDREAL = &rr;
+        meme::RANDINT = RandInt(s);
+        meme::RANDREAL = RandReal(s);
+    };
+    RandInt ri;
+    RandReal rr;
+
+    // 1. Uninterrupted run of 4 generations
+    seed(42, ri, rr);
+    meme::GENERATIONS = 4;
+    meme::CHECKPOINT = 0;
+    meme::RESUME = false;
+    Population<ModelType> full = Population<ModelType>(&data, 2, 3);
+    full.run();
+
+    // 2. Same run stopped after 2 generations with a checkpoint
+    seed(42, ri, rr);
+    meme::GENERATIONS = 2;
+    meme::CHECKPOINT = 2;
+    Population<ModelType> first = Population<ModelType>(&data, 2, 3);
+    first.run();
+    string ckpt = Population<ModelType>::checkpoint_path();
+    REQUIRE( ifstream(ckpt).good() );
+    CHECK( !ifstream(ckpt+".tmp").good() );
+
+    // 3. Resumed in a population built from another seed, the result is bit-exact
+    seed(7, ri, rr);
+    meme::GENERATIONS = 4;
+    meme::CHECKPOINT = 0;
+    meme::RESUME = true;
+    Population<ModelType> resumed = Population<ModelType>(&data, 2, 3);
+    resumed.run();
+    CHECK( resumed.best_soln.get_fitness() == full.best_soln.get_fitness() );
+    CHECK( resumed.best_soln.str() == full.best_soln.str() );
+    vector<ModelType> a = full.to_soln_list();
+    vector<ModelType> b = resumed.to_soln_list();
+    for(size_t i = 0; i < a.size(); i++) {
+        CHECK( a[i].get_fitness() == b[i].get_fitness() );
+        CHECK( a[i].str() == b[i].str() );
+    }
+
+    // 4. Checkpoints of another population shape are rejected
+    Population<ModelType> other = Population<ModelType>(&data, 1, 3);
+    CHECK_THROWS( other.restore(ckpt) );
+
+    remove(ckpt.c_str());
+    meme::RESUME = false;
+    meme::GENERATIONS = generations;
+    meme::LOG_DIR = log_dir;
+
+}
+
+TEST_CASE("Population: fingerprint, distinct") {
+
+    // Setup data
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet data = DataSet(fn);
+    data.load();
+    
+    ModelType::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE_NAME = "mse";
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<double>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    Population<ModelType> p = Population<ModelType>(&data, 2, 3);
+    vector<ModelType*> solns = p.to_soln_ptrs();
+    vector<ModelType> list = p.to_soln_list();
+    REQUIRE( solns.size() == list.size() );
+    for(size_t i = 0; i < solns.size(); i++)
+        CHECK( solns[i]->str() == list[i].str() );
+
+    // 1. Equal coefficients hash equally, any change is detected
+    ModelType a = *solns[0];
+    size_t pos = a.get_active_positions()[0];
+    CHECK( a.coefficient_hash() == solns[0]->coefficient_hash() );
+    a.set_value(pos, a.get_value(pos)+1);
+    CHECK( a.coefficient_hash() != solns[0]->coefficient_hash() );
+
+    // 2. With every sample probed the distance is objective::compare()
+    for(size_t i = 1; i < 6; i++) {
+        double expect = objective::compare(solns[0], solns[i], &data);
+        double dist = p.fingerprint_distance(p.fingerprint(*solns[0]), p.fingerprint(*solns[i]));
+        if( expect == numeric_limits<double>::max() )
+            CHECK( dist == expect );
+        else
+            CHECK( dist == doctest::Approx(expect).epsilon(1e-9) );
+    }
+    CHECK( p.fingerprint_distance(p.fingerprint(a), p.fingerprint(a)) == 0 );
+
+    // 3. Cached fingerprints follow changes to the solution
+    vector<double> before = p.fingerprint(a);
+    a.set_value(pos, a.get_value(pos)+1);
+    CHECK( p.fingerprint(a) != before );
+
+    // 4. A duplicated solution is among those replaced
+    *solns[1] = *solns[2];
+    p.distinct(0);
+    vector<ModelType> after = p.to_soln_list();
+    CHECK( after[1].str() != after[2].str() );
+
+}
+
+TEST_CASE("Population: validation, patience") {
+
+    // Setup data
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet data = DataSet(fn);
+    data.load();
+    
+    ModelType::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE_NAME = "mse";
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<double>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    size_t generations = meme::GENERATIONS;
+    string log_dir = meme::LOG_DIR;
+    meme::LOG_DIR = "";
+    meme::GENERATIONS = 50;
+    meme::PATIENCE = 2;
+
+    // Train on the even rows and validate on the odd rows
+    vector<size_t> even, odd;
+    for(size_t i = 0; i < data.get_count(); i++)
+        (i % 2 == 0 ? even : odd).push_back(i);
+
+    Population<ModelType> p = Population<ModelType>(&data, 2, 3, even);
+    CHECK( !p.has_validation() );
+    CHECK( &p.result() == &p.best_soln );
+    p.set_validation(&data, odd);
+    p.run();
+
+    // 1. Stopped PATIENCE generations after the best validation fitness
+    CHECK( p.has_validation() );
+    CHECK( meme::GEN == p.best_valid_gen+meme::PATIENCE );
+
+    // 2. The returned model has the best validation fitness, on the validation rows
+    ModelType best = p.result();
+    CHECK( best.objective(&data, odd) == p.best_valid_fitness );
+    ModelType last = p.best_soln;
+    CHECK( last.objective(&data, odd) >= p.best_valid_fitness );
+
+    meme::PATIENCE = 0;
+    meme::GENERATIONS = generations;
+    meme::LOG_DIR = log_dir;
+
+}
+
+TEST_CASE("Population: shared best") {
+
+    // Setup data
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet data = DataSet(fn);
+    data.load();
+    
+    ModelType::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE_NAME = "mse";
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    Population<ModelType> p = Population<ModelType>(&data, 2, 3);
+    vector<ModelType*> solns = p.to_soln_ptrs();
+    for(size_t i = 0; i < solns.size(); i++)
+        solns[i]->set_fitness(1000+((i+1)*7919 % solns.size()));
+
+    // 1. Concurrent publishers leave the fittest solution
+    p.set_best_soln(*solns[0]);
+    uint64_t version = p.shared_best.version();
+    vector<thread> workers;
+    for(size_t t = 0; t < 4; t++)
+        workers.emplace_back([&p, &solns, t]() {
+            RandInt wri = RandInt(t);
+            RandReal wrr = RandReal(t);
+            RandInt::RANDINT = &wri;
+            RandReal::RANDREAL = &wrr;
+            for(size_t i = t; i < solns.size(); i += 4)
+                p.publish_best(*solns[i]);
+        });
+    for(thread& w : workers)
+        w.join();
+
+    CHECK( p.shared_best.fitness() == 1000 );
+    CHECK( p.shared_best.version() > version );
+    CHECK( p.best_soln.get_fitness() == solns[0]->get_fitness() );
+
+    // 2. Worse solutions are not installed
+    ModelType worse = *solns[1];
+    worse.set_fitness(2000);
+    CHECK( !p.publish_best(worse) );
+
+    // 3. sync_best() copies the snapshot and its depth
+    p.sync_best();
+    CHECK( p.best_soln.get_fitness() == 1000 );
+    CHECK( meme::POCKET_DEPTH == p.best_soln.get_depth() );
+    p.shared_best.reclaim();
+    CHECK( p.shared_best.snapshot()->fitness == 1000 );
+
+}
+
+TEST_CASE("Population: parallel evolve") {
+
+    typedef ContinuedFractionDynamicDepth<Traits<TermType, DataType, mutation::MutateUniqueMask>> MaskModel;
+
+    // Setup data
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet data = DataSet(fn);
+    data.load();
+    
+    MaskModel::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        MaskModel::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE_NAME = "mse";
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<double>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
+    meme::DYNAMIC_DEPTH_TYPE = meme::DynamicRandom;
+
+    // Solutions of every agent and the best after evolving on the given number of threads, from the same mask history
+    stringstream history;
+    MaskModel::write_history(history);
+    auto run = [&data, &history](size_t threads) {
+        stringstream is(history.str());
+        MaskModel::read_history(is);
+        RandInt ri = RandInt(42);
+        RandReal rr = RandReal(42);
+        RandInt::RANDINT = &ri;
+        RandReal::RANDREAL = &rr;
+        meme::RANDINT = RandInt(42);
+        meme::RANDREAL = RandReal(42);
+        meme::EVOLVE_THREADS = threads;
+        Population<MaskModel> p(&data, 2, 3);
+        p.start();
+        for(size_t i = 0; i < 8; i++) {
+            double fitness = p.root_agent->get_pocket().get_fitness();
+            p.evolve();
+            REQUIRE( p.root_agent->get_pocket().get_fitness() <= fitness );
+            REQUIRE( p.best_soln.get_fitness() <= p.root_agent->get_pocket().get_fitness() );
+        }
+        meme::EVOLVE_THREADS = 0;
+
+        vector<string> solns;
+        for(MaskModel* m : p.to_soln_ptrs())
+            solns.push_back(m->str());
+        solns.push_back(p.best_soln.str());
+        return solns;
+    };
+
+    // 1. The same result for any number of threads
+    vector<string> one = run(1);
+    CHECK( run(2) == one );
+    CHECK( run(4) == one );
+
+    meme::DYNAMIC_DEPTH_TYPE = meme::DynamicNone;
+
+}
+
+TEST_CASE("Population: telemetry of concurrent runs") {
+
+    // Setup data
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet data = DataSet(fn);
+    data.load();
+    
+    ModelType::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        ModelType::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE_NAME = "mse";
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<double>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
+
+    size_t generations = meme::GENERATIONS;
+    string log_dir = meme::LOG_DIR;
+    meme::GENERATIONS = 10;
+    meme::TELEMETRY = "jsonl";
+
+    // Run a seed with the thread local globals of a batch run
+    auto run = [&data](uint_fast32_t seed) {
+        meme::SEED = seed;
+        meme::RANDINT = RandInt(seed);
+        meme::RANDREAL = RandReal(seed);
+        RandInt ri = RandInt(seed);
+        RandReal rr = RandReal(seed);
+        RandInt::RANDINT = &ri;
+        RandReal::RANDREAL = &rr;
+        Population<ModelType> p(&data, 2, 3);
+        p.run();
+    };
+
+    // Counters of each generation that do not depend on timing
+    auto counts = [](string filename) {
+        vector<string> ret;
+        ifstream in(filename);
+        string line;
+        while( getline(in, line) ) {
+            string fields;
+            for(string name : {"objective_calls", "cache_hits", "nm_iterations", "improvements"}) {
+                size_t at = line.find("\""+name+"\":");
+                REQUIRE( at != string::npos );
+                fields += line.substr(at, line.find(',', at)-at)+",";
+            }
+            ret.push_back(fields);
+        }
+        return ret;
+    };
+
+    meme::LOG_DIR = "/tmp/memetico_pop_solo.";
+    run(5);
+    vector<string> solo = counts(meme::LOG_DIR+"5.Telemetry.jsonl");
+    REQUIRE( solo.size() == meme::GENERATIONS );
+    CHECK( solo[0].find("\"objective_calls\":0,") == string::npos );
+
+    // 1. A run counts the same with another run in the process as alone
+    meme::LOG_DIR = "/tmp/memetico_pop_batch.";
+    thread other(run, 6);
+    run(5);
+    other.join();
+    CHECK( counts(meme::LOG_DIR+"5.Telemetry.jsonl") == solo );
+    CHECK( counts(meme::LOG_DIR+"6.Telemetry.jsonl").size() == meme::GENERATIONS );
+
+    meme::TELEMETRY = "";
+    meme::GENERATIONS = generations;
+    meme::LOG_DIR = log_dir;
+
+}
+
+TEST_CASE("Population: runs on one thread") {
+
+    typedef ContinuedFractionDynamicDepth<Traits<TermType, DataType, mutation::MutateUniqueMask>> MaskModel;
+
+    // Setup data
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet data = DataSet(fn);
+    data.load();
+
+    MaskModel::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        MaskModel::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE_NAME = "mse";
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<double>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
+
+    size_t generations = meme::GENERATIONS;
+    meme::GENERATIONS = 6;
+
+    // Run a seed as run_seed() does, returning the fitness of its result
+    auto run = [&data](uint_fast32_t seed) {
+        RunScope<MaskModel> scope(0);
+        meme::SEED = seed;
+        meme::RANDINT = RandInt(seed);
+        meme::RANDREAL = RandReal(seed);
+        RandInt ri = RandInt(seed);
+        RandReal rr = RandReal(seed);
+        RandInt::RANDINT = &ri;
+        RandReal::RANDREAL = &rr;
+        Population<MaskModel> p(&data, 2, 3);
+        p.run();
+        return p.result().get_fitness();
+    };
+
+    // 1. A seed run after other seeds on the same thread matches the seed run alone
+    double alone = 0, after = 0;
+    thread([&]() { alone = run(9); }).join();
+    thread([&]() {
+        run(3);
+        run(4);
+        after = run(9);
+    }).join();
+    CHECK( after == alone );
+
+    // 2. The thread locals of the calling thread are restored
+    meme::POCKET_DEPTH = 3;
+    meme::MAX_DER_ORD = 2;
+    run(9);
+    CHECK( meme::POCKET_DEPTH == 3 );
+    CHECK( meme::MAX_DER_ORD == 2 );
+    meme::POCKET_DEPTH = 1;
+    meme::MAX_DER_ORD = 3;
+
+    meme::GENERATIONS = generations;
+
+}
+
+TEST_CASE("Population: depth strata") {
+
+    typedef ContinuedFractionDynamicDepth<Traits<TermType, DataType, mutation::MutateHardSoft>> DepthModel;
+
+    // Setup data
+    string fn = "test_data.csv";
+    init(fn);
+    DataSet data = DataSet(fn);
+    data.load();
+    
+    DepthModel::IVS.clear();
+    for(size_t i = 0; i < DataSet::IVS.size(); i++)
+        DepthModel::IVS.push_back(DataSet::IVS[i]);
+
+    MemeticModel<DataType>::OBJECTIVE_NAME = "mse";
+    MemeticModel<DataType>::OBJECTIVE = objective::mse<DataType>;
+    MemeticModel<double>::LOCAL_SEARCH = local_search::custom_nelder_mead_redo<MemeticModel<double>>;
+
+    size_t generations = meme::GENERATIONS;
+    meme::GENERATIONS = 20;
+    meme::DYNAMIC_DEPTH_TYPE = meme::DynamicRandom;
+
+    auto run = [&data]() {
+        RandInt ri = RandInt(42);
+        RandReal rr = RandReal(42);
+        RandInt::RANDINT = &ri;
+        RandReal::RANDREAL = &rr;
+        Strata<DepthModel> s(&data, 2);
+        s.run();
+        return s.result().get_fitness();
+    };
+
+    RandInt ri = RandInt(42);
+    RandReal rr = RandReal(42);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+    CHECK_THROWS_AS( Strata<DepthModel>(&data, meme::DEPTH+2), invalid_argument );
+
+    // 1. Depths are split into contiguous ranges with budgets relative to the shallowest
+    Strata<DepthModel> s(&data, 2);
+    CHECK( s.low(0) == 0 );
+    CHECK( s.high(0) == 1 );
+    CHECK( s.low(1) == 2 );
+    CHECK( s.high(1) == meme::DEPTH );
+    CHECK( s.generations(0) == 20 );
+    CHECK( s.generations(1) == (size_t) llround(20*2.0/(2+meme::DEPTH+1)) );
+
+    // 2. Solutions are constructed within the range of their stratum
+    for(size_t i = 0; i < s.size(); i++)
+        for(DepthModel* m : s.population(i).to_soln_ptrs()) {
+            CHECK( m->get_depth() >= s.low(i) );
+            CHECK( m->get_depth() <= s.high(i) );
+        }
+
+    // 3. The result is the fittest of the strata and the run is reproducible
+    s.run();
+    for(size_t i = 0; i < s.size(); i++)
+        CHECK( s.result().get_fitness() <= s.population(i).best_soln.get_fitness() );
+    CHECK( run() == run() );
+
+    meme::DYNAMIC_DEPTH_TYPE = meme::DynamicNone;
+    meme::GENERATIONS = generations;
+
+}
+
 /*
 TEST_CASE("Population: run ") {
 
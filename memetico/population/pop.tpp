@@ -4,14 +4,23 @@
 */
 
 template <class U>
-Population<U>::Population(DataSet* train_data, size_t depth, size_t degree) {
+Population<U>::Population(DataSet* train_data, size_t depth, size_t degree, vector<size_t> train_view) {
 
-    Population<U>::DEPTH = depth;
-    Agent<U>::MAX_DEPTH = depth;
-    Agent<U>::DEGREE = degree;
+    // Shape is shared by concurrent populations of a batch, which all have the same shape so only the first writes
+    if( Population<U>::DEPTH != depth )     Population<U>::DEPTH = depth;
+    if( Agent<U>::MAX_DEPTH != depth )      Agent<U>::MAX_DEPTH = depth;
+    if( Agent<U>::DEGREE != degree )        Agent<U>::DEGREE = degree;
 
     // Set datasources
     data = train_data;
+    view = train_view;
+
+    // Fixed probe samples for fingerprints
+    size_t n = view_count();
+    for(size_t i = 0; i < min(n, (size_t) FINGERPRINT_PROBES); i++) {
+        size_t k = n <= FINGERPRINT_PROBES ? i : i*n/FINGERPRINT_PROBES;
+        probes.push_back(view.empty() ? k : view[k]);
+    }
 
     // Create root agent that continues to create all children for meme::POP_DEPTH
     root_agent = new Agent<U>();
@@ -25,6 +34,19 @@ Population<U>::Population(DataSet* train_data, size_t depth, size_t degree) {
     // Bubble better children up    
     for(size_t i = 0; i < Population<U>::DEPTH; i++)
         bubble();
+
+    // Subtrees evolved as tasks, each with random streams of its own
+    if( meme::EVOLVE_THREADS > 0 && !root_agent->is_leaf() ) {
+        pool = make_unique<tasks::Pool>(meme::EVOLVE_THREADS);
+        for(size_t i = 0; i < Agent<U>::DEGREE; i++) {
+            Agent<U>* child = root_agent->get_children()[i];
+            Subtree s(
+                child, RandInt::RANDINT->split(child->get_number()), RandReal::RANDREAL->split(child->get_number()),
+                meme::RANDINT.split(child->get_number()), meme::RANDREAL.split(child->get_number())
+            );
+            subtrees.push_back(move(s));
+        }
+    }
     
 }
 
@@ -39,60 +61,410 @@ void Population<U>::run() {
     auto start_time = chrono::system_clock::now();
 
     // Initialise population variables
-    stale_count = 0, stale_times = 0;      
-    set_best_soln(root_agent->get_pocket());
+    start();
+
+    // Continue from the last checkpoint, counting its time against MAX_TIME
+    size_t first_gen = 0;
+    string ckpt = checkpoint_path();
+    if( meme::RESUME && ifstream(ckpt).good() ) {
+        start_time -= chrono::milliseconds(restore(ckpt));
+        first_gen = meme::GEN+1;
+        cout << "Resuming from " << ckpt << " after generation " << meme::GEN << endl;
+    }
 
-    cout << "generation,best fitness,elapsed time,depth, best CFR model" << endl;
+    // Per generation telemetry, written off the evolution thread
+    unique_ptr<telemetry::Log> log;
+    if( meme::TELEMETRY != "" )
+        log = make_unique<telemetry::Log>(
+            meme::LOG_DIR+to_string(meme::SEED)+".Telemetry."+meme::TELEMETRY,
+            meme::TELEMETRY == "bin" ? telemetry::FormatBinary : telemetry::FormatJsonl
+        );
 
-    // Loop for generations
-    for( meme::GEN = 0; meme::GEN < meme::GENERATIONS; meme::GEN++ ) {
+    // Counters are this run's own, so runs sharing the process do not take each other's counts
+    telemetry::Scope counting(log ? &counters : nullptr);
+    telemetry::reset();
 
-        evolve();
+    // Local search effort adapted to the time left, measured from the same start as MAX_TIME
+    if( meme::SCHEDULE )
+        sched = make_unique<schedule::Scheduler>(MAX_TIME, agent_count(root_agent), meme::GENERATIONS, meme::LOCAL_SEARCH_INTERVAL, meme::LOCAL_SEARCH_RUNS);
 
-        // Local search after the indicated interval
-        if( meme::GEN % meme::LOCAL_SEARCH_INTERVAL == 0 )
-            local_search();
-        
-        // Run stale checks
-        stale();
+    if( meme::VERBOSE )
+        cout << "generation,best fitness,elapsed time,depth, best CFR model" << endl;
+
+    // Loop for generations
+    for( meme::GEN = first_gen; meme::GEN < meme::GENERATIONS; meme::GEN++ ) {
+
+        // Stop between generations rather than overrun the budget part way through one
+        auto gen_start = chrono::system_clock::now();
+        double gen_elapsed = chrono::duration<double>(gen_start-start_time).count();
+        if( sched && meme::GEN > first_gen && !sched->fits(meme::GEN, gen_elapsed) ) {
+            long int elapsed = chrono::duration_cast<chrono::milliseconds>(gen_start-start_time).count();
+            cout << "[pop.tpp] Generation " << GEN << " would exceed the maximum time (" << MAX_TIME << " s). Exiting after " << elapsed << " ms" << endl;
+            meme::GEN--;
+            if( meme::CHECKPOINT > 0 )
+                checkpoint(ckpt, elapsed);
+            break;
+        }
+
+        generation(gen_elapsed);
 
 	    // logging
         auto now_time = chrono::high_resolution_clock::now();
 	    chrono::duration<double, milli> runtime = now_time-start_time;
-	    cout << GEN << "," << best_soln.get_fitness() << "," << (runtime.count()/1000) << "," << meme::POCKET_DEPTH << "," << best_soln << endl;
+        if( log ) {
+            telemetry::Record r = {};
+            r.gen = meme::GEN;
+            r.best_fitness = best_soln.get_fitness();
+            r.elapsed = runtime.count()/1000;
+            r.best_depth = meme::POCKET_DEPTH;
+            telemetry::take(r);
+            depth_histogram(root_agent, r.depths);
+            log->push(r);
+        }
+        if( meme::VERBOSE )
+            cout << GEN << "," << best_soln.get_fitness() << "," << (runtime.count()/1000) << "," << meme::POCKET_DEPTH << "," << best_soln << "\n";
 
 	    // stopping criteria
         if( best_soln.get_fitness() < meme::EPSILON ) {
             cout << "[pop.tpp] early stopping convergence < " << meme::EPSILON << endl;
             break;
         }
+        if( valid != nullptr && meme::PATIENCE > 0 && meme::GEN-best_valid_gen >= meme::PATIENCE ) {
+            cout << "[pop.tpp] early stopping, validation fitness " << best_valid_fitness << " of generation " << best_valid_gen << " not improved for " << meme::PATIENCE << " generations" << endl;
+            break;
+        }
         auto end_time = chrono::system_clock::now();
-        if( MAX_TIME*1000 < chrono::duration_cast<chrono::milliseconds>(end_time-start_time).count() ) {
-            cout << "[pop.tpp] Maximum time (" << MAX_TIME << " s) reached on gen " << GEN << ". Exiting after " << chrono::duration_cast<chrono::milliseconds>(end_time-start_time).count() << " ms" << endl;
+        long int elapsed = chrono::duration_cast<chrono::milliseconds>(end_time-start_time).count();
+        if( MAX_TIME*1000 < elapsed ) {
+            if( meme::CHECKPOINT > 0 )
+                checkpoint(ckpt, elapsed);
+            cout << "[pop.tpp] Maximum time (" << MAX_TIME << " s) reached on gen " << GEN << ". Exiting after " << elapsed << " ms" << endl;
             break;
         }
 
+        // Periodic checkpoint
+        if( meme::CHECKPOINT > 0 && (meme::GEN+1) % meme::CHECKPOINT == 0 )
+            checkpoint(ckpt, elapsed);
+
+        // No thread holds a snapshot between generations
+        shared_best.reclaim();
+
     }
 
+    // Searches after the run, e.g. by tests, use the full effort
+    sched.reset();
+    search_share = 1;
+    meme::NELDER_MEAD_SCALE = 1;
+
     // End timer
     auto end_time = chrono::system_clock::now();
     meme::RUN_TIME = chrono::duration_cast<chrono::milliseconds>(end_time-start_time).count();
+
+    if( log ) {
+        log->close();
+        if( log->get_dropped() > 0 )
+            cout << "[pop.tpp] " << log->get_dropped() << " telemetry records dropped" << endl;
+    }
     
 }
 
+template <class U>
+void Population<U>::start() {
+
+    stale_count = 0, stale_times = 0;      
+    set_best_soln(root_agent->get_pocket());
+}
+
+template <class U>
+void Population<U>::generation(double elapsed) {
+
+    auto gen_start = chrono::system_clock::now();
+
+    {
+        telemetry::Timer timer(telemetry::EvolveNs);
+        evolve();
+    }
+
+    // Local search after the indicated interval
+    double search_s = 0, effort = 1;
+    if( meme::GEN % meme::LOCAL_SEARCH_INTERVAL == 0 ) {
+        telemetry::Timer timer(telemetry::LocalSearchNs);
+        auto search_start = chrono::system_clock::now();
+        if( sched ) {
+            effort = sched->effort(meme::GEN, elapsed+chrono::duration<double>(search_start-gen_start).count());
+            size_t levers = LOCAL_SEARCH_DATA_PCT > 0 && LOCAL_SEARCH_DATA_PCT < 1 ? 3 : 2;
+            search_share = sched->plan(effort, levers);
+            meme::NELDER_MEAD_SCALE = search_share;
+        }
+        local_search();
+        search_s = chrono::duration<double>(chrono::system_clock::now()-search_start).count();
+    }
+    
+    // Run stale checks
+    {
+        telemetry::Timer timer(telemetry::StaleNs);
+        stale();
+    }
+
+    if( sched ) {
+        double gen_s = chrono::duration<double>(chrono::system_clock::now()-gen_start).count();
+        sched->fixed_cost(gen_s-search_s);
+        if( meme::GEN % meme::LOCAL_SEARCH_INTERVAL == 0 )
+            sched->search_cost(search_s, effort);
+    }
+}
+
+template <class U>
+bool Population<U>::immigrate(U& soln) {
+
+    // Score on the training view, then search from the inherited coefficients
+    soln.objective(data, view);
+    search(soln, view);
+
+    Agent<U>* worst = worst_current(root_agent);
+    if( soln.get_fitness() >= worst->get_current().get_fitness() )
+        return false;
+
+    worst->set_current(soln);
+    exchange();
+    for(size_t i = 0; i < Population<U>::DEPTH; i++)
+        bubble();
+    return true;
+}
+
+template <class U>
+Agent<U>* Population<U>::worst_current(Agent<U>* agent) {
+
+    Agent<U>* worst = agent;
+    if( !agent->is_leaf() )
+        for(size_t i = 0; i < Agent<U>::DEGREE; i++) {
+            Agent<U>* w = worst_current(agent->get_children()[i]);
+            if( w->get_current().get_fitness() > worst->get_current().get_fitness() )
+                worst = w;
+        }
+    return worst;
+}
+
+template <class U>
+void Population<U>::checkpoint(string filename, long int elapsed) {
+
+    string tmp = filename+".tmp";
+    ofstream os(tmp, ios::binary | ios::trunc);
+    if( !os.is_open() )
+        throw runtime_error("Unable to open checkpoint "+tmp);
+
+    // Header to reject checkpoints of another run shape
+    binary::write(os, (uint64_t) CHECKPOINT_MAGIC);
+    binary::write(os, (uint64_t) CHECKPOINT_VERSION);
+    binary::write(os, (uint64_t) data->get_count());
+    binary::write(os, (uint64_t) DataSet::IVS.size());
+    binary::write(os, (uint64_t) Population<U>::DEPTH);
+    binary::write(os, (uint64_t) Agent<U>::DEGREE);
+
+    // Run progress
+    binary::write(os, (uint64_t) meme::GEN);
+    binary::write(os, (int64_t) elapsed);
+    binary::write(os, (uint64_t) stale_count);
+    binary::write(os, (uint64_t) stale_times);
+    binary::write(os, (uint64_t) meme::POCKET_DEPTH);
+
+    // Solutions and shared mutation history
+    best_soln.write(os);
+    binary::write(os, (uint8_t) (best_valid ? 1 : 0));
+    if( best_valid )
+        best_valid->write(os);
+    binary::write(os, best_valid_fitness);
+    binary::write(os, (uint64_t) best_valid_gen);
+    binary::write(os, (uint64_t) valid_key);
+    write_agents(os, root_agent);
+    U::write_history(os);
+
+    // Generators last, restore() may consume random numbers while constructing the solutions it reads into
+    RandInt::RANDINT->write(os);
+    RandReal::RANDREAL->write(os);
+    meme::RANDINT.write(os);
+    meme::RANDREAL.write(os);
+
+    os.close();
+    if( !os || rename(tmp.c_str(), filename.c_str()) != 0 )
+        throw runtime_error("Unable to write checkpoint "+filename);
+
+}
+
+template <class U>
+long int Population<U>::restore(string filename) {
+
+    ifstream is(filename, ios::binary);
+    if( !is.is_open() )
+        throw runtime_error("Unable to open checkpoint "+filename);
+
+    uint64_t magic, version, count, ivs, depth, degree;
+    binary::read(is, magic);
+    binary::read(is, version);
+    if( magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION )
+        throw runtime_error(filename+" is not a version "+to_string(CHECKPOINT_VERSION)+" checkpoint");
+
+    binary::read(is, count);
+    binary::read(is, ivs);
+    binary::read(is, depth);
+    binary::read(is, degree);
+    if( count != data->get_count() || ivs != DataSet::IVS.size() || depth != Population<U>::DEPTH || degree != Agent<U>::DEGREE )
+        throw runtime_error(filename+" was written for different data or population shape");
+
+    uint64_t gen, stale_c, stale_t, pocket_depth;
+    int64_t elapsed;
+    binary::read(is, gen);
+    binary::read(is, elapsed);
+    binary::read(is, stale_c);
+    binary::read(is, stale_t);
+    binary::read(is, pocket_depth);
+    meme::GEN = gen;
+    stale_count = stale_c;
+    stale_times = stale_t;
+
+    best_soln.read(is);
+    shared_best.reset(best_soln);
+    synced_version = shared_best.version();
+    uint8_t has_valid;
+    uint64_t valid_gen, key;
+    binary::read(is, has_valid);
+    best_valid.reset();
+    if( has_valid ) {
+        best_valid = make_unique<U>(best_soln);
+        best_valid->read(is);
+    }
+    binary::read(is, best_valid_fitness);
+    binary::read(is, valid_gen);
+    binary::read(is, key);
+    best_valid_gen = valid_gen;
+    valid_key = key;
+    read_agents(is, root_agent);
+    U::read_history(is);
+    meme::POCKET_DEPTH = pocket_depth;
+
+    RandInt::RANDINT->read(is);
+    RandReal::RANDREAL->read(is);
+    meme::RANDINT.read(is);
+    meme::RANDREAL.read(is);
+
+    return elapsed;
+
+}
+
+template <class U>
+void Population<U>::write_agents(ostream& os, Agent<U>* agent) {
+
+    agent->get_pocket().write(os);
+    agent->get_current().write(os);
+
+    if( agent->is_leaf() )
+        return;
+
+    for(size_t i = 0; i < Agent<U>::DEGREE; i++)
+        write_agents(os, agent->get_children()[i]);
+
+}
+
+template <class U>
+void Population<U>::read_agents(istream& is, Agent<U>* agent) {
+
+    agent->get_pocket().read(is);
+    agent->get_current().read(is);
+
+    if( agent->is_leaf() )
+        return;
+
+    for(size_t i = 0; i < Agent<U>::DEGREE; i++)
+        read_agents(is, agent->get_children()[i]);
+
+}
+
+template <class U>
+void Population<U>::depth_histogram(Agent<U>* agent, uint32_t* bins) {
+
+    bins[min(agent->get_pocket().get_depth(), (size_t) TELEMETRY_DEPTH_BINS-1)]++;
+    bins[min(agent->get_current().get_depth(), (size_t) TELEMETRY_DEPTH_BINS-1)]++;
+
+    if( agent->is_leaf() )
+        return;
+
+    for(size_t i = 0; i < Agent<U>::DEGREE; i++)
+        depth_histogram(agent->get_children()[i], bins);
+
+}
+
 template <class U>
 void Population<U>::evolve(Agent<U>* agent) {
     
     // Default to root if no argument
     if( agent == nullptr )        agent = root_agent;
 
+    // Subtrees below the root as tasks, then the root
+    if( pool && agent == root_agent ) {
+        evolve_subtrees();
+        evolve_agent(agent, nullptr);
+        return;
+    }
+
+    evolve_tree(agent, nullptr);
+}
+
+template <class U>
+void Population<U>::evolve_subtrees() {
+
+    tasks::Group group;
+    for(Subtree& s : subtrees) {
+
+        // Thread locals of the population thread, other than the random streams and history of the subtree
+        s.ri_ptr = &s.ri;
+        s.rr_ptr = &s.rr;
+        s.counters = telemetry::current;
+        s.gen = meme::GEN;
+        s.pocket_depth = meme::POCKET_DEPTH;
+        s.max_der_ord = meme::MAX_DER_ORD;
+        s.depth_low = meme::DEPTH_LOW;
+        s.depth_high = meme::DEPTH_HIGH;
+        s.nelder_mead_scale = meme::NELDER_MEAD_SCALE;
+        s.seed = meme::SEED;
+
+        pool->submit(group, [this, &s]() {
+
+            // The task runs on any thread of the pool, including this one while it waits
+            s.swap_globals();
+            try {
+                evolve_tree(s.root, &s);
+            } catch(...) {
+                s.swap_globals();
+                throw;
+            }
+            s.swap_globals();
+        });
+    }
+    pool->wait(group);
+
+    // Publish in subtree order, so ties resolve the same for any number of threads
+    for(Subtree& s : subtrees)
+        if( s.improved ) {
+            publish_best(*s.best);
+            s.improved = false;
+        }
+    sync_best();
+}
+
+template <class U>
+void Population<U>::evolve_tree(Agent<U>* agent, Subtree* task) {
+
     // Repeat the process for the children
     if( !agent->is_leaf() ) {
         for(size_t i = 0; i < Agent<U>::DEGREE; i++)
-            evolve(agent->get_children()[i]);
+            evolve_tree(agent->get_children()[i], task);
     }
 
-    vector<size_t> all;
+    evolve_agent(agent, task);
+}
+
+template <class U>
+void Population<U>::evolve_agent(Agent<U>* agent, Subtree* task) {
 
     // Mutate based on chance
     if( RandReal::RANDREAL->rand() < MUTATE_RATE ) {
@@ -100,13 +472,14 @@ void Population<U>::evolve(Agent<U>* agent) {
         agent->get_current().mutate(agent->get_pocket());
 
         // Perform search to refine mutated solution
-        local_search_single(agent, true, all);       
+        local_search_single(agent, true, view, task);       
 
         // Exchange and bubble if mutation results in better solution
         if(agent->get_current().get_fitness() < agent->get_pocket().get_fitness() ) {
             agent->exchange();
             for(size_t i = 0; i < Population<U>::DEPTH; i++)
-                bubble();
+                if( task )  bubble_subtree(task->root);
+                else        bubble();
         }
     }
         
@@ -122,14 +495,14 @@ void Population<U>::evolve(Agent<U>* agent) {
         &agent->get_pocket(), 
         &agent->get_children()[Agent<U>::DEGREE-1]->get_current()
     );
-    local_search_single(agent, true, all);
+    local_search_single(agent, true, view, task);
 
     // Recombination for parent and last child recombinations
     agent->get_children()[Agent<U>::DEGREE-1]->get_current().recombine(
         &agent->get_children()[Agent<U>::DEGREE-1]->get_pocket(), 
         &agent->get_current()
     );
-    local_search_single(agent->get_children()[Agent<U>::DEGREE-1], true, all);
+    local_search_single(agent->get_children()[Agent<U>::DEGREE-1], true, view, task);
 
     // Recombination for children
     for(int i = Agent<U>::DEGREE-2; i >= 0; i--) {
@@ -139,7 +512,7 @@ void Population<U>::evolve(Agent<U>* agent) {
             &agent->get_children()[i]->get_pocket(), 
             &agent->get_children()[i+1]->get_current()
         );
-        local_search_single(agent->get_children()[i], true, all);
+        local_search_single(agent->get_children()[i], true, view, task);
     }
 
     // As we exit on the root agent, re-align tree
@@ -150,6 +523,18 @@ void Population<U>::evolve(Agent<U>* agent) {
     }
 }
 
+template <class U>
+void Population<U>::bubble_subtree(Agent<U>* agent) {
+
+    if( agent->is_leaf() )
+        return;
+
+    for(size_t i = 0; i < Agent<U>::DEGREE; i++)
+        bubble_subtree(agent->get_children()[i]);
+
+    agent->bubble();
+}
+
 template <class U>
 void Population<U>::local_search(Agent<U>* agent) {
     
@@ -174,16 +559,22 @@ void Population<U>::local_search_agent(Agent<U>* agent) {
     U temp_current = U( agent->get_current() );
     U temp_pocket = U( agent->get_pocket() );
 
+    // Runs and sub-sample of the agent, planned by the scheduler when one is set
+    size_t runs = sched ? sched->runs(agent->get_number()) : LOCAL_SEARCH_RUNS;
+    double pct = LOCAL_SEARCH_DATA_PCT > 0 && LOCAL_SEARCH_DATA_PCT < 1 ? LOCAL_SEARCH_DATA_PCT*search_share : LOCAL_SEARCH_DATA_PCT;
+    double before = min(agent->get_current().get_fitness(), agent->get_pocket().get_fitness());
+    size_t done = 0;
+
     // Run LS for the number of configured times on the current solution
-    for(size_t j = 0; j < LOCAL_SEARCH_RUNS; j++ ) {
+    for(size_t j = 0; j < runs; j++ ) {
 
         // Generate a new subset of data to run LS on
-        vector<size_t> selected_idx;
-        if( LOCAL_SEARCH_DATA_PCT < 1 )
-            selected_idx = data->subset(LOCAL_SEARCH_DATA_PCT);
+        vector<size_t> selected_idx = view;
+        if( pct < 1 )
+            selected_idx = subset(pct);
 
-        temp_current.local_search(data,selected_idx);
-        //U::LOCAL_SEARCH(&temp_current, data, selected_idx);
+        search(temp_current, selected_idx);
+        done++;
 
     }
 
@@ -193,15 +584,16 @@ void Population<U>::local_search_agent(Agent<U>* agent) {
     // Allow pocket same opportunity to retain its position 
     if( agent->get_current().get_fitness() < agent->get_pocket().get_fitness() ) {
 
-        for(size_t j = 0; j < meme::LOCAL_SEARCH_RUNS; j++ ) {
+        for(size_t j = 0; j < runs; j++ ) {
 
             // Generate a new subset of data to run LS on
-            vector<size_t> selected_idx;
-            if( LOCAL_SEARCH_DATA_PCT < 1 )
-                selected_idx = data->subset(LOCAL_SEARCH_DATA_PCT);
+            vector<size_t> selected_idx = view;
+            if( pct < 1 )
+                selected_idx = subset(pct);
 
             // Search and update copy if fitter
-            U::LOCAL_SEARCH(&temp_pocket, data, selected_idx);
+            search(temp_pocket, selected_idx);
+            done++;
 
         }         
 
@@ -210,6 +602,9 @@ void Population<U>::local_search_agent(Agent<U>* agent) {
    
     }
 
+    if( sched )
+        sched->record(agent->get_number(), before, min(agent->get_current().get_fitness(), agent->get_pocket().get_fitness()), done);
+
     // If current is better, exchange and bubble
     if( agent->get_current().get_fitness() < agent->get_pocket().get_fitness() ) {
         exchange();
@@ -218,8 +613,80 @@ void Population<U>::local_search_agent(Agent<U>* agent) {
     }
 }
 
+template <class U>
+size_t Population<U>::agent_count(Agent<U>* agent) {
+
+    size_t n = 1;
+    if( !agent->is_leaf() )
+        for(size_t i = 0; i < Agent<U>::DEGREE; i++)
+            n += agent_count(agent->get_children()[i]);
+    return n;
+}
+
+template <class U>
+void Population<U>::sync_best() {
+
+    const typename SharedBest<U>::Snapshot* s = shared_best.snapshot();
+    if( s == nullptr || s->version == synced_version )
+        return;
+
+    synced_version = s->version;
+    // Assigned rather than copy constructed, construction draws random numbers for the mutation policy
+    best_soln = s->model;
+    POCKET_DEPTH = s->depth;
+    if( valid != nullptr )
+        validate();
+}
+
+template <class U>
+void Population<U>::validate() {
+
+    // best_soln is often set again unchanged, e.g. by stale(), so the last result is reused
+    size_t key = best_soln.coefficient_hash();
+    if( key != 0 && key == valid_key )
+        return;
+    valid_key = key;
+
+    U copy = U(best_soln);
+    double fitness = copy.objective(valid, valid_view);
+    if( fitness < best_valid_fitness ) {
+        best_valid = make_unique<U>(best_soln);
+        best_valid_fitness = fitness;
+        best_valid_gen = meme::GEN;
+    }
+}
+
+template <class U>
+void Population<U>::search(U& soln, vector<size_t> idx) {
+
+    soln.local_search(data, idx);
+
+    // Local search methods finish on all data, which includes the rows held out of the view
+    if( !view.empty() )
+        soln.objective(data, view);
+}
+
+template <class U>
+vector<size_t> Population<U>::subset(double pct) {
+
+    if( view.empty() )
+        return data->subset(pct);
+
+    vector<size_t> ret = RandInt::RANDINT->unique_set((size_t) (pct*view.size()), 0, view.size());
+    if( ret.empty() )
+        return view;
+    for(size_t& i : ret)
+        i = view[i];
+    return ret;
+}
+
 template <class U>
 void Population<U>::local_search_single(Agent<U> * agent, bool is_current, vector<size_t>& idx) {
+    local_search_single(agent, is_current, idx, nullptr);
+}
+
+template <class U>
+void Population<U>::local_search_single(Agent<U> * agent, bool is_current, vector<size_t>& idx, Subtree* task) {
 
     // Copy the solution that will be modified by LS
     // @bug When we try to use a pointer here I think LS is ineffective because the we have to delete
@@ -232,11 +699,19 @@ void Population<U>::local_search_single(Agent<U> * agent, bool is_current, vecto
     else                copy = U( agent->get_pocket() );
 
     // Run LS
-    copy.local_search(data, idx);
-
-     // Set best soln if 
-    if( idx.empty() && copy.get_fitness() < best_soln.get_fitness() )
-        set_best_soln(copy);
+    search(copy, idx);
+
+     // Set best soln if searched on the whole training view, a task keeps it until the join
+    if( idx.size() == view.size() ) {
+        if( task == nullptr ) {
+            if( publish_best(copy) )
+                sync_best();
+        } else if( copy.get_fitness() < (task->improved ? task->best->get_fitness() : shared_best.fitness()) ) {
+            if( task->best )    *task->best = copy;
+            else                task->best = make_unique<U>(copy);
+            task->improved = true;
+        }
+    }
 
     // Set current if fitness is better
     if( is_current && copy.get_fitness() < agent->get_current().get_fitness() ) {
@@ -254,6 +729,9 @@ void Population<U>::local_search_single(Agent<U> * agent, bool is_current, vecto
 
 template <class U>
 void Population<U>::bubble(Agent<U>* agent, size_t child_number) {
+
+    // Time the outer call only, recursion is within it
+    telemetry::Timer timer(telemetry::BubbleNs, agent == nullptr);
     
     // Move to the deepest and left-most parent
     if( agent == nullptr ) {
@@ -293,10 +771,8 @@ void Population<U>::evaluate(Agent<U>* agent) {
         agent = root_agent;
     
     // Evaluate the current agent
-    vector<size_t> all;
-
-    agent->get_pocket().objective(data, all);
-    agent->get_current().objective(data,all);
+    agent->get_pocket().objective(data, view);
+    agent->get_current().objective(data, view);
 
     if(agent->is_leaf())
         return;
@@ -317,8 +793,8 @@ void Population<U>::exchange(Agent<U>* agent) {
     // !!! So we shouldnt have to call objective here, however sometime the fitness is wrong
     // when we go to exchange, thus we have to re-run again. This forces it to work, but
     // there is somepoint where we change the fraction but do not evaluate the objective again
-    agent->get_current().objective(data);
-    agent->get_pocket().objective(data);
+    agent->get_current().objective(data, view);
+    agent->get_pocket().objective(data, view);
 
     // Only when current fitter than pocket, exchange
     if( agent->get_current().get_fitness() < agent->get_pocket().get_fitness() )
@@ -360,8 +836,7 @@ void Population<U>::stale() {
             // Reset the roots current
             cout << "\tResetting stale root " << endl;
             U replace = U();
-            vector<size_t> all;
-            replace.objective(data,all);
+            replace.objective(data, view);
             root_agent->set_current(replace);
             
         } else if (DIVERSITY_TYPE == DiversityStale)
@@ -423,22 +898,82 @@ vector<U> Population<U>::to_soln_list() {
     return ret;
 }
 
+template <class U>
+vector<U*> Population<U>::to_soln_ptrs() {
+
+    vector<Agent<U>*> agents = {root_agent};
+    for(size_t i = 0; i < agents.size(); i++)
+        if( !agents[i]->is_leaf() )
+            for(Agent<U>* child : agents[i]->get_children())
+                agents.push_back(child);
+
+    vector<U*> ret;
+    for(Agent<U>* a : agents)
+        ret.push_back(&a->get_pocket());
+    for(Agent<U>* a : agents)
+        ret.push_back(&a->get_current());
+    return ret;
+}
+
+template <class U>
+vector<double>& Population<U>::fingerprint(U& soln) {
+
+    // Key the cache on the data as well, solutions may be copied between populations
+    size_t key = hash_mix(soln.coefficient_hash() ^ (uint64_t) (uintptr_t) data);
+    if( soln.fingerprint_key == key && key != 0 )
+        return soln.fingerprint;
+
+    static thread_local vector<double> preds;
+    soln.fingerprint.resize(probes.size());
+    try {
+        soln.evaluate_batch(data->samples, probes, preds);
+        for(size_t k = 0; k < probes.size(); k++) {
+            double err = preds[k]-data->y[probes[k]];
+            soln.fingerprint[k] = err*err;
+            if( !isfinite(soln.fingerprint[k]) )
+                throw overflow_error("Non-finite fingerprint");
+        }
+    } catch (exception& e) {
+        soln.fingerprint.clear();
+    }
+
+    soln.fingerprint_key = key;
+    return soln.fingerprint;
+}
+
+template <class U>
+double Population<U>::fingerprint_distance(vector<double>& a, vector<double>& b) {
+
+    // As objective::compare(), failed evaluations are maximally distant
+    if( a.empty() || b.empty() )
+        return numeric_limits<double>::max();
+
+    double dist = 0;
+    for(size_t k = 0; k < a.size(); k++)
+        dist += fabs(a[k]-b[k]);
+
+    return dist*view_count()/a.size();
+}
+
 template <class U>
 void Population<U>::distinct(size_t count) {
 
-    // List of all solutions to compare (pockets and currents)
-    vector<U> agents = to_soln_list();
+    // All solutions to compare (pockets and currents), fingerprinted in place so the cache persists
+    vector<U*> solns = to_soln_ptrs();
+    vector<vector<double>*> prints;
+    for(U* s : solns)
+        prints.push_back(&fingerprint(*s));
 
     // Vector of results
     vector<Similar> vec;
 
     // Determine the distance for every pair of solutions 
-    for(size_t i = 0; i < agents.size(); i++) {
-        for(size_t j = i+1; j < agents.size(); j++) {
-            double dist = objective::compare(&agents.at(i), &agents.at(j), data);
+    for(size_t i = 0; i < solns.size(); i++) {
+        for(size_t j = i+1; j < solns.size(); j++) {
+            double dist = fingerprint_distance(*prints[i], *prints[j]);
             vec.push_back(
-                Similar(i, agents.at(i).get_depth(), agents.at(i).get_count_active(),
-                        j, agents.at(j).get_depth(), agents.at(j).get_count_active(),
+                Similar(i, solns[i]->get_depth(), solns[i]->get_count_active(),
+                        j, solns[j]->get_depth(), solns[j]->get_count_active(),
                         dist)
             );
 
@@ -448,6 +983,22 @@ void Population<U>::distinct(size_t count) {
     // Sort list by ascending similarity
     sort(vec.begin(), vec.end());
 
+    // Equal distances among those replaced are resolved on the full data
+    bool refined = false;
+    for(size_t i = 0; i < min(count+1, vec.size()); ) {
+        size_t j = i+1;
+        while( j < vec.size() && vec[j].dist == vec[i].dist )
+            j++;
+        if( j-i > 1 ) {
+            for(size_t k = i; k < j; k++)
+                vec[k].dist = objective::compare(solns[vec[k].i], solns[vec[k].j], data);
+            refined = true;
+        }
+        i = j;
+    }
+    if( refined )
+        sort(vec.begin(), vec.end());
+
     // For all solutions
     for(size_t i = 0; i < vec.size(); i++) {
         
@@ -482,38 +1033,10 @@ void Population<U>::distinct(size_t count) {
             U rand_sol = U();
 
             // Perform full local search on the new result
-            vector<size_t> all;
-            rand_sol.local_search(data, all);
-            //U::LOCAL_SEARCH(&rand_sol, data, all);
+            search(rand_sol, view);
 
             // Replace the underlying soln
-            if( pos == 0 )    root_agent->set_pocket(rand_sol);
-            if( pos == 1 )    root_agent->get_children()[0]->set_pocket(rand_sol);
-            if( pos == 2 )    root_agent->get_children()[1]->set_pocket(rand_sol);
-            if( pos == 3 )    root_agent->get_children()[2]->set_pocket(rand_sol);
-            if( pos == 4 )    root_agent->get_children()[0]->get_children()[0]->set_pocket(rand_sol);
-            if( pos == 5 )    root_agent->get_children()[0]->get_children()[1]->set_pocket(rand_sol);
-            if( pos == 6 )    root_agent->get_children()[0]->get_children()[2]->set_pocket(rand_sol);
-            if( pos == 7 )    root_agent->get_children()[1]->get_children()[0]->set_pocket(rand_sol);
-            if( pos == 8 )    root_agent->get_children()[1]->get_children()[1]->set_pocket(rand_sol);
-            if( pos == 9 )    root_agent->get_children()[1]->get_children()[2]->set_pocket(rand_sol);
-            if( pos == 10 )   root_agent->get_children()[2]->get_children()[0]->set_pocket(rand_sol);
-            if( pos == 11 )   root_agent->get_children()[2]->get_children()[1]->set_pocket(rand_sol);
-            if( pos == 12 )   root_agent->get_children()[2]->get_children()[2]->set_pocket(rand_sol);
-            
-            if( pos == 13 )    root_agent->set_current(rand_sol);
-            if( pos == 14 )    root_agent->get_children()[0]->set_current(rand_sol);
-            if( pos == 15 )    root_agent->get_children()[1]->set_current(rand_sol);
-            if( pos == 16 )    root_agent->get_children()[2]->set_current(rand_sol);
-            if( pos == 17 )    root_agent->get_children()[0]->get_children()[0]->set_current(rand_sol);
-            if( pos == 18 )    root_agent->get_children()[0]->get_children()[1]->set_current(rand_sol);
-            if( pos == 19 )    root_agent->get_children()[0]->get_children()[2]->set_current(rand_sol);
-            if( pos == 20 )    root_agent->get_children()[1]->get_children()[0]->set_current(rand_sol);
-            if( pos == 21 )    root_agent->get_children()[1]->get_children()[1]->set_current(rand_sol);
-            if( pos == 22 )    root_agent->get_children()[1]->get_children()[2]->set_current(rand_sol);
-            if( pos == 23 )    root_agent->get_children()[2]->get_children()[0]->set_current(rand_sol);
-            if( pos == 24 )    root_agent->get_children()[2]->get_children()[1]->set_current(rand_sol);
-            if( pos == 25 )    root_agent->get_children()[2]->get_children()[2]->set_current(rand_sol);
+            *solns[pos] = rand_sol;
 
         }
     }    
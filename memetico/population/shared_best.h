@@ -0,0 +1,99 @@
+
+/** @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Best solution shared by the threads optimising a Population
+ */
+
+#ifndef MEMETICO_SHARED_BEST_H
+#define MEMETICO_SHARED_BEST_H
+
+// Std lib
+#include <atomic>
+#include <limits>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @brief Best solution so far, read and improved by concurrent threads without locking
+ *
+ * Read-copy-update over an atomic pointer to an immutable snapshot of the model, its fitness and depth
+ * - fitness(), depth() and snapshot() are single atomic loads
+ * - publish() installs a copy of a strictly better solution with a compare-and-swap, retrying while the competing
+ *   snapshot is still worse, so concurrent improvements never lose the best
+ * - Replaced snapshots are retired to a lock-free list and freed by reclaim(), which must only be called when no thread
+ *   holds a snapshot, e.g. between generations. A snapshot is therefore valid until the next reclaim()
+ * - Threads constructing models read meme::POCKET_DEPTH of their own thread, set it from depth() before doing so
+ * - Copying a model draws from the RandReal::RANDREAL of the copying thread, so publishers need their own generators
+ */
+template <class U>
+class SharedBest {
+
+    public:
+
+        /** @brief Immutable published solution */
+        struct Snapshot {
+            U           model;
+            double      fitness;
+            size_t      depth;
+
+            /** Number of snapshots installed before and including this one */
+            uint64_t    version;
+
+            /** Next retired snapshot */
+            Snapshot*   next = nullptr;
+
+            Snapshot(U& soln, uint64_t version) : model(soln), fitness(soln.get_fitness()), depth(soln.get_depth()), version(version) {};
+        };
+
+        SharedBest() {};
+
+        SharedBest(const SharedBest&) = delete;
+        SharedBest& operator=(const SharedBest&) = delete;
+
+        ~SharedBest() {
+            reclaim();
+            delete current.load();
+        }
+
+        /** @brief Return the fitness of the best solution, the largest double before any is published */
+        double          fitness() const     { const Snapshot* s = current.load(memory_order_acquire); return s ? s->fitness : numeric_limits<double>::max(); };
+
+        /** @brief Return the depth of the best solution, 0 before any is published */
+        size_t          depth() const       { const Snapshot* s = current.load(memory_order_acquire); return s ? s->depth : 0; };
+
+        /** @brief Return the number of solutions installed, changes whenever snapshot() does */
+        uint64_t        version() const     { const Snapshot* s = current.load(memory_order_acquire); return s ? s->version : 0; };
+
+        /** @brief Return the best solution, nullptr before any is published, valid until the next reclaim() */
+        const Snapshot* snapshot() const    { return current.load(memory_order_acquire); };
+
+        /**
+         * @brief Install a copy of \a soln when it is strictly fitter than the best solution
+         * @return true when \a soln was installed
+         */
+        bool            publish(U& soln);
+
+        /** @brief Install a copy of \a soln regardless of its fitness */
+        void            reset(U& soln);
+
+        /** @brief Free retired snapshots, only when no thread holds one */
+        void            reclaim();
+
+    private:
+
+        /** Best solution */
+        atomic<Snapshot*>   current{nullptr};
+
+        /** Replaced snapshots awaiting reclaim() */
+        atomic<Snapshot*>   retired{nullptr};
+
+        /** @brief Push \a s onto the retired list */
+        void            retire(Snapshot* s);
+
+};
+
+#include <memetico/population/shared_best.tpp>
+
+#endif
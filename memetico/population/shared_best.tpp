@@ -0,0 +1,63 @@
+
+/** 
+ * @file
+ * @brief See shared_best.h
+ */
+
+template <class U>
+bool SharedBest<U>::publish(U& soln) {
+
+    double fitness = soln.get_fitness();
+    Snapshot* cur = current.load(memory_order_acquire);
+    Snapshot* mine = nullptr;
+
+    while( cur == nullptr || fitness < cur->fitness ) {
+
+        // Copy once, only when the solution is an improvement when seen
+        if( mine == nullptr )
+            mine = new Snapshot(soln, 0);
+        mine->version = cur ? cur->version+1 : 1;
+
+        if( current.compare_exchange_weak(cur, mine, memory_order_acq_rel, memory_order_acquire) ) {
+            if( cur != nullptr )
+                retire(cur);
+            return true;
+        }
+    }
+
+    delete mine;
+    return false;
+}
+
+template <class U>
+void SharedBest<U>::reset(U& soln) {
+
+    Snapshot* mine = new Snapshot(soln, 0);
+    Snapshot* cur = current.load(memory_order_acquire);
+    do {
+        mine->version = cur ? cur->version+1 : 1;
+    } while( !current.compare_exchange_weak(cur, mine, memory_order_acq_rel, memory_order_acquire) );
+
+    if( cur != nullptr )
+        retire(cur);
+}
+
+template <class U>
+void SharedBest<U>::retire(Snapshot* s) {
+
+    Snapshot* head = retired.load(memory_order_relaxed);
+    do {
+        s->next = head;
+    } while( !retired.compare_exchange_weak(head, s, memory_order_release, memory_order_relaxed) );
+}
+
+template <class U>
+void SharedBest<U>::reclaim() {
+
+    Snapshot* s = retired.exchange(nullptr, memory_order_acquire);
+    while( s != nullptr ) {
+        Snapshot* next = s->next;
+        delete s;
+        s = next;
+    }
+}
@@ -0,0 +1,123 @@
+
+/** @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Depth stratified sub-populations, enabled with -ds
+ */
+
+#ifndef MEMETICO_STRATA_H
+#define MEMETICO_STRATA_H
+
+// Local
+#include <memetico/globals.h>
+#include <memetico/population/pop.h>
+
+// Std lib
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+
+/** @brief Promotions between strata over a run */
+#define STRATA_EPOCHS 10
+
+/**
+ * @brief One Population per range of fraction depths, so deep and shallow models do not compete for the same evaluations
+ *
+ * Fraction depths 0 to meme::DEPTH are split into contiguous ranges, the strata, each evolved by its own Population
+ * - Models of a stratum are constructed within its range through meme::DEPTH_LOW and meme::DEPTH_HIGH
+ * - Each stratum runs meme::GENERATIONS scaled by the cost of its shallowest stratum over its own, approximately
+ *   equalising the evaluation cost of the strata, so deep strata run fewer generations
+ * - The run is split into STRATA_EPOCHS epochs. Within an epoch strata run concurrently on their own threads, between
+ *   epochs the best solution of each stratum is grown with set_depth() to the shallowest depth of the next and
+ *   immigrates there, keeping its coefficients as the start of local search
+ * - Each stratum has its own random number streams split from the generators of the constructing thread and
+ *   promotions only read the state at the end of an epoch, so a run is reproducible for any number of cores
+ */
+template <class U>
+class Strata {
+
+    public:
+
+        /**
+         * @brief Construct \a count strata over \a train_data
+         * - Throws invalid_argument when \a count is 0 or larger than the meme::DEPTH+1 depths
+         *
+         * @param train_data dataset to evaluate the populations
+         * @param count number of strata
+         * @param depth depth of the tree of each population
+         * @param degree degree of the tree of each population
+         */
+        Strata(DataSet* train_data, size_t count, size_t depth = POP_DEPTH, size_t degree = POP_DEGREE);
+
+        /** @brief Run the epochs of all strata, promoting between them */
+        void run();
+
+        /** @brief Return the fittest solution of all strata */
+        U& result();
+
+        /** @brief Return the number of strata */
+        size_t size()                           { return strata.size(); };
+
+        /** @brief Return the population of stratum \a i */
+        Population<U>& population(size_t i)     { return *strata[i].pop; };
+
+        /** @brief Return the lowest depth of stratum \a i */
+        size_t low(size_t i)                    { return strata[i].low; };
+
+        /** @brief Return the highest depth of stratum \a i */
+        size_t high(size_t i)                   { return strata[i].high; };
+
+        /** @brief Return the generations stratum \a i runs over the run */
+        size_t generations(size_t i)            { return strata[i].generations; };
+
+        /** @brief Return the number of promoted solutions that entered the next stratum */
+        size_t promotions()                     { return promoted; };
+
+    private:
+
+        /** @brief Population and per thread state of a stratum, carried between the threads of successive epochs */
+        struct Stratum {
+            unique_ptr<Population<U>>   pop;
+            size_t                      low;
+            size_t                      high;
+            size_t                      generations = 0;
+            size_t                      gen = 0;
+            RandInt                     ri;
+            RandReal                    rr;
+            RandInt                     meme_ri;
+            RandReal                    meme_rr;
+
+            /** Mask history written by U::write_history() at the end of the last thread of the stratum */
+            string                      history;
+
+            Stratum(size_t low, size_t high, RandInt ri, RandReal rr, RandInt meme_ri, RandReal meme_rr)
+                : low(low), high(high), ri(move(ri)), rr(move(rr)), meme_ri(move(meme_ri)), meme_rr(move(meme_rr)) {};
+        };
+
+        vector<Stratum>     strata;
+
+        size_t              promoted = 0;
+
+        /**
+         * @brief Call \a fn(i) for each stratum i concurrently, on a new thread with the globals of the stratum
+         * - Random number generators, depth range, POCKET_DEPTH, GEN and the mask history are set before and saved after \a fn
+         * - Rethrows the first exception of a stratum after all threads have finished
+         */
+        template <class F>
+        void parallel(F fn);
+
+        /** @brief Promote the best solution of each stratum into the next, so a solution moves a single stratum per epoch */
+        void promote();
+
+};
+
+#include <memetico/population/strata.tpp>
+
+#endif
@@ -0,0 +1,166 @@
+
+/**
+ * @file
+ * @brief See strata.h
+ */
+
+template <class U>
+Strata<U>::Strata(DataSet* train_data, size_t count, size_t depth, size_t degree) {
+
+    size_t depths = meme::DEPTH+1;
+    if( count == 0 || count > depths )
+        throw invalid_argument("Depth strata must be between 1 and "+to_string(depths)+" for a fraction depth of "+to_string(meme::DEPTH));
+
+    for(size_t i = 0; i < count; i++) {
+        Stratum s(
+            i*depths/count, (i+1)*depths/count-1,
+            RandInt::RANDINT->split(i), RandReal::RANDREAL->split(i), meme::RANDINT.split(i), meme::RANDREAL.split(i)
+        );
+        strata.push_back(move(s));
+    }
+
+    // A stratum costs about as much as its mean number of fraction terms, budgets are relative to the shallowest
+    double base = strata[0].low+strata[0].high+1;
+    for(Stratum& s : strata)
+        s.generations = max((size_t) 1, (size_t) llround(meme::GENERATIONS*base/(s.low+s.high+1)));
+
+    parallel([&](size_t i) {
+        strata[i].pop = make_unique<Population<U>>(train_data, depth, degree);
+        strata[i].pop->start();
+    });
+}
+
+template <class U>
+template <class F>
+void Strata<U>::parallel(F fn) {
+
+    size_t max_der_ord = meme::MAX_DER_ORD;
+    vector<thread> workers;
+    vector<exception_ptr> errors(strata.size());
+
+    for(size_t i = 0; i < strata.size(); i++)
+        workers.emplace_back([&, i]() {
+
+            Stratum& s = strata[i];
+            try {
+
+                // Globals of the new thread are those of the stratum, its mask history is carried between threads
+                RandInt::RANDINT = &s.ri;
+                RandReal::RANDREAL = &s.rr;
+                meme::RANDINT = s.meme_ri;
+                meme::RANDREAL = s.meme_rr;
+                meme::MAX_DER_ORD = max_der_ord;
+                meme::DEPTH_LOW = s.low;
+                meme::DEPTH_HIGH = s.high;
+                meme::GEN = s.gen;
+                if( s.pop )
+                    meme::POCKET_DEPTH = s.pop->shared_best.depth();
+                if( s.history != "" ) {
+                    stringstream is(s.history);
+                    U::read_history(is);
+                }
+
+                fn(i);
+
+                s.gen = meme::GEN;
+                s.meme_ri = meme::RANDINT;
+                s.meme_rr = meme::RANDREAL;
+                stringstream os;
+                U::write_history(os);
+                s.history = os.str();
+
+            } catch(...) {
+                errors[i] = current_exception();
+            }
+        });
+
+    for(thread& w : workers)
+        w.join();
+    for(exception_ptr& err : errors)
+        if( err )
+            rethrow_exception(err);
+}
+
+template <class U>
+void Strata<U>::run() {
+
+    cout << "==================" << endl;
+    cout << "Starting Memetico with " << strata.size() << " depth strata" << endl;
+    cout << "==================" << endl;
+    for(size_t i = 0; i < strata.size(); i++)
+        cout << "Stratum " << i << ": depths " << strata[i].low << " to " << strata[i].high << ", " << strata[i].generations << " generations" << endl;
+
+    auto start_time = chrono::system_clock::now();
+    atomic<bool> stop(false);
+
+    for(size_t e = 0; e < STRATA_EPOCHS && !stop; e++) {
+
+        // Each stratum runs its share of the epoch on its own thread
+        parallel([&](size_t i) {
+
+            Stratum& s = strata[i];
+            size_t last = s.generations*(e+1)/STRATA_EPOCHS;
+            for( ; meme::GEN < last && !stop; meme::GEN++ ) {
+
+                double elapsed = chrono::duration<double>(chrono::system_clock::now()-start_time).count();
+                if( elapsed > MAX_TIME ) {
+                    stop = true;
+                    break;
+                }
+
+                s.pop->generation(elapsed);
+                if( s.pop->best_soln.get_fitness() < meme::EPSILON )
+                    stop = true;
+            }
+        });
+
+        if( meme::VERBOSE ) {
+            cout << "epoch " << e;
+            for(Stratum& s : strata)
+                cout << "," << s.pop->best_soln.get_fitness();
+            cout << endl;
+        }
+
+        if( !stop && e+1 < STRATA_EPOCHS )
+            promote();
+
+        for(Stratum& s : strata)
+            s.pop->shared_best.reclaim();
+    }
+
+    if( stop )
+        cout << "[strata.tpp] Stopped after " << chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now()-start_time).count() << " ms" << endl;
+
+    meme::RUN_TIME = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now()-start_time).count();
+}
+
+template <class U>
+void Strata<U>::promote() {
+
+    // Immigration does not change best_soln, so every stratum reads the best of the one below as it was at the epoch end
+    atomic<size_t> entered(0);
+    parallel([&](size_t i) {
+
+        if( i == 0 )
+            return;
+
+        // Grow the best of the shallower stratum, keeping its coefficients for local search
+        U migrant = strata[i-1].pop->best_soln;
+        if( migrant.get_depth() < strata[i].low )
+            migrant.set_depth(strata[i].low);
+
+        if( strata[i].pop->immigrate(migrant) )
+            entered++;
+    });
+    promoted += entered;
+}
+
+template <class U>
+U& Strata<U>::result() {
+
+    Population<U>* best = strata[0].pop.get();
+    for(Stratum& s : strata)
+        if( s.pop->best_soln.get_fitness() < best->best_soln.get_fitness() )
+            best = s.pop.get();
+    return best->best_soln;
+}
@@ -0,0 +1,135 @@
+
+/**
+ * @file
+ * @author andy@impv.au
+ * @version 1.0
+ * @brief Entry point of memetico-serve, answering batched predictions of trained models
+ *
+ * Models are the <seed>.Model.bin files written by a run. Requests follow the framed protocol of
+ * ModelServer, on stdin/stdout by default or on a Unix socket with -sk, one thread per connection.
+ *
+ */
+
+// Local
+#include <memetico/args.h>
+#include <memetico/globals.h>
+#include <memetico/helpers/rng.h>
+#include <memetico/models/model_file.h>
+#include <memetico/models/model_server.h>
+#include <memetico/global_types.h>
+
+// Std
+#include <cstdlib>
+#include <csignal>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+using namespace std;
+
+/**
+ * Entry point of memetico-serve
+ *
+ * @param argc number of program arguments accessible in argv
+ * @param argv array of arguments
+ * @return int program succces
+ */
+int main(int argc, char *argv[]) {
+
+    if( args::arg_exists(argv, argv+argc, "-h", "--help") ) {
+        cerr << R"(
+                        USAGE:
+
+                            ./bin/memetico-serve -m <file>[,<file>...] [-sk <path>]
+
+                            -m --models <files>             Comma separated model files written by a run, <log-to>/<seed>.Model.bin
+                                                            The request model field indexes this list
+
+                            -sk --socket <path>             Listen on a Unix socket at <path>, one thread per connection
+                                                            Defaults to requests on stdin and responses on stdout
+                                                            A stale socket at <path> is replaced, any other file is an error
+        )" << endl;
+        return EXIT_SUCCESS;
+    }
+
+    // Models draw random values while they are constructed, before being read
+    RandInt ri = RandInt(meme::SEED);
+    RandReal rr = RandReal(meme::SEED);
+    RandInt::RANDINT = &ri;
+    RandReal::RANDREAL = &rr;
+
+    // Load models, stdout is reserved for responses
+    vector<ModelType> models;
+    vector<size_t> ivs;
+    stringstream files(args::arg_value(argv, argv+argc, "-m", "--models"));
+    string file;
+    try {
+        while( getline(files, file, ',') ) {
+            if( file == "" )
+                continue;
+            vector<string> names;
+            ModelType m(0);
+            model_file::load(file, m, names);
+            models.push_back(m);
+            ivs.push_back(names.size());
+            cerr << "Model " << models.size()-1 << ": " << file << " (" << names.size() << " variables, depth " << m.get_depth() << ")" << endl;
+        }
+    } catch(exception& e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    if( models.empty() ) {
+        cerr << "No models given, see --help" << endl;
+        return EXIT_FAILURE;
+    }
+
+    string path = args::arg_value(argv, argv+argc, "-sk", "--socket");
+    if( path == "" ) {
+        ModelServer<ModelType>(models, ivs).serve(STDIN_FILENO, STDOUT_FILENO);
+        return EXIT_SUCCESS;
+    }
+
+    // A client closing early must not terminate the server
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if( path.size() >= sizeof(addr.sun_path) ) {
+        cerr << "Socket path too long: " << path << endl;
+        return EXIT_FAILURE;
+    }
+    path.copy(addr.sun_path, path.size());
+
+    // Only a stale socket from an earlier server is replaced, never a file or link the path names
+    struct stat st;
+    if( lstat(path.c_str(), &st) == 0 ) {
+        if( !S_ISSOCK(st.st_mode) ) {
+            cerr << "Not a socket, refusing to replace: " << path << endl;
+            return EXIT_FAILURE;
+        }
+        unlink(path.c_str());
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if( listener < 0 || bind(listener, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(listener, 64) != 0 ) {
+        cerr << "Unable to listen on " << path << endl;
+        return EXIT_FAILURE;
+    }
+    cerr << "Listening on " << path << endl;
+
+    while( true ) {
+
+        int conn = accept(listener, nullptr, nullptr);
+        if( conn < 0 )
+            continue;
+
+        thread([conn, &models, &ivs]() {
+            ModelServer<ModelType>(models, ivs).serve(conn, conn);
+            close(conn);
+        }).detach();
+    }
+
+    return EXIT_SUCCESS;
+}